@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Compares two bench JSON results and flags regressions.
+
+usage: bench_compare.py BASELINE CURRENT [--threshold PERCENT] [--min-ms MS]
+
+Timings regress when they grow by more than the threshold and by more than min-ms, counters,
+memory and the per-job costs of the thread pool when they grow by more than the threshold. Exits
+with 1 when anything regressed.
+"""
+import argparse
+import json
+import sys
+
+
+def metrics(run):
+    values = {}
+    for timing in ("frame_cpu_ms", "frame_gpu_ms"):
+        values[timing + ".avg"] = (run[timing]["avg"], True)
+        values[timing + ".p99"] = (run[timing]["p99"], True)
+    for name, times in run.get("passes", {}).items():
+        values["pass." + name + ".gpu_ms.avg"] = (times["gpu_ms"]["avg"], True)
+    for name, value in run.get("counters", {}).items():
+        values["counter." + name] = (value, False)
+    for name, value in run.get("memory", {}).items():
+        values["memory." + name] = (value, False)
+    return values
+
+
+def load(filename):
+    with open(filename) as f:
+        result = json.load(f)
+    return result, {(run["scene"], run["path"]): run for run in result["runs"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed growth in percent (default 10)")
+    parser.add_argument("--min-ms", type=float, default=0.05,
+                        help="timing differences below this are noise (default 0.05)")
+    args = parser.parse_args()
+
+    baseline, baseline_runs = load(args.baseline)
+    current, current_runs = load(args.current)
+    for key in ("renderer", "width", "height", "frames", "seed"):
+        if baseline.get(key) != current.get(key):
+            print("warning: {} differs: {} -> {}".format(key, baseline.get(key),
+                                                          current.get(key)))
+
+    def compare(name, before, after):
+        print(name)
+        regressions = 0
+        for metric in sorted(set(before) & set(after)):
+            old, is_time = before[metric]
+            new, _ = after[metric]
+            change = (new - old) / old * 100.0 if old else (0.0 if new == old else float("inf"))
+            regressed = change > args.threshold and (not is_time or new - old > args.min_ms)
+            improved = change < -args.threshold and (not is_time or old - new > args.min_ms)
+            mark = "REGRESSION" if regressed else ("improved" if improved else "")
+            print("  {:<40} {:>14.4f} {:>14.4f} {:>+8.1f}%  {}".format(metric, old, new, change,
+                                                                     mark))
+            regressions += regressed
+        return regressions
+
+    regressions = 0
+    for run_key in sorted(set(baseline_runs) | set(current_runs)):
+        name = "/".join(run_key)
+        if run_key not in current_runs or run_key not in baseline_runs:
+            print("warning: {} only in {}".format(
+                name, "baseline" if run_key in baseline_runs else "current"))
+            continue
+        regressions += compare(name, metrics(baseline_runs[run_key]),
+                               metrics(current_runs[run_key]))
+    # micro benchmarks: the thread pool, object pools and scene file loading, their times are too
+    # small for --min-ms
+    for section in ("jobs", "pools", "scene_file"):
+        if section in baseline and section in current:
+            regressions += compare(section,
+                                   {k: (v, False) for k, v in baseline[section].items()},
+                                   {k: (v, False) for k, v in current[section].items()})
+
+    print("{} regression(s)".format(regressions))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
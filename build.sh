@@ -4,3 +4,4 @@ cmake -B build .
 cmake --build build
 
 ln -sf build/output .
+ln -sf build/bench .
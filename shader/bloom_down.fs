@@ -0,0 +1,55 @@
+#version 330 core
+in vec2 texCoord;
+out vec4 fragColor;
+
+uniform sampler2D image;
+// first pass from the full resolution bright color: weight the taps against fireflies
+uniform bool karisAverage;
+
+float KarisWeight(vec3 c) {
+    return 1.0 / (1.0 + dot(c, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+// 13 bilinear taps over a 6x6 texel footprint (Jimenez 2014). Taps at odd texel offsets sit on
+// texel corners, so each one averages 4 texels for the cost of a single fetch.
+void main() {
+    vec2 t = 1.0 / textureSize(image, 0);
+    vec3 a = texture(image, texCoord + t * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(image, texCoord + t * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(image, texCoord + t * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(image, texCoord + t * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(image, texCoord).rgb;
+    vec3 f = texture(image, texCoord + t * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(image, texCoord + t * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(image, texCoord + t * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(image, texCoord + t * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(image, texCoord + t * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(image, texCoord + t * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(image, texCoord + t * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(image, texCoord + t * vec2( 1.0, -1.0)).rgb;
+
+    // five overlapping 2x2 boxes: the center one weighs 0.5, the corner ones 0.125 each
+    vec3 boxes[5] = vec3[](
+        (j + k + l + m) * 0.25,
+        (a + b + d + e) * 0.25,
+        (b + c + e + f) * 0.25,
+        (d + e + g + h) * 0.25,
+        (e + f + h + i) * 0.25);
+    float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+
+    vec3 result = vec3(0.0);
+    if (karisAverage) {
+        float total = 0.0;
+        for (int n = 0; n < 5; ++n) {
+            float w = weights[n] * KarisWeight(boxes[n]);
+            result += boxes[n] * w;
+            total += w;
+        }
+        result /= total;
+    } else {
+        for (int n = 0; n < 5; ++n) {
+            result += boxes[n] * weights[n];
+        }
+    }
+    fragColor = vec4(result, 1.0);
+}
\ No newline at end of file
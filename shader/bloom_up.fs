@@ -0,0 +1,20 @@
+#version 330 core
+in vec2 texCoord;
+out vec4 fragColor;
+
+uniform sampler2D image;
+
+// 3x3 tent over the smaller level, added onto the level above by blending
+void main() {
+    vec2 t = 1.0 / textureSize(image, 0);
+    vec3 result = texture(image, texCoord).rgb * 4.0;
+    result += (texture(image, texCoord + vec2(-t.x, 0.0)).rgb +
+               texture(image, texCoord + vec2( t.x, 0.0)).rgb +
+               texture(image, texCoord + vec2(0.0, -t.y)).rgb +
+               texture(image, texCoord + vec2(0.0,  t.y)).rgb) * 2.0;
+    result += texture(image, texCoord + vec2(-t.x, -t.y)).rgb +
+              texture(image, texCoord + vec2( t.x, -t.y)).rgb +
+              texture(image, texCoord + vec2(-t.x,  t.y)).rgb +
+              texture(image, texCoord + vec2( t.x,  t.y)).rgb;
+    fragColor = vec4(result / 16.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+struct DrawData {
+  mat4 model;
+  vec4 color;
+  uvec4 material; // x: material index
+};
+
+struct CullInput {
+  DrawData data;
+  vec4 bounds;   // local bounding sphere
+  uvec4 command; // index count, first index, base vertex, batch
+  uvec4 slots;   // x: first output slot of the batch
+};
+
+struct DrawCommand {
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Inputs {
+  CullInput inputs[];
+};
+
+layout (std430, binding = 1) writeonly buffer Commands {
+  DrawCommand commands[];
+};
+
+layout (std430, binding = 2) writeonly buffer Outputs {
+  DrawData outputs[];
+};
+
+layout (std430, binding = 3) buffer Counts {
+  uint counts[];
+};
+
+// 1 for every input the last first pass rejected by occlusion only
+layout (std430, binding = 4) buffer Occluded {
+  uint occluded[];
+};
+
+// visible, frustum culled, occlusion culled
+layout (std430, binding = 5) buffer Counters {
+  uint counters[];
+};
+
+uniform int drawCount;
+uniform vec4 planes[6];
+// second pass: re-test what the first pass occluded against the rebuilt pyramid
+uniform bool retest;
+uniform bool occlusion;
+uniform sampler2D hiz;
+uniform mat4 hizViewProjection;
+uniform int hizLevelCount;
+
+bool IsOccluded(vec3 center, float radius) {
+    // screen rect and nearest depth of the sphere's bounding box
+    vec2 lo = vec2(1.0);
+    vec2 hi = vec2(-1.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1) * 2.0 - 1.0;
+        vec4 clip = hizViewProjection * vec4(center + corner * radius, 1.0);
+        if (clip.w <= 0.0) {
+            return false; // crosses the camera plane
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        lo = min(lo, ndc.xy);
+        hi = max(hi, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+    nearest = nearest * 0.5 + 0.5;
+
+    ivec2 size = textureSize(hiz, 0);
+    ivec2 pixelLo = min(ivec2(clamp(lo * 0.5 + 0.5, 0.0, 1.0) * vec2(size)), size - 1);
+    ivec2 pixelHi = min(ivec2(clamp(hi * 0.5 + 0.5, 0.0, 1.0) * vec2(size)), size - 1);
+    vec2 extent = vec2(pixelHi - pixelLo + 1);
+    int level = int(ceil(log2(max(extent.x, extent.y) * 0.5)));
+    level = clamp(level, 0, hizLevelCount - 1);
+
+    // go up until the rect touches at most 2x2 texels
+    ivec2 a;
+    ivec2 b;
+    for (; level < hizLevelCount; ++level) {
+        ivec2 last = max(size >> level, 1) - 1;
+        a = min(pixelLo >> level, last);
+        b = min(pixelHi >> level, last);
+        if (b.x - a.x <= 1 && b.y - a.y <= 1) {
+            break;
+        }
+    }
+    level = min(level, hizLevelCount - 1);
+    float farthest = max(max(texelFetch(hiz, a, level).r, texelFetch(hiz, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(hiz, ivec2(a.x, b.y), level).r, texelFetch(hiz, b, level).r));
+
+    return nearest > farthest;
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(drawCount)) {
+        return;
+    }
+
+    mat4 model = inputs[id].data.model;
+    vec4 bounds = inputs[id].bounds;
+    vec3 center = (model * vec4(bounds.xyz, 1.0)).xyz;
+    float scale = max(max(length(model[0].xyz), length(model[1].xyz)), length(model[2].xyz));
+    float radius = bounds.w * scale;
+
+    if (retest) {
+        if (occluded[id] == 0u || IsOccluded(center, radius)) {
+            return;
+        }
+        atomicAdd(counters[2], 0xffffffffu);
+    } else {
+        occluded[id] = 0u;
+        for (int i = 0; i < 6; ++i) {
+            if (dot(planes[i].xyz, center) + planes[i].w < -radius) {
+                atomicAdd(counters[1], 1u);
+                return;
+            }
+        }
+        if (occlusion && IsOccluded(center, radius)) {
+            occluded[id] = 1u;
+            atomicAdd(counters[2], 1u);
+            return;
+        }
+    }
+    atomicAdd(counters[0], 1u);
+
+    uvec4 command = inputs[id].command;
+    uint slot = inputs[id].slots.x + atomicAdd(counts[command.w], 1u);
+    commands[slot] = DrawCommand(command.x, 1u, command.y, int(command.z), 0u);
+    outputs[slot] = inputs[id].data;
+}
\ No newline at end of file
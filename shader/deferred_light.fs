@@ -0,0 +1,203 @@
+#version 330 core
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+
+struct Light {
+    // Point & Spot
+    vec3    position;
+    float   constant;
+    float   linear;
+    float   quadratic;
+
+    // Directional & Spot
+    vec3    direction;
+
+    // Spot
+    vec2    cutoff;
+
+    // All
+    vec3    ambient;
+    vec3    diffuse;
+    vec3    specular;
+};
+
+uniform vec3 viewPos;
+uniform int lightType;
+uniform Light light;
+uniform bool isBlinn;
+uniform bool isShadow;
+uniform mat4 lightTransform;
+
+// directional shadow
+uniform sampler2D depthMap;
+
+// omni-directional shadow
+uniform samplerCube depthMap3d;
+uniform float far_plane;
+
+// g-buffer
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform vec2 screenSize;
+uniform mat4 inverseViewProjection;
+
+// the surface of a pixel, read back from the g-buffer
+struct Surface {
+    vec3    position;
+    vec3    normal;
+    vec3    albedo;
+    vec3    specColor;
+    float   shininess;
+};
+
+vec3 DecodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+
+float ShadowCalculation2d(Surface s, vec3 lightDir) {
+    if (!isShadow) {
+      return 0.0;
+    }
+    vec4  lightPosition   = lightTransform * vec4(s.position, 1.0);
+    vec3  depthMapCoords  = (lightPosition.xyz / lightPosition.w) * 0.5 + 0.5;
+    float currentDepth    = depthMapCoords.z;
+    float bias            = max(0.02 * (1.0 - dot(s.normal, lightDir)), 0.001);
+    float shadow          = 0.0;
+    vec2  texelSize       = 1.0 / textureSize(depthMap, 0);
+    int   count           = 1;
+
+    for(int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            float pcfDepth = texture(depthMap, depthMapCoords.xy + vec2(x, y) * texelSize).r;
+            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+            ++count;
+        }
+    }
+    shadow /= count;
+
+    return shadow;
+}
+
+float ShadowCalculation3d(Surface s) {
+    if (!isShadow) {
+      return 0.0;
+    }
+    vec3  toLight       = s.position - light.position;
+    float closestDepth  = texture(depthMap3d, normalize(toLight)).r * far_plane;
+    float currentDepth  = length(toLight);
+    float bias          = 0.05;
+    float shadow        = currentDepth -  bias > closestDepth ? 1.0 : 0.0;
+
+    return shadow;
+}
+
+vec3 calcDiffuse(Surface s, vec3 lightDir) {
+    float   diff      = max(dot(s.normal, lightDir), 0.0);
+
+    return diff * s.albedo * light.diffuse;
+}
+
+vec3 calcSpecular(Surface s, vec3 lightDir) {
+    float   spec      = 0.0;
+    vec3    viewDir   = normalize(viewPos - s.position);
+    if (isBlinn) {
+      vec3 halfDir    = normalize(lightDir + viewDir);
+      spec            = pow(max(dot(halfDir, s.normal), 0.0), s.shininess);
+    } else {
+      vec3 reflectDir = reflect(-lightDir, s.normal);
+      spec            = pow(max(dot(viewDir, reflectDir), 0.0), s.shininess);
+    }
+
+    return spec * s.specColor * light.specular;
+}
+
+float calcAttenuation(float dist) {
+    return (1.0 / (light.constant + light.linear * dist + light.quadratic * (dist * dist)));
+}
+
+vec3 directionalLight(Surface s) {
+    vec3  lightDir = normalize(-light.direction);
+    vec3  ambient  = s.albedo * light.ambient;
+    vec3  diffuse  = calcDiffuse(s, lightDir);
+    vec3  specular = calcSpecular(s, lightDir);
+    float shadow   = ShadowCalculation2d(s, lightDir);
+
+    return ambient + (diffuse + specular) * (1.0 - shadow);
+}
+
+vec3 pointLight(Surface s) {
+    float   dist        = length(light.position - s.position);
+    float   attenuation = calcAttenuation(dist);
+    vec3    lightDir    = (light.position - s.position) / dist;
+
+    vec3    ambient   = s.albedo * light.ambient;
+    vec3    diffuse   = calcDiffuse(s, lightDir);
+    vec3    specular  = calcSpecular(s, lightDir);
+    float   shadow    = ShadowCalculation3d(s);
+
+    return (ambient + (diffuse + specular) * (1.0 - shadow)) * attenuation;
+}
+
+vec3 spotLight(Surface s) {
+    float   dist        = length(light.position - s.position);
+    float   attenuation = calcAttenuation(dist);
+    vec3    lightDir    = (light.position - s.position) / dist;
+
+    vec3 result = s.albedo * light.ambient;
+
+    float theta     = dot(lightDir, normalize(-light.direction));
+    float epsilon   = light.cutoff[0] - light.cutoff[1];
+    float intensity = clamp((theta - light.cutoff[1]) / epsilon, 0.0, 1.0);
+
+    if (intensity > 0.0) {
+        vec3  diffuse   = calcDiffuse(s, lightDir);
+        vec3  specular  = calcSpecular(s, lightDir);
+        float shadow    = ShadowCalculation2d(s, lightDir);
+        result += (diffuse + specular) * intensity * (1.0 - shadow);
+    }
+    result *= attenuation;
+
+    return result;
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) {
+        discard; // nothing drawn, keep what the forward passes put here
+    }
+    vec3 ndc = vec3(gl_FragCoord.xy / screenSize, depth) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * vec4(ndc, 1.0);
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+
+    Surface s;
+    s.position = world.xyz / world.w;
+    s.normal = DecodeNormal(texelFetch(gNormal, pixel, 0).xy);
+    s.albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    s.specColor = specular.rgb;
+    s.shininess = specular.a * 255.0;
+
+    vec3 result;
+    if (lightType == 0) {
+        result = directionalLight(s);
+    } else if (lightType == 1) {
+        result = pointLight(s);
+    } else {
+        result = spotLight(s);
+    }
+
+    fragColor = vec4(result, 1.0);
+
+    float brightness = dot(fragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
+    if(brightness > 0.85)
+        brightColor = vec4(fragColor.rgb, 1.0);
+    else
+        brightColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 texCoord;
+flat in vec4 feedbackIds;
+
+// log2 of the feedback target size to the screen size, its pixels are larger
+uniform float lodBias;
+
+// x, y: feedback ids of the diffuse and specular texture
+// z: mip level a 1x1 texture needs here, in 16ths, offset by 32
+out uvec4 feedback;
+
+void main() {
+    vec2 dx = dFdx(texCoord);
+    vec2 dy = dFdy(texCoord);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias;
+    feedback = uvec4(uvec2(feedbackIds.xy), uint(clamp((lod + 32.0) * 16.0, 0.0, 65535.0)), 0u);
+}
\ No newline at end of file
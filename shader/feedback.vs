@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+
+uniform mat4 model;
+uniform vec4 color; // feedback ids, TextureStreamer::FeedbackColor
+
+layout (std140) uniform Transform {
+  mat4 view;
+  mat4 projection;
+};
+
+out vec2 texCoord;
+flat out vec4 feedbackIds;
+
+void main() {
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    texCoord = aTexCoord;
+    feedbackIds = color;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+
+layout (std140) uniform Transform {
+  mat4 view;
+  mat4 projection;
+};
+
+struct DrawData {
+  mat4 model;
+  vec4 color;
+  uvec4 material; // x: material index
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+  DrawData draws[];
+};
+
+out vec2 texCoord;
+flat out vec4 feedbackIds;
+
+void main() {
+    gl_Position = projection * view * draws[gl_DrawIDARB].model * vec4(aPos, 1.0);
+    texCoord = aTexCoord;
+    feedbackIds = draws[gl_DrawIDARB].color;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedo;
+layout (location = 2) out vec4 gSpecular;
+
+in VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoord;
+  vec4 lightPosition; // directional shadow
+} fs_in;
+
+// material.fs or material_indirect.fs
+vec3 MaterialDiffuse(vec2 texCoord);
+vec3 MaterialSpecular(vec2 texCoord);
+float MaterialShininess();
+
+// octahedral mapping: the unit sphere folded onto [-1, 1]^2
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return n.xy;
+}
+
+void main() {
+    gNormal = EncodeNormal(normalize(fs_in.normal));
+    gAlbedo = vec4(MaterialDiffuse(fs_in.texCoord), 1.0);
+    // a shininess of up to 255 fits the alpha channel
+    gSpecular = vec4(MaterialSpecular(fs_in.texCoord), MaterialShininess() / 255.0);
+}
\ No newline at end of file
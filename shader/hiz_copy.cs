@@ -0,0 +1,13 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D depth;
+layout (r32f, binding = 0) writeonly uniform image2D dst;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(p, imageSize(dst)))) {
+        return;
+    }
+    imageStore(dst, p, vec4(texelFetch(depth, p, 0).r));
+}
\ No newline at end of file
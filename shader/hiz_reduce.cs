@@ -0,0 +1,25 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (r32f, binding = 0) readonly uniform image2D src;
+layout (r32f, binding = 1) writeonly uniform image2D dst;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 dstSize = imageSize(dst);
+    if (any(greaterThanEqual(p, dstSize))) {
+        return;
+    }
+
+    // the last texel of a level with odd size also covers the extra row / column
+    ivec2 srcSize = imageSize(src);
+    ivec2 last = 2 * p + 1 + ivec2(equal(p, dstSize - 1)) * (srcSize & 1);
+    last = min(last, srcSize - 1);
+    float farthest = 0.0;
+    for (int y = 2 * p.y; y <= last.y; ++y) {
+        for (int x = 2 * p.x; x <= last.x; ++x) {
+            farthest = max(farthest, imageLoad(src, ivec2(x, y)).r);
+        }
+    }
+    imageStore(dst, p, vec4(farthest));
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#version 330 core
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+
+struct LightVolume {
+  vec4 positionRadius;
+  vec4 color;
+};
+
+layout (std140) uniform LightVolumes {
+  LightVolume lights[256];
+};
+
+flat in int lightIndex;
+
+uniform vec3 viewPos;
+uniform bool isBlinn;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gDepth;
+uniform vec2 screenSize;
+uniform mat4 inverseViewProjection;
+
+vec3 DecodeNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec3 ndc = vec3(gl_FragCoord.xy / screenSize, depth) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * vec4(ndc, 1.0);
+    vec3 position = world.xyz / world.w;
+
+    vec4 light = lights[lightIndex].positionRadius;
+    vec3 toLight = light.xyz - position;
+    float dist = length(toLight);
+    if (depth == 1.0 || dist >= light.w) {
+        discard;
+    }
+    // inverse square, windowed to reach zero at the volume radius
+    float window = clamp(1.0 - pow(dist / light.w, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (dist * dist + 1.0);
+
+    vec3 normal = DecodeNormal(texelFetch(gNormal, pixel, 0).xy);
+    vec3 albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+    vec4 specular = texelFetch(gSpecular, pixel, 0);
+    vec3 lightDir = toLight / dist;
+    vec3 viewDir = normalize(viewPos - position);
+    float spec;
+    if (isBlinn) {
+        spec = pow(max(dot(normalize(lightDir + viewDir), normal), 0.0), specular.a * 255.0);
+    } else {
+        spec = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), specular.a * 255.0);
+    }
+    vec3 color = lights[lightIndex].color.rgb;
+    vec3 result = (max(dot(normal, lightDir), 0.0) * albedo + spec * specular.rgb) * color;
+
+    fragColor = vec4(result * attenuation, 0.0);
+    brightColor = vec4(0.0);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Transform {
+  mat4 view;
+  mat4 projection;
+};
+
+struct LightVolume {
+  vec4 positionRadius;
+  vec4 color;
+};
+
+layout (std140) uniform LightVolumes {
+  LightVolume lights[256];
+};
+
+// unit sphere mesh radius to light radius, with room for the faceted mesh
+uniform float volumeScale;
+
+flat out int lightIndex;
+
+void main() {
+    vec4 light = lights[gl_InstanceID].positionRadius;
+    gl_Position = projection * view * vec4(light.xyz + aPos * light.w * volumeScale, 1.0);
+    lightIndex = gl_InstanceID;
+}
\ No newline at end of file
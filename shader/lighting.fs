@@ -21,13 +21,6 @@ struct Light {
     vec3    specular;
 };
 
-struct Material {
-    sampler2D   diffuse;
-    sampler2D   specular;
-    float       shininess;
-};
-
-
 in VS_OUT {
   vec3 position;
   vec3 normal;
@@ -35,10 +28,14 @@ in VS_OUT {
   vec4 lightPosition; // directional shadow
 } fs_in;
 
+// material.fs or material_indirect.fs
+vec3 MaterialDiffuse(vec2 texCoord);
+vec3 MaterialSpecular(vec2 texCoord);
+float MaterialShininess();
+
 uniform vec3 viewPos;
 uniform int lightType;
 uniform Light light;
-uniform Material material;
 uniform bool isBlinn;
 uniform bool isShadow;
 
@@ -98,22 +95,22 @@ vec3 calcDiffuse(vec3 normal, vec3 texColor, vec3 lightDir) {
 }
 
 vec3 calcSpecular(vec3 normal, vec3 lightDir) {
-    vec3    specColor = texture(material.specular, fs_in.texCoord).xyz;
+    vec3    specColor = MaterialSpecular(fs_in.texCoord);
     float   spec      = 0.0;
     vec3    viewDir   = normalize(viewPos - fs_in.position);
     if (isBlinn) {
       vec3 halfDir    = normalize(lightDir + viewDir);
-      spec            = pow(max(dot(halfDir, normal), 0.0), material.shininess);
+      spec            = pow(max(dot(halfDir, normal), 0.0), MaterialShininess());
     } else {
       vec3 reflectDir = reflect(-lightDir, normal);
-      spec            = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+      spec            = pow(max(dot(viewDir, reflectDir), 0.0), MaterialShininess());
     }
 
     return spec * specColor * light.specular;
 }
 
 vec3 directionalLight() {
-    vec3  texColor = texture(material.diffuse, fs_in.texCoord).xyz;
+    vec3  texColor = MaterialDiffuse(fs_in.texCoord);
     vec3  lightDir = normalize(-light.direction);
     vec3  normal   = normalize(fs_in.normal);
 
@@ -130,7 +127,7 @@ float calcAttenuation(float dist) {
 }
 
 vec3 pointLight() {
-    vec3    texColor    = texture(material.diffuse, fs_in.texCoord).xyz;
+    vec3    texColor    = MaterialDiffuse(fs_in.texCoord);
     float   dist        = length(light.position - fs_in.position);
     float   attenuation = calcAttenuation(dist);
     vec3    lightDir    = (light.position - fs_in.position) / dist;
@@ -145,7 +142,7 @@ vec3 pointLight() {
 }
 
 vec3 spotLight() {
-    vec3    texColor    = texture(material.diffuse, fs_in.texCoord).xyz;
+    vec3    texColor    = MaterialDiffuse(fs_in.texCoord);
     float   dist        = length(light.position - fs_in.position);
     float   attenuation = calcAttenuation(dist);
     vec3    lightDir    = (light.position - fs_in.position) / dist;
@@ -18,6 +18,9 @@ out VS_OUT {
   vec4 lightPosition; // directional shadow
 } vs_out;
 
+// depth tested with GL_EQUAL against the prepass
+invariant gl_Position;
+
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     vs_out.position = (model * vec4(aPos, 1.0)).xyz;
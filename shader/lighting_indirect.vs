@@ -0,0 +1,43 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+uniform mat4 lightTransform;
+
+layout (std140) uniform Transform {
+  mat4 view;
+  mat4 projection;
+};
+
+struct DrawData {
+  mat4 model;
+  vec4 color;
+  uvec4 material; // x: material index
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+  DrawData draws[];
+};
+
+out VS_OUT {
+  vec3 position;
+  vec3 normal;
+  vec2 texCoord;
+  vec4 lightPosition; // directional shadow
+} vs_out;
+
+flat out uint materialIndex;
+
+invariant gl_Position;
+
+void main() {
+    mat4 model = draws[gl_DrawIDARB].model;
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vs_out.position = (model * vec4(aPos, 1.0)).xyz;
+    vs_out.normal = (transpose(inverse(model)) * vec4(aNormal, 0.0)).xyz;
+    vs_out.texCoord = aTexCoord;
+    vs_out.lightPosition = lightTransform * vec4(vs_out.position, 1.0);
+    materialIndex = draws[gl_DrawIDARB].material.x;
+}
\ No newline at end of file
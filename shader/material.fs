@@ -0,0 +1,21 @@
+#version 330 core
+// material functions of lighting.fs and gbuffer.fs, set by Material::SetToProgram
+struct Material {
+    sampler2D   diffuse;
+    sampler2D   specular;
+    float       shininess;
+};
+
+uniform Material material;
+
+vec3 MaterialDiffuse(vec2 texCoord) {
+    return texture(material.diffuse, texCoord).rgb;
+}
+
+vec3 MaterialSpecular(vec2 texCoord) {
+    return texture(material.specular, texCoord).rgb;
+}
+
+float MaterialShininess() {
+    return material.shininess;
+}
\ No newline at end of file
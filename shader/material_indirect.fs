@@ -0,0 +1,28 @@
+#version 430 core
+// material functions of lighting.fs and gbuffer.fs for the *_indirect programs, the draw list
+// binds the arrays of the texture set and the MaterialTable entries
+struct MaterialData {
+  uvec4 layers; // x: diffuse layer, y: specular layer
+  vec4 params;  // x: shininess
+};
+
+layout (std430, binding = 6) readonly buffer MaterialBuffer {
+  MaterialData materials[];
+};
+
+uniform sampler2DArray materialDiffuse;
+uniform sampler2DArray materialSpecular;
+
+flat in uint materialIndex;
+
+vec3 MaterialDiffuse(vec2 texCoord) {
+    return texture(materialDiffuse, vec3(texCoord, materials[materialIndex].layers.x)).rgb;
+}
+
+vec3 MaterialSpecular(vec2 texCoord) {
+    return texture(materialSpecular, vec3(texCoord, materials[materialIndex].layers.y)).rgb;
+}
+
+float MaterialShininess() {
+    return materials[materialIndex].params.x;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+
+struct DrawData {
+  mat4 model;
+  vec4 color;
+  uvec4 material; // x: material index
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+  DrawData draws[];
+};
+
+void main() {
+    gl_Position = draws[gl_DrawIDARB].model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -8,13 +8,14 @@ uniform sampler2D bloomBlur;
 uniform float gamma;
 uniform float exposure;
 uniform bool bloom_on;
+uniform float bloomStrength;
 uniform bool hdr_on;
 
 void main() {
   vec3 pixel = texture(colorTex, texCoord).xyz;
   if (bloom_on) {
     vec3 bloomPixel = texture(bloomBlur, texCoord).xyz;
-    pixel += bloomPixel;
+    pixel += bloomPixel * bloomStrength;
   }
 
   vec3 result;
@@ -8,6 +8,9 @@ layout (std140) uniform Transform {
   mat4 projection;
 };
 
+// also the depth prepass, has to match the lighting pass depth bit for bit
+invariant gl_Position;
+
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,8 @@
+#version 430 core
+
+flat in vec4 drawColor;
+out vec4 fragColor;
+
+void main() {
+    fragColor = drawColor;
+}
\ No newline at end of file
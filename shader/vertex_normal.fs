@@ -1,7 +1,9 @@
 #version 330 core
 
+in vec3 color;
+
 out vec4 fragColor;
 
 void main() {
-    fragColor = vec4(1.0, 1.0, 1.0, 1.0);
+    fragColor = vec4(color, 1.0);
 }
\ No newline at end of file
@@ -1,20 +1,35 @@
 #version 330 core
 layout (triangles) in;
-layout (line_strip, max_vertices=6) out;
+layout (line_strip, max_vertices=18) out;
 
 uniform mat4 transform;
 uniform float length;
 in vec3 normal[];
+in vec4 tangent[];
 
-void gen(int i) {
+out vec3 color;
+
+void line(int i, vec3 direction, vec3 lineColor) {
+  color = lineColor;
   gl_Position = transform * gl_in[i].gl_Position;
   EmitVertex();
 
-  gl_Position = transform * (gl_in[i].gl_Position + normalize(vec4(normal[i], 0.0)) * length);
+  gl_Position = transform * (gl_in[i].gl_Position + vec4(direction, 0.0) * length);
   EmitVertex();
   EndPrimitive();
 }
 
+// the normal blue, the tangent red and the bitangent green, its side picked by tangent.w
+void gen(int i) {
+  vec3 n = normalize(normal[i]);
+  line(i, n, vec3(0.0, 0.0, 1.0));
+  if (dot(tangent[i].xyz, tangent[i].xyz) > 0.0) {
+    vec3 t = normalize(tangent[i].xyz);
+    line(i, t, vec3(1.0, 0.0, 0.0));
+    line(i, cross(n, t) * tangent[i].w, vec3(0.0, 1.0, 0.0));
+  }
+}
+
 void main() {
   gen(0);
   gen(1);
@@ -1,10 +1,13 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+layout (location = 3) in vec4 aTangent;
 
 out vec3 normal;
+out vec4 tangent;
 
 void main() {
     gl_Position = vec4(aPos, 1.0);
     normal = aNormal;
+    tangent = aTangent;
 }
\ No newline at end of file
@@ -0,0 +1,636 @@
+#include "context.hpp"
+#include "headless.hpp"
+#include "object.hpp"
+#include "scene_file.hpp"
+#include "world_partition.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <imgui.h>
+#include <map>
+#include <new>
+#include <stb/stb_image_write.h>
+
+// every heap allocation of the process on any thread, a frame's share is the growth across Render
+static std::atomic<size_t> g_heap_allocations{0};
+
+void* operator new(size_t size) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* data = std::malloc(size > 0 ? size : 1)) {
+        return data;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept {
+    std::free(data);
+}
+
+// Replays fixed camera paths through seeded scenes on a headless context and writes the timings,
+// draw counts and memory of every scene / path pair as JSON, along with the scheduling overhead
+// of the thread pool, the cost of spawning objects and of loading a scene file. bench_compare.py
+// diffs two of them.
+namespace {
+
+struct BenchOptions {
+    int width{1280};
+    int height{720};
+    int frame_count{240}; // per camera path
+    int warmup_count{16};
+    uint32_t seed{1};
+    std::string output{"save/bench.json"};
+    std::string model_path{"model/backpack/backpack.obj"};
+    // empty: all of them, "jobs" / "pools" / "scene_file": only that micro benchmark
+    std::string scene;
+};
+
+struct BenchScene {
+    std::string name;
+    SceneDesc desc;
+    bool generated_texture{false}; // BuildTexture writes desc.wood_texture_path
+};
+
+struct CameraPath {
+    std::string name;
+    std::vector<CameraKey> keys;
+};
+
+struct Run {
+    std::string scene;
+    std::string path;
+    std::vector<float> frame_cpu_ms;
+    std::vector<float> frame_gpu_ms;
+    std::map<std::string, Profiler::History> passes;
+    std::map<std::string, double> counters; // per frame averages
+    size_t frame_graph_bytes{0};
+    size_t frame_arena_peak_bytes{0};
+    size_t peak_rss_bytes{0};
+};
+
+std::vector<BenchScene> Scenes(const BenchOptions& options) {
+    std::vector<BenchScene> scenes(6);
+    scenes[0].name = "boxes";
+    scenes[0].desc.box_count = 2000;
+    scenes[1].name = "lights";
+    scenes[1].desc.light_count = 256;
+    scenes[1].desc.deferred = true;
+    scenes[2].name = "model";
+    scenes[2].desc.model_path = options.model_path;
+    scenes[3].name = "shadows";
+    scenes[3].desc.box_count = 1000;
+    scenes[3].desc.closed_room = true;
+    scenes[3].desc.shadow_map_size = 2048;
+    // BuildWorld writes it, the cells around the paths do not all fit into the budget
+    scenes[4].name = "streaming";
+    scenes[4].desc.box_count = 0;
+    scenes[4].desc.world_path = (std::filesystem::temp_directory_path() / "bench_world").string();
+    scenes[4].desc.world_budget_bytes = 2 * 1024 * 1024;
+    // a floor texture whose full mip chain does not fit into the budget
+    scenes[5].name = "textures";
+    scenes[5].desc.box_count = 1000;
+    scenes[5].desc.wood_texture_path =
+        (std::filesystem::temp_directory_path() / "bench_textures" / "wood_2048.png").string();
+    scenes[5].desc.texture_budget_bytes = 8 * 1024 * 1024;
+    scenes[5].generated_texture = true;
+    for (auto& scene : scenes) {
+        scene.desc.seed = options.seed;
+    }
+
+    return scenes;
+}
+
+// boxes in 24 x 24 cells of 16 around the origin, y 5..20 like the other scenes
+bool BuildWorld(const std::string& directory, uint32_t seed) {
+    const int kCells = 24;
+    const int kBoxesPerCell = 200;
+    const float kCellSize = 16.0f;
+    std::mt19937 random(seed);
+    auto uniform = [&random](float min, float max) {
+        return std::uniform_real_distribution<float>(min, max)(random);
+    };
+    SceneFile::Contents contents;
+    contents.meshes.push_back(SceneFile::Mesh{contents.AddString("box"), SceneFile::kNone});
+    for (int z = -kCells / 2; z < kCells / 2; ++z) {
+        for (int x = -kCells / 2; x < kCells / 2; ++x) {
+            for (int i = 0; i < kBoxesPerCell; ++i) {
+                // braced, so the draws happen in order
+                glm::vec3 translate{(x + uniform(0.0f, 1.0f)) * kCellSize, uniform(5.0f, 20.0f),
+                                    (z + uniform(0.0f, 1.0f)) * kCellSize};
+                glm::vec3 euler{uniform(0.0f, 360.0f), uniform(0.0f, 360.0f),
+                                uniform(0.0f, 360.0f)};
+                glm::quat rotate(glm::radians(euler));
+                float scale = uniform(0.5f, 1.5f);
+                contents.objects.push_back(SceneFile::Object{
+                    {translate.x, translate.y, translate.z},
+                    {rotate.x, rotate.y, rotate.z, rotate.w},
+                    {scale, scale, scale},
+                    scale / 1.5f,
+                    0});
+            }
+        }
+    }
+
+    return WorldPartition::Build(directory, contents, kCellSize);
+}
+
+// rings on a fine checker, so every level differs from the next. Written once, the texture streamer
+// bakes the mip file next to it on the first run
+bool BuildTexture(const std::string& filename) {
+    if (std::filesystem::exists(filename)) {
+        return true;
+    }
+    const int kSize = 2048;
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), error);
+    std::vector<uint8_t> pixels((size_t)kSize * kSize * 3);
+    for (int y = 0; y < kSize; ++y) {
+        for (int x = 0; x < kSize; ++x) {
+            float ring = 0.5f + 0.5f * std::sin(std::hypot(x - kSize / 2, y - kSize / 2) * 0.1f);
+            float checker = ((x / 4 + y / 4) % 2) ? 1.0f : 0.8f;
+            uint8_t* pixel = &pixels[((size_t)y * kSize + x) * 3];
+            pixel[0] = (uint8_t)(checker * (120.0f + 80.0f * ring));
+            pixel[1] = (uint8_t)(checker * (70.0f + 50.0f * ring));
+            pixel[2] = (uint8_t)(checker * (30.0f + 20.0f * ring));
+        }
+    }
+    if (!stbi_write_png(filename.c_str(), kSize, kSize, 3, pixels.data(), kSize * 3)) {
+        SPDLOG_ERROR("failed to write {}", filename);
+        return false;
+    }
+
+    return true;
+}
+
+// the scene is centered over the origin, boxes fill y 5..20
+std::vector<CameraPath> Paths() {
+    CameraPath orbit{"orbit", {}};
+    glm::vec3 target(0.0f, 12.0f, 0.0f);
+    for (int i = 0; i <= 8; ++i) {
+        float yaw = i * 45.0f;
+        glm::vec3 position(45.0f * std::sin(glm::radians(yaw)), 30.0f,
+                           45.0f * std::cos(glm::radians(yaw)));
+        float pitch = glm::degrees(std::atan2(target.y - position.y, 45.0f));
+        orbit.keys.push_back(CameraKey{position, yaw, pitch});
+    }
+    CameraPath flythrough{"flythrough",
+                          {{glm::vec3(-35.0f, 12.0f, 0.0f), -90.0f, 0.0f},
+                           {glm::vec3(-10.0f, 14.0f, 5.0f), -70.0f, -10.0f},
+                           {glm::vec3(10.0f, 10.0f, -5.0f), -110.0f, 10.0f},
+                           {glm::vec3(35.0f, 12.0f, 0.0f), -90.0f, 0.0f}}};
+
+    return {orbit, flythrough};
+}
+
+// GlState counters in the JSON, averaged over the frames
+const std::pair<const char*, size_t GlState::Counters::*> kGlCounters[] = {
+    {"gl_draws", &GlState::Counters::draws},
+    {"gl_dispatches", &GlState::Counters::dispatches},
+    {"program_binds", &GlState::Counters::program_binds},
+    {"texture_binds", &GlState::Counters::texture_binds},
+    {"framebuffer_binds", &GlState::Counters::framebuffer_binds},
+    {"vertex_array_binds", &GlState::Counters::vertex_array_binds},
+    {"buffer_binds", &GlState::Counters::buffer_binds},
+    {"uniform_uploads", &GlState::Counters::uniform_uploads},
+    {"buffer_uploads", &GlState::Counters::buffer_uploads},
+    {"buffer_upload_bytes", &GlState::Counters::buffer_upload_bytes},
+    {"skipped_binds", &GlState::Counters::skipped},
+};
+
+size_t PeakRssBytes() {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return (size_t)std::atoll(line.c_str() + 6) * 1024;
+        }
+    }
+#endif
+    return 0;
+}
+
+bool RunPath(const BenchOptions& options, const BenchScene& scene, const CameraPath& path,
+             Run* run) {
+    auto context = Context::Create(scene.desc);
+    auto output = Framebuffer::Create({Texture2d::Create(options.width, options.height)},
+                                      std::shared_ptr<Texture2d>());
+    if (!context || !output) {
+        SPDLOG_ERROR("failed to create scene {}", scene.name);
+        return false;
+    }
+    context->ReshapeViewport(options.width, options.height);
+    context->set_output_framebuffer(output.get());
+
+    Profiler* profiler = context->profiler();
+    SetCameraKey(context->camera(), path.keys.front());
+    for (int frame = 0; frame < options.warmup_count; ++frame) {
+        ImGui::NewFrame();
+        context->Render();
+    }
+    glFinish();
+
+    uint64_t resolved = profiler->resolved_frame_count();
+    size_t world_loads = context->world() ? context->world()->stats().loads : 0;
+    size_t world_evictions = context->world() ? context->world()->stats().evictions : 0;
+    const TextureStreamer* textures = context->texture_streamer();
+    TextureStreamer::Stats texture_stats = textures ? textures->stats() : TextureStreamer::Stats();
+    double texture_bytes = 0.0;
+    double draws = 0.0;
+    double draw_calls = 0.0;
+    double state_changes = 0.0;
+    double heap_allocations = 0.0;
+    std::vector<double> gl_counters(std::size(kGlCounters), 0.0);
+    for (int frame = 0; frame < options.frame_count; ++frame) {
+        float t = options.frame_count > 1 ? (float)frame / (options.frame_count - 1) : 0.0f;
+        SetCameraKey(context->camera(), SampleCameraPath(path.keys, t));
+
+        auto begin = std::chrono::steady_clock::now();
+        size_t allocations = g_heap_allocations.load(std::memory_order_relaxed);
+        ImGui::NewFrame();
+        context->Render();
+        heap_allocations += g_heap_allocations.load(std::memory_order_relaxed) - allocations;
+        auto end = std::chrono::steady_clock::now();
+        run->frame_cpu_ms.push_back(std::chrono::duration<float, std::milli>(end - begin).count());
+
+        // GPU times arrive a few frames late, the warmup ones are already taken
+        if (profiler->resolved_frame_count() != resolved) {
+            resolved = profiler->resolved_frame_count();
+            float gpu_ms = 0.0f;
+            for (const auto& timing : profiler->last_frame()) {
+                if (timing.depth == 0) {
+                    gpu_ms += timing.gpu_ms;
+                }
+                auto& pass = run->passes[timing.name];
+                pass.cpu_ms.push_back(timing.cpu_ms);
+                pass.gpu_ms.push_back(timing.gpu_ms);
+            }
+            run->frame_gpu_ms.push_back(gpu_ms);
+        }
+        draws += context->draw_list()->stats().draws;
+        draw_calls += context->draw_list()->stats().draw_calls;
+        const GlState::Counters& gl = GlState::Get().counters();
+        for (size_t i = 0; i < gl_counters.size(); ++i) {
+            gl_counters[i] += gl.*kGlCounters[i].second;
+        }
+        state_changes += gl.state_changes();
+        texture_bytes += textures ? textures->stats().resident_bytes : 0;
+    }
+    glFinish();
+
+    run->scene = scene.name;
+    run->path = path.name;
+    run->counters["draws"] = draws / options.frame_count;
+    run->counters["draw_calls"] = draw_calls / options.frame_count;
+    run->counters["state_changes"] = state_changes / options.frame_count;
+    run->counters["heap_allocations"] = heap_allocations / options.frame_count;
+    if (const WorldPartition* world = context->world()) {
+        WorldPartition::Stats stats = world->stats();
+        run->counters["cell_loads"] = (double)(stats.loads - world_loads) / options.frame_count;
+        run->counters["cell_evictions"] =
+            (double)(stats.evictions - world_evictions) / options.frame_count;
+    }
+    if (textures && textures->stats().textures > 0) {
+        TextureStreamer::Stats stats = textures->stats();
+        run->counters["texture_resident_bytes"] = texture_bytes / options.frame_count;
+        run->counters["texture_full_bytes"] = (double)stats.full_bytes;
+        run->counters["texture_loads"] =
+            (double)(stats.loads - texture_stats.loads) / options.frame_count;
+        run->counters["texture_evictions"] =
+            (double)(stats.evictions - texture_stats.evictions) / options.frame_count;
+    }
+    for (size_t i = 0; i < gl_counters.size(); ++i) {
+        run->counters[kGlCounters[i].first] = gl_counters[i] / options.frame_count;
+    }
+    run->frame_graph_bytes = context->frame_graph()->stats().allocated_bytes;
+    run->frame_arena_peak_bytes = context->frame_arena()->stats().high_watermark;
+    run->peak_rss_bytes = PeakRssBytes();
+
+    return true;
+}
+
+// ns per empty job, the best of a few rounds since other processes come in between
+template <typename F> double NsPerJob(size_t job_count, F&& round) {
+    double best = 0.0;
+    for (int i = 0; i < 5; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        round();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count() / job_count;
+        best = i == 0 ? ns : std::min(best, ns);
+    }
+
+    return best;
+}
+
+std::map<std::string, double> RunJobs() {
+    const size_t kJobCount = 100000;
+    ThreadPool* pool = ThreadPool::Default();
+    std::map<std::string, double> jobs;
+    jobs["threads"] = (double)pool->thread_count();
+    // through the shared queue of outside threads
+    jobs["submit_ns"] = NsPerJob(kJobCount, [pool]() {
+        ThreadPool::Counter counter;
+        for (size_t i = 0; i < kJobCount; ++i) {
+            pool->Submit([]() {}, &counter);
+        }
+        pool->Wait(&counter);
+    });
+    // from a worker into its own deque, the others steal
+    jobs["worker_submit_ns"] = NsPerJob(kJobCount, [pool]() {
+        ThreadPool::Counter counter;
+        pool->Submit(
+            [pool]() {
+                ThreadPool::Counter inner;
+                for (size_t i = 0; i < kJobCount; ++i) {
+                    pool->Submit([]() {}, &inner);
+                }
+                pool->Wait(&inner);
+            },
+            &counter);
+        pool->Wait(&counter);
+    });
+    // every job starts when the one before it is done, the latency of a dependency
+    const size_t kChainLength = kJobCount / 10;
+    jobs["chain_ns"] = NsPerJob(kChainLength, [pool]() {
+        auto counters = std::make_unique<ThreadPool::Counter[]>(kChainLength);
+        for (size_t i = 0; i < kChainLength; ++i) {
+            pool->Submit([]() {}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+        }
+        pool->Wait(&counters[kChainLength - 1]);
+    });
+    jobs["parallel_for_ns"] = NsPerJob(kJobCount, [pool]() {
+        pool->ParallelFor(kJobCount, 1, [](size_t, size_t) {});
+    });
+
+    return jobs;
+}
+
+// spawning and despawning objects in waves, the churn of a scene that streams its contents
+std::map<std::string, double> RunPools() {
+    const size_t kWave = 4096;
+    auto mesh = Mesh::CreateBox();
+    std::vector<std::shared_ptr<Object>> objects;
+    objects.reserve(kWave);
+    std::vector<ObjectPool<Object>::Handle> handles(kWave);
+    std::map<std::string, double> pools;
+    size_t heap_allocations = g_heap_allocations.load();
+    pools["spawn_ns"] = NsPerJob(kWave, [&]() {
+        for (size_t i = 0; i < kWave; ++i) {
+            objects.push_back(Object::Create(mesh));
+        }
+        objects.clear();
+    });
+    pools["heap_allocations_per_spawn"] =
+        (double)(g_heap_allocations.load() - heap_allocations) / (5 * kWave);
+    // by handle, without shared ownership
+    auto& pool = ObjectPool<Object>::Default();
+    pools["handle_spawn_ns"] = NsPerJob(kWave, [&]() {
+        for (size_t i = 0; i < kWave; ++i) {
+            handles[i] = pool.Create(mesh);
+        }
+        for (size_t i = 0; i < kWave; ++i) {
+            pool.Destroy(handles[i]);
+        }
+    });
+    pools["capacity"] = (double)pool.capacity();
+
+    return pools;
+}
+
+double MsSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin)
+        .count();
+}
+
+// a million object scene file, loaded and every record read against plainly reading the file,
+// both from the page cache
+std::map<std::string, double> RunSceneFile() {
+    const size_t kObjectCount = 1000000;
+    auto filename = (std::filesystem::temp_directory_path() / "bench_scene.bin").string();
+    SceneFile::Contents contents;
+    contents.meshes.push_back(SceneFile::Mesh{contents.AddString("box"), SceneFile::kNone});
+    contents.objects.resize(kObjectCount);
+    for (size_t i = 0; i < kObjectCount; ++i) {
+        auto& object = contents.objects[i];
+        object = SceneFile::Object{{(float)(i % 1000), 0.0f, (float)(i / 1000)},
+                                   {0.0f, 0.0f, 0.0f, 1.0f},
+                                   {1.0f, 1.0f, 1.0f},
+                                   0.5f,
+                                   0};
+    }
+    std::map<std::string, double> scene_file;
+    auto begin = std::chrono::steady_clock::now();
+    if (!SceneFile::Save(filename, contents)) {
+        return scene_file;
+    }
+    scene_file["save_ms"] = MsSince(begin);
+
+    double read_ms = 0.0;
+    double load_ms = 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < 5; ++i) {
+        begin = std::chrono::steady_clock::now();
+        std::ifstream in(filename, std::ios::binary);
+        auto bytes = std::make_unique<char[]>(64 * 1024);
+        while (in.read(bytes.get(), 64 * 1024) || in.gcount() > 0) {
+            sum += bytes[0];
+        }
+        read_ms = i == 0 ? MsSince(begin) : std::min(read_ms, MsSince(begin));
+
+        begin = std::chrono::steady_clock::now();
+        auto file = SceneFile::Load(filename);
+        if (!file) {
+            return scene_file;
+        }
+        for (size_t j = 0; j < file->object_count(); ++j) {
+            sum += file->objects()[j].translate[0];
+        }
+        load_ms = i == 0 ? MsSince(begin) : std::min(load_ms, MsSince(begin));
+    }
+    std::filesystem::remove(filename);
+    scene_file["objects"] = (double)kObjectCount;
+    scene_file["read_ms"] = read_ms;
+    scene_file["load_ms"] = load_ms;
+    // keeps the reads
+    volatile double sink = sum;
+    (void)sink;
+
+    return scene_file;
+}
+
+std::string JsonSummary(const Profiler::Summary& summary) {
+    char text[128];
+    snprintf(text, sizeof(text), "{\"min\": %.4f, \"avg\": %.4f, \"p99\": %.4f}", summary.min,
+             summary.avg, summary.p99);
+
+    return text;
+}
+
+// micro benchmarks by section name, "jobs" and "pools"
+using Sections = std::map<std::string, std::map<std::string, double>>;
+
+bool WriteResults(const BenchOptions& options, const std::vector<Run>& runs,
+                  const Sections& sections) {
+    std::error_code error;
+    auto directory = std::filesystem::path(options.output).parent_path();
+    if (!directory.empty()) {
+        std::filesystem::create_directories(directory, error);
+    }
+    std::ofstream out(options.output);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", options.output);
+        return false;
+    }
+
+    out << "{\n";
+    out << "  \"renderer\": " << JsonString((const char*)glGetString(GL_RENDERER)) << ",\n";
+    out << "  \"version\": " << JsonString((const char*)glGetString(GL_VERSION)) << ",\n";
+    out << "  \"width\": " << options.width << ", \"height\": " << options.height
+        << ", \"frames\": " << options.frame_count << ", \"warmup\": " << options.warmup_count
+        << ", \"seed\": " << options.seed << ",\n";
+    for (const auto& [section, values] : sections) {
+        out << "  " << JsonString(section) << ": {";
+        bool first = true;
+        for (const auto& [name, value] : values) {
+            out << (first ? "" : ", ") << JsonString(name) << ": " << value;
+            first = false;
+        }
+        out << "},\n";
+    }
+    out << "  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const auto& run = runs[i];
+        out << (i ? ",\n" : "\n") << "    {\n";
+        out << "      \"scene\": " << JsonString(run.scene) << ", \"path\": "
+            << JsonString(run.path) << ",\n";
+        out << "      \"frame_cpu_ms\": " << JsonSummary(Profiler::Summarize(run.frame_cpu_ms))
+            << ",\n";
+        out << "      \"frame_gpu_ms\": " << JsonSummary(Profiler::Summarize(run.frame_gpu_ms))
+            << ",\n";
+        out << "      \"passes\": {";
+        bool first = true;
+        for (const auto& [name, history] : run.passes) {
+            out << (first ? "\n" : ",\n") << "        " << JsonString(name)
+                << ": {\"cpu_ms\": " << JsonSummary(history.cpu())
+                << ", \"gpu_ms\": " << JsonSummary(history.gpu()) << "}";
+            first = false;
+        }
+        out << "\n      },\n";
+        out << "      \"counters\": {";
+        first = true;
+        for (const auto& [name, value] : run.counters) {
+            out << (first ? "" : ", ") << JsonString(name) << ": " << value;
+            first = false;
+        }
+        out << "},\n";
+        out << "      \"memory\": {\"frame_graph_bytes\": " << run.frame_graph_bytes
+            << ", \"frame_arena_peak_bytes\": " << run.frame_arena_peak_bytes
+            << ", \"peak_rss_bytes\": " << run.peak_rss_bytes << "}\n";
+        out << "    }";
+    }
+    out << "\n  ]\n}\n";
+
+    return true;
+}
+
+bool ParseBenchOptions(int argc, char** argv, BenchOptions* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--frames" && has_value) {
+            options->frame_count = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--warmup" && has_value) {
+            options->warmup_count = std::max(std::atoi(argv[++i]), 0);
+        } else if (arg == "--size" && has_value) {
+            auto size = Split(argv[++i], "x");
+            if (size.size() == 2) {
+                options->width = std::max(std::atoi(size[0].c_str()), 1);
+                options->height = std::max(std::atoi(size[1].c_str()), 1);
+            }
+        } else if (arg == "--seed" && has_value) {
+            options->seed = (uint32_t)std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--output" && has_value) {
+            options->output = argv[++i];
+        } else if (arg == "--model" && has_value) {
+            options->model_path = argv[++i];
+        } else if (arg == "--scene" && has_value) {
+            options->scene = argv[++i];
+        } else {
+            SPDLOG_ERROR("usage: bench [--frames N] [--warmup N] [--size WxH] [--seed N] "
+                         "[--output FILE] [--model FILE] [--scene boxes|lights|model|shadows|"
+                         "streaming|textures|jobs|pools|scene_file]");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+// bench [--frames N] [--warmup N] [--size WxH] [--seed N] [--output FILE] [--model FILE]
+//       [--scene NAME]
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseBenchOptions(argc, argv, &options)) {
+        return -1;
+    }
+    auto gl = HeadlessGL::Create(options.width, options.height);
+    if (!gl) {
+        return -1;
+    }
+
+    Sections sections;
+    if (options.scene.empty() || options.scene == "jobs") {
+        auto& jobs = sections["jobs"] = RunJobs();
+        SPDLOG_INFO("jobs: submit {:.0f} ns, from a worker {:.0f} ns, chained {:.0f} ns",
+                    jobs["submit_ns"], jobs["worker_submit_ns"], jobs["chain_ns"]);
+    }
+    if (options.scene.empty() || options.scene == "pools") {
+        auto& pools = sections["pools"] = RunPools();
+        SPDLOG_INFO("pools: spawn {:.0f} ns, by handle {:.0f} ns, {:.2f} heap allocations each",
+                    pools["spawn_ns"], pools["handle_spawn_ns"],
+                    pools["heap_allocations_per_spawn"]);
+    }
+    if (options.scene.empty() || options.scene == "scene_file") {
+        auto& scene_file = sections["scene_file"] = RunSceneFile();
+        SPDLOG_INFO("scene file: {:.0f} objects load in {:.2f} ms, reading the file {:.2f} ms",
+                    scene_file["objects"], scene_file["load_ms"], scene_file["read_ms"]);
+    }
+
+    std::vector<Run> runs;
+    for (const auto& scene : Scenes(options)) {
+        if (!options.scene.empty() && options.scene != scene.name) {
+            continue;
+        }
+        if (!scene.desc.model_path.empty() && !std::filesystem::exists(scene.desc.model_path)) {
+            SPDLOG_WARN("skip scene {}, {} does not exist", scene.name, scene.desc.model_path);
+            continue;
+        }
+        if (!scene.desc.world_path.empty() && !BuildWorld(scene.desc.world_path, options.seed)) {
+            return -1;
+        }
+        if (scene.generated_texture && !BuildTexture(scene.desc.wood_texture_path)) {
+            return -1;
+        }
+        for (const auto& path : Paths()) {
+            SPDLOG_INFO("bench {} / {}: {} frames", scene.name, path.name, options.frame_count);
+            Run run;
+            if (!RunPath(options, scene, path, &run)) {
+                return -1;
+            }
+            SPDLOG_INFO("  cpu {:.3f} ms, gpu {:.3f} ms", Profiler::Summarize(run.frame_cpu_ms).avg,
+                        Profiler::Summarize(run.frame_gpu_ms).avg);
+            runs.push_back(std::move(run));
+        }
+    }
+    if (runs.empty() && sections.empty()) {
+        SPDLOG_ERROR("no scene to run");
+        return -1;
+    }
+
+    return WriteResults(options, runs, sections) ? 0 : -1;
+}
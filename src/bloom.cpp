@@ -0,0 +1,74 @@
+#include "bloom.hpp"
+
+std::unique_ptr<Bloom> Bloom::Create() {
+    auto bloom = std::unique_ptr<Bloom>(new Bloom());
+    if (!bloom->Init()) {
+        return nullptr;
+    }
+
+    return std::move(bloom);
+}
+
+size_t Bloom::LevelSizes(int width, int height, glm::ivec2* sizes) {
+    size_t count = 0;
+    // stop before a level gets too small to blur anything
+    for (int i = 1; i <= kMaxLevelCount && std::min(width >> i, height >> i) >= 8; ++i) {
+        sizes[count++] = glm::ivec2(width >> i, height >> i);
+    }
+
+    return count;
+}
+
+bool Bloom::Init() {
+    down_program_ = Program::Create("shader/post.vs", "shader/bloom_down.fs");
+    if (!down_program_) {
+        return false;
+    }
+
+    up_program_ = Program::Create("shader/post.vs", "shader/bloom_up.fs");
+    if (!up_program_) {
+        return false;
+    }
+
+    return true;
+}
+
+void Bloom::Render(const Texture2d* bright, Framebuffer* const* levels, size_t level_count,
+                   const Mesh* plane) {
+    if (level_count == 0) {
+        return;
+    }
+    auto transform = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f));
+    auto level = [&levels](size_t i) { return levels[i]->color_attachment(0); };
+    auto bind_level = [&](size_t i) {
+        levels[i]->Bind();
+        glViewport(0, 0, level(i)->width(), level(i)->height());
+    };
+
+    GlState::Get().ActiveTexture(0);
+    down_program_->Use();
+    down_program_->SetUniform("transform", transform);
+    down_program_->SetUniform("image", 0);
+    for (size_t i = 0; i < level_count; ++i) {
+        bind_level(i);
+        down_program_->SetUniform("karisAverage", i == 0);
+        if (i == 0) {
+            bright->Bind();
+        } else {
+            level(i - 1)->Bind();
+        }
+        plane->Draw(down_program_.get());
+    }
+
+    up_program_->Use();
+    up_program_->SetUniform("transform", transform);
+    up_program_->SetUniform("image", 0);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (size_t i = level_count - 1; i > 0; --i) {
+        bind_level(i - 1);
+        level(i)->Bind();
+        plane->Draw(up_program_.get());
+    }
+    glDisable(GL_BLEND);
+}
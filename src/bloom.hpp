@@ -0,0 +1,34 @@
+#ifndef INCLUDED_BLOOM_HPP
+#define INCLUDED_BLOOM_HPP
+
+#include "common.hpp"
+#include "framebuffer.hpp"
+#include "mesh.hpp"
+#include "program.hpp"
+
+// Progressive bloom over a chain of half, quarter, ... resolution targets. The bright color is
+// downsampled level by level with a 13 tap filter, then every level is tent-upsampled and added
+// onto the one above it, so the wide blur of the small levels costs only their few pixels.
+class Bloom {
+  public:
+    static const int kMaxLevelCount = 6;
+
+    static std::unique_ptr<Bloom> Create();
+    // sizes of the chain for a bright color of width x height, level 0 is half of it. sizes has
+    // room for kMaxLevelCount, returns how many levels there are
+    static size_t LevelSizes(int width, int height, glm::ivec2* sizes);
+
+    // levels: one RGBA16F color target per LevelSizes entry, the result ends up in levels[0]
+    // and the viewport at its size
+    void Render(const Texture2d* bright, Framebuffer* const* levels, size_t level_count,
+                const Mesh* plane);
+
+  private:
+    Bloom() {}
+    bool Init();
+
+    std::unique_ptr<Program> down_program_{nullptr};
+    std::unique_ptr<Program> up_program_{nullptr};
+};
+
+#endif
@@ -32,6 +32,8 @@ class BoundingSphere {
         return {};
     }
 
+    inline float radius() const { return radius_; }
+
   private:
     BoundingSphere(const float radius) : radius_(radius) {}
 
@@ -25,4 +25,32 @@ void Buffer::Init(uint32_t buffer_type, uint32_t usage, const void* data, size_t
     glGenBuffers(1, &id_);
     Bind();
     glBufferData(buffer_type_, stride_ * count_, data, usage);
-}
\ No newline at end of file
+}
+
+void Buffer::Upload(const void* data, size_t size, size_t offset) const {
+    Bind();
+    glBufferSubData(buffer_type_, offset, size, data);
+    GlState::Get().CountBufferUpload(size);
+}
+
+void Buffer::Orphan(const void* data, size_t size) {
+    Bind();
+    if (size > stride_ * count_) {
+        count_ = (size + stride_ - 1) / stride_;
+    }
+    glBufferData(buffer_type_, stride_ * count_, nullptr, usage_);
+    if (data) {
+        glBufferSubData(buffer_type_, 0, size, data);
+        GlState::Get().CountBufferUpload(size);
+    }
+}
+
+void* Buffer::Map(size_t offset, size_t size, uint32_t access) const {
+    Bind();
+    return glMapBufferRange(buffer_type_, offset, size, access);
+}
+
+void Buffer::Unmap() const {
+    Bind();
+    glUnmapBuffer(buffer_type_);
+}
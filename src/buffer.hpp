@@ -2,6 +2,7 @@
 #define INCLUDED_BUFFER_HPP
 
 #include "common.hpp"
+#include "gl_state.hpp"
 
 class Buffer {
   public:
@@ -9,11 +10,21 @@ class Buffer {
     static std::unique_ptr<Buffer> Create(uint32_t buffer_type, uint32_t usage, const void* data,
                                           size_t stride, size_t count);
 
-    inline void Bind() const { glBindBuffer(buffer_type_, id_); }
+    inline void Bind() const {
+        glBindBuffer(buffer_type_, id_);
+        GlState::Get().CountBufferBind();
+    }
+    // glBufferSubData, may stall if the GPU still reads the range
+    void Upload(const void* data, size_t size, size_t offset = 0) const;
+    // gives the old storage back to the driver before refilling, so in-flight draws keep theirs
+    void Orphan(const void* data, size_t size);
+    void* Map(size_t offset, size_t size, uint32_t access) const;
+    void Unmap() const;
 
     inline const uint32_t id() const { return id_; }
     inline size_t stride() const { return stride_; }
     inline size_t count() const { return count_; }
+    inline size_t size() const { return stride_ * count_; }
 
   private:
     Buffer();
@@ -28,23 +28,24 @@ struct Camera {
 
     inline void SetMove(CameraMove type) { move_status_ |= type; }
     inline void UnsetMove(CameraMove type) { move_status_ &= ~type; }
-    void Move() {
+    void Move(float seconds) {
         if (move_status_ == kNone)
             return;
+        float distance = move_speed_ * seconds;
         if (move_status_ & kFront)
-            position_ += move_speed_ * front_;
+            position_ += distance * front_;
         if (move_status_ & kBack)
-            position_ -= move_speed_ * front_;
+            position_ -= distance * front_;
         glm::vec3 cameraRight = glm::normalize(glm::cross(up_, -front_));
         if (move_status_ & kLeft)
-            position_ -= move_speed_ * cameraRight;
+            position_ -= distance * cameraRight;
         if (move_status_ & kRight)
-            position_ += move_speed_ * cameraRight;
+            position_ += distance * cameraRight;
         glm::vec3 cameraUp = glm::cross(-front_, cameraRight);
         if (move_status_ & kUp)
-            position_ += move_speed_ * cameraUp;
+            position_ += distance * cameraUp;
         if (move_status_ & kDown)
-            position_ -= move_speed_ * cameraUp;
+            position_ -= distance * cameraUp;
     }
 
     void Rotate(glm::vec2 delta) {
@@ -79,7 +80,7 @@ struct Camera {
     float near_plane_{0.1f};
     float far_plane_{200.0f};
     unsigned char move_status_{0};
-    float move_speed_{0.1f};
+    float move_speed_{6.0f}; // per second
     float rot_speed_{0.15f};
     glm::vec3 position_{0.0f, 1.5f, 5.0f};
     mutable glm::vec3 front_{0.0f, 0.0f, -1.0f};
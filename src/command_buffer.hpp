@@ -0,0 +1,83 @@
+#ifndef INCLUDED_COMMAND_BUFFER_HPP
+#define INCLUDED_COMMAND_BUFFER_HPP
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+// Linear arena of POD commands, recorded by one thread and replayed by another. Every command is
+// a header with its type and size followed by the command bytes; what a type means is up to the
+// recorder and the replayer, the buffer knows no GL. Reset keeps the memory, so a buffer recorded
+// every frame stops allocating after the first few.
+//
+// A command struct is trivially copyable and names its type in `kType`.
+class CommandBuffer {
+  public:
+    struct Header {
+        uint32_t type;
+        uint32_t size; // of header and command, padded
+    };
+
+    void Reset() {
+        size_ = 0;
+        count_ = 0;
+    }
+
+    template <typename T> void Record(const T& command) {
+        static_assert(std::is_trivially_copyable<T>::value, "commands are copied as bytes");
+        size_t size = Padded(sizeof(Header) + sizeof(T));
+        Reserve(size_ + size);
+        Header header{T::kType, (uint32_t)size};
+        memcpy(data_.get() + size_, &header, sizeof(header));
+        memcpy(data_.get() + size_ + sizeof(Header), &command, sizeof(T));
+        size_ += size;
+        ++count_;
+    }
+
+    // calls func(type, bytes) for every command in recording order, Read turns the bytes back
+    template <typename F> void ForEach(F&& func) const {
+        for (size_t offset = 0; offset < size_;) {
+            Header header;
+            memcpy(&header, data_.get() + offset, sizeof(header));
+            func(header.type, data_.get() + offset + sizeof(Header));
+            offset += header.size;
+        }
+    }
+    template <typename T> static T Read(const uint8_t* bytes) {
+        T command;
+        memcpy(&command, bytes, sizeof(T));
+        return command;
+    }
+
+    inline size_t count() const { return count_; }
+    inline size_t size() const { return size_; }
+    inline size_t capacity() const { return capacity_; }
+
+  private:
+    static size_t Padded(size_t size) { return (size + 7) & ~(size_t)7; }
+
+    void Reserve(size_t size) {
+        if (size <= capacity_) {
+            return;
+        }
+        size_t capacity = std::max<size_t>(capacity_ * 2, 4096);
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        auto data = std::make_unique<uint8_t[]>(capacity);
+        if (size_ > 0) {
+            memcpy(data.get(), data_.get(), size_);
+        }
+        data_ = std::move(data);
+        capacity_ = capacity;
+    }
+
+    std::unique_ptr<uint8_t[]> data_{nullptr};
+    size_t size_{0};
+    size_t capacity_{0};
+    size_t count_{0};
+};
+
+#endif
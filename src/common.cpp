@@ -33,10 +33,33 @@ std::vector<std::string> Split(const std::string& s, const std::string& sep = "
     return ret;
 }
 
-double UniformRandom(double min, double max) {
+std::string JsonString(const std::string& text) {
+    std::string escaped = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+namespace {
+
+std::mt19937& RandomEngine() {
     static std::random_device rd;
     static std::mt19937 gen(rd());
+
+    return gen;
+}
+
+} // namespace
+
+void SeedRandom(uint32_t seed) { RandomEngine().seed(seed); }
+
+double UniformRandom(double min, double max) {
     std::uniform_real_distribution<> dis(min, max);
 
-    return dis(gen);
+    return dis(RandomEngine());
 }
\ No newline at end of file
@@ -22,6 +22,10 @@
 
 std::optional<std::string> LoadTextFile(const std::string& filename);
 std::vector<std::string> Split(const std::string& s, const std::string& sep);
+// text in quotes with quotes and backslashes escaped, for JSON writers
+std::string JsonString(const std::string& text);
+// UniformRandom draws from a std::random_device seed until SeedRandom fixes the sequence
+void SeedRandom(uint32_t seed);
 double UniformRandom(double min, double max);
 
 #endif
@@ -1,9 +1,27 @@
 #include "context.hpp"
 
 #include "image.hpp"
+#include "thread_pool.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <imgui.h>
 
+namespace {
+
+// std140 entry of the LightVolumes block in light_volume.vs / .fs
+struct LightVolume {
+    glm::vec4 position_radius;
+    glm::vec4 color;
+};
+
+static_assert(sizeof(LightVolume) == sizeof(SceneFile::PointLight), "uploaded as they are");
+
+const int kMaxLightVolumes = 256;
+const uint32_t kLightVolumeBinding = 1;
+
+} // namespace
+
 Context::Context() {
     clear_bit_ = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT;
     glClearColor(clear_color_[0], clear_color_[1], clear_color_[2], clear_color_[3]);
@@ -11,41 +29,33 @@ Context::Context() {
 
 Context::~Context() {}
 
-std::unique_ptr<Context> Context::Create() {
+std::unique_ptr<Context> Context::Create(const SceneDesc& scene) {
     auto context = std::unique_ptr<Context>(new Context());
-    if (!context->Init()) {
+    if (!context->Init(scene)) {
         return nullptr;
     }
 
     return std::move(context);
 }
 
-bool Context::Init() {
-    gaussian_blur_framebuffer_[0] =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
-    if (!gaussian_blur_framebuffer_[0]) {
-        return false;
-    }
-
-    gaussian_blur_framebuffer_[1] =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
-    if (!gaussian_blur_framebuffer_[1]) {
-        return false;
+bool Context::Init(const SceneDesc& scene) {
+    if (scene.seed != 0) {
+        SeedRandom(scene.seed);
     }
+    is_deferred_ = scene.deferred;
+    light_volume_count_ = std::clamp(scene.light_count, 0, kMaxLightVolumes);
 
-    gaussian_blur_program_ = Program::Create("shader/gaussian_blur.vs", "shader/gaussian_blur.fs");
-    if (!gaussian_blur_program_) {
-        return false;
-    }
+    profiler_ = Profiler::Create();
+    frame_arena_ = FrameArena::Create();
+    frame_graph_ = FrameGraph::Create(frame_arena_.get());
+    frame_graph_->set_profiler(profiler_.get());
 
-    framebuffer_ =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT),
-                             Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
-    if (!framebuffer_) {
+    bloom_pass_ = Bloom::Create();
+    if (!bloom_pass_) {
         return false;
     }
 
-    index_framebuffer_ = Framebuffer::Create({Texture2d::Create(width_, height_)});
+    index_framebuffer_ = CreateIndexFramebuffer(width_, height_);
     if (!index_framebuffer_) {
         return false;
     }
@@ -55,13 +65,13 @@ bool Context::Init() {
         return false;
     }
 
-    depth_3d_map_ = DepthMap3d::Create(1024);
+    depth_3d_map_ = DepthMap3d::Create(scene.shadow_map_size);
     if (!depth_3d_map_) {
         return false;
     }
 
-    lighting_program_ =
-        Program::Create("shader/lighting.vs", "shader/lighting.fs", "shader/lighting.gs");
+    lighting_program_ = Program::CreateFromFiles(
+        {"shader/lighting.vs", "shader/lighting.gs", "shader/lighting.fs", "shader/material.fs"});
     if (!lighting_program_) {
         return false;
     }
@@ -103,6 +113,89 @@ bool Context::Init() {
         return false;
     }
 
+    // the generated scene, plus what the world budget lets stream in for every pass that submits
+    // the objects: shadow, depth, lit, index and the occlusion retests
+    size_t max_draws = 16 * 1024;
+    if (!scene.world_path.empty()) {
+        max_draws += WorldPartition::ObjectCapacity(scene.world_budget_bytes) * 6;
+    }
+    draw_list_ = DrawList::Create(max_draws);
+    if (!draw_list_) {
+        return false;
+    }
+
+    overdraw_counter_ = OverdrawCounter::Create();
+
+    if (draw_list_->indirect()) {
+        // no pass-through geometry shader, it would have to forward materialIndex
+        lighting_indirect_program_ = Program::CreateFromFiles(
+            {"shader/lighting_indirect.vs", "shader/lighting.fs", "shader/material_indirect.fs"});
+        if (!lighting_indirect_program_) {
+            return false;
+        }
+
+        simple_indirect_program_ =
+            Program::Create("shader/simple_indirect.vs", "shader/simple_indirect.fs");
+        if (!simple_indirect_program_) {
+            return false;
+        }
+
+        depth_3d_indirect_program_ =
+            Program::Create("shader/omni_depth_map_indirect.vs", "shader/omni_depth_map.fs",
+                            "shader/omni_depth_map.gs");
+        if (!depth_3d_indirect_program_) {
+            return false;
+        }
+
+        feedback_indirect_program_ =
+            Program::Create("shader/feedback_indirect.vs", "shader/feedback.fs");
+        if (!feedback_indirect_program_) {
+            return false;
+        }
+
+        hiz_ = HiZBuffer::Create(width_, height_);
+        if (!hiz_) {
+            return false;
+        }
+
+        gbuffer_indirect_program_ = Program::CreateFromFiles(
+            {"shader/lighting_indirect.vs", "shader/gbuffer.fs", "shader/material_indirect.fs"});
+        if (!gbuffer_indirect_program_) {
+            return false;
+        }
+    }
+
+    gbuffer_program_ = Program::CreateFromFiles(
+        {"shader/lighting.vs", "shader/gbuffer.fs", "shader/material.fs"});
+    if (!gbuffer_program_) {
+        return false;
+    }
+
+    deferred_light_program_ = Program::Create("shader/post.vs", "shader/deferred_light.fs");
+    if (!deferred_light_program_) {
+        return false;
+    }
+
+    light_volume_program_ = Program::Create("shader/light_volume.vs", "shader/light_volume.fs");
+    if (!light_volume_program_) {
+        return false;
+    }
+
+    feedback_program_ = Program::Create("shader/feedback.vs", "shader/feedback.fs");
+    if (!feedback_program_) {
+        return false;
+    }
+    if (TextureStreamer::IsSupported()) {
+        TextureStreamer::Desc texture_desc;
+        texture_desc.budget_bytes = scene.texture_budget_bytes;
+        texture_streamer_ = TextureStreamer::Create(width_, height_, texture_desc);
+        if (!texture_streamer_) {
+            return false;
+        }
+    } else {
+        SPDLOG_INFO("texture streaming unavailable, loading textures whole");
+    }
+
     { // cube texture
         auto cubeRight = Image::Load("./image/cube_texture/right.jpg", false);
         auto cubeLeft = Image::Load("./image/cube_texture/left.jpg", false);
@@ -133,7 +226,11 @@ bool Context::Init() {
         auto mat = Material::Create();
         mat->specular_ = Texture2d::Create(
             Image::CreateSingleColorImage(4, 4, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)).get());
-        mat->diffuse_ = Texture2d::Create("image/wood.png");
+        if (texture_streamer_) {
+            mat->diffuse_ = texture_streamer_->Add(scene.wood_texture_path);
+        } else {
+            mat->diffuse_ = Texture2d::Create(scene.wood_texture_path);
+        }
         wood_box_ = Mesh::CreateBox();
         wood_box_->set_material(std::move(mat));
     }
@@ -150,26 +247,98 @@ bool Context::Init() {
     { // plane mesh
         plane_ = Mesh::CreatePlane();
     }
-    // {  // model
-    //   model_ = Model::Load("model/backpack/backpack.obj");
-    //   if (!model_) {
-    //     return false;
-    //   }
-    // }
-    // for (size_t i = 0; i < model_->meshes_count(); ++i) {
-    //   auto m = Object::Create(model_->mesh(i));
-    //   objects_.push_back(m);
-    // }
 
+    if (!scene.model_path.empty()) { // model, e.g. model/backpack/backpack.obj
+        model_ = Model::Load(scene.model_path, texture_streamer_.get());
+        if (!model_) {
+            return false;
+        }
+    }
+    if (!scene.scene_path.empty()) {
+        if (!LoadScene(scene.scene_path)) {
+            return false;
+        }
+    } else {
+        GenerateScene(scene);
+    }
+    if (!scene.world_path.empty()) {
+        // a snapshot, the loads resolve names on the thread pool
+        auto named = NamedMeshes();
+        auto resolver = [named](const char* name) -> std::shared_ptr<Mesh> {
+            for (const auto& [mesh_name, mesh] : named) {
+                if (mesh_name == name) {
+                    return mesh;
+                }
+            }
+            return nullptr;
+        };
+        WorldPartition::Desc desc;
+        desc.budget_bytes = scene.world_budget_bytes;
+        world_ = WorldPartition::Create(scene.world_path, resolver, desc);
+        if (!world_) {
+            return false;
+        }
+        base_object_count_ = objects_.size();
+    }
+    // point lights of the deferred path, drawn as instanced sphere volumes
+    light_volume_buffer_ = Buffer::Create(GL_UNIFORM_BUFFER, GL_STATIC_DRAW, point_lights_.data(),
+                                          sizeof(LightVolume), point_lights_.size());
+    light_volume_mesh_ = Mesh::CreateSphere(12, 8);
+
+    // shader에 uniform block 연결, binding point 0번
+    glUniformBlockBinding(simple_program_->id(),
+                          glGetUniformBlockIndex(simple_program_->id(), "Transform"), 0);
+    glUniformBlockBinding(gbuffer_program_->id(),
+                          glGetUniformBlockIndex(gbuffer_program_->id(), "Transform"), 0);
+    glUniformBlockBinding(light_volume_program_->id(),
+                          glGetUniformBlockIndex(light_volume_program_->id(), "Transform"), 0);
+    glUniformBlockBinding(light_volume_program_->id(),
+                          glGetUniformBlockIndex(light_volume_program_->id(), "LightVolumes"),
+                          kLightVolumeBinding);
+    glUniformBlockBinding(lighting_program_->id(),
+                          glGetUniformBlockIndex(lighting_program_->id(), "Transform"), 0);
+    glUniformBlockBinding(cube_program_->id(),
+                          glGetUniformBlockIndex(cube_program_->id(), "Transform"), 0);
+    if (draw_list_->indirect()) {
+        glUniformBlockBinding(
+            lighting_indirect_program_->id(),
+            glGetUniformBlockIndex(lighting_indirect_program_->id(), "Transform"), 0);
+        glUniformBlockBinding(simple_indirect_program_->id(),
+                              glGetUniformBlockIndex(simple_indirect_program_->id(), "Transform"),
+                              0);
+        glUniformBlockBinding(
+            gbuffer_indirect_program_->id(),
+            glGetUniformBlockIndex(gbuffer_indirect_program_->id(), "Transform"), 0);
+    }
+
+    // 패스마다 view/projection을 새 구간에 쓰고 binding point 0번에 range로 연결
+    ubo_transform_ = DynamicBuffer::Create(GL_UNIFORM_BUFFER, 4 * 1024);
+    if (!ubo_transform_) {
+        return false;
+    }
+
+    return true;
+}
+
+void Context::GenerateScene(const SceneDesc& scene) {
     glm::vec3 center = glm::vec3(0.0f, 20.0f, 0.0f);
 
+    if (model_) {
+        for (size_t i = 0; i < model_->meshes_count(); ++i) {
+            auto object = Object::Create(model_->mesh(i));
+            object->transform().translate_ = center - glm::vec3(0.0f, 10.0f, 0.0f);
+            object->transform().scale_ = glm::vec3(3.0f);
+            objects_.push_back(object);
+        }
+    }
+
     light_ = Light::Create(sphere_);
     light_->CreateBoundingSphere(0.5f);
     light_->transform().translate_ = center;
     light_->transform().scale_ = glm::vec3(0.5f);
     objects_.push_back(light_);
 
-    for (int i = 0; i < 100; ++i) {
+    for (int i = 0; i < scene.box_count; ++i) {
         auto box = Object::Create(box_);
         box->transform().translate_ =
             center + glm::vec3(UniformRandom(-25.0f, 25.0f), UniformRandom(-15.0f, 0.0f),
@@ -185,263 +354,464 @@ bool Context::Init() {
     {
         float wall_size = 50.0f;
         float wall_t = wall_size / 2.0f;
-        // auto top = Object::Create(wood_box_);
-        // top->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // top->transform().translate_ = (glm::vec3(0.0f, wall_t, 0.0f));
-        // top->transform().set_rotate(glm::vec3(0.0f, 0.0f, 0.0f));
-        // objects_.push_back(top);
-
-        auto bottom = Object::Create(wood_box_);
-        bottom->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // bottom->transform().translate_ = (glm::vec3(0.0f, -wall_t, 0.0f));
-        bottom->transform().translate_ = (glm::vec3(0.0f, 0.0f, 0.0f));
-        bottom->transform().set_rotate(glm::vec3(0.0f, 0.0f, 0.0f));
-        objects_.push_back(bottom);
-
-        // auto front = Object::Create(wood_box_);
-        // front->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // front->transform().translate_ = (glm::vec3(0.0f, 0.0f, wall_t));
-        // front->transform().set_rotate(glm::vec3(90.0f, 0.0f, 0.0f));
-        // objects_.push_back(front);
-
-        // auto back = Object::Create(wood_box_);
-        // back->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // back->transform().translate_ = (glm::vec3(0.0f, 0.0f, -wall_t));
-        // back->transform().set_rotate(glm::vec3(90.0f, 0.0f, 0.0f));
-        // objects_.push_back(back);
-
-        // auto left = Object::Create(wood_box_);
-        // left->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // left->transform().translate_ = (glm::vec3(-wall_t, 0.0f, 0.0f));
-        // left->transform().set_rotate(glm::vec3(0.0f, 0.0f, 90.0f));
-        // objects_.push_back(left);
-
-        // auto right = Object::Create(wood_box_);
-        // right->transform().scale_ = (glm::vec3(wall_size, 0.5f, wall_size));
-        // right->transform().translate_ = (glm::vec3(wall_t, 0.0f, 0.0f));
-        // right->transform().set_rotate(glm::vec3(0.0f, 0.0f, 90.0f));
-        // objects_.push_back(right);
+        auto add_wall = [&](glm::vec3 translate, glm::vec3 rotate) {
+            auto wall = Object::Create(wood_box_);
+            wall->transform().scale_ = glm::vec3(wall_size, 0.5f, wall_size);
+            wall->transform().translate_ = translate;
+            wall->transform().set_rotate(rotate);
+            objects_.push_back(wall);
+        };
+        add_wall(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f)); // bottom
+        if (scene.closed_room) {
+            add_wall(glm::vec3(0.0f, wall_size, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+            add_wall(glm::vec3(0.0f, wall_t, wall_t), glm::vec3(90.0f, 0.0f, 0.0f));
+            add_wall(glm::vec3(0.0f, wall_t, -wall_t), glm::vec3(90.0f, 0.0f, 0.0f));
+            add_wall(glm::vec3(-wall_t, wall_t, 0.0f), glm::vec3(0.0f, 0.0f, 90.0f));
+            add_wall(glm::vec3(wall_t, wall_t, 0.0f), glm::vec3(0.0f, 0.0f, 90.0f));
+        }
     }
 
-    // shader에 uniform block 연결, binding point 0번
-    glUniformBlockBinding(simple_program_->id(),
-                          glGetUniformBlockIndex(simple_program_->id(), "Transform"), 0);
-    glUniformBlockBinding(lighting_program_->id(),
-                          glGetUniformBlockIndex(lighting_program_->id(), "Transform"), 0);
-    glUniformBlockBinding(cube_program_->id(),
-                          glGetUniformBlockIndex(cube_program_->id(), "Transform"), 0);
-
-    ubo_transform_ = Buffer::Create(GL_UNIFORM_BUFFER, GL_STATIC_DRAW, NULL, sizeof(glm::mat4), 2);
-    // ubo를 bingding point 0번
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, ubo_transform_->id());
-
-    return true;
+    point_lights_.resize(kMaxLightVolumes);
+    for (auto& light : point_lights_) {
+        glm::vec4 position_radius = glm::vec4(
+            center + glm::vec3(UniformRandom(-25.0f, 25.0f), UniformRandom(-18.0f, -10.0f),
+                               UniformRandom(-25.0f, 25.0f)),
+            UniformRandom(3.0f, 8.0f));
+        glm::vec4 color = glm::vec4(UniformRandom(0.2f, 1.0f), UniformRandom(0.2f, 1.0f),
+                                    UniformRandom(0.2f, 1.0f), 1.0f) *
+                          10.0f;
+        memcpy(light.position_radius, glm::value_ptr(position_radius), sizeof(glm::vec4));
+        memcpy(light.color, glm::value_ptr(color), sizeof(glm::vec4));
+    }
 }
 
-void Context::Update() { camera_.Move(); }
-
-void Context::Render() {
-    RenderImGui();
-    RenderDepthMap();
-
-    framebuffer_->Bind();
-    glEnable(GL_DEPTH_TEST);
-    // glEnable(GL_BLEND);
-    // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glClearColor(clear_color_.r, clear_color_.g, clear_color_.b, clear_color_.a);
-    glClear(clear_bit_);
+std::vector<std::pair<std::string, std::shared_ptr<Mesh>>> Context::NamedMeshes() const {
+    std::vector<std::pair<std::string, std::shared_ptr<Mesh>>> meshes = {
+        {"box", box_}, {"wood_box", wood_box_}, {"sphere", sphere_}, {"plane", plane_}};
+    for (size_t i = 0; model_ && i < model_->meshes_count(); ++i) {
+        meshes.emplace_back("model/" + std::to_string(i), model_->mesh(i));
+    }
 
-    auto projection = camera_.GetPerspectiveProjectionMatrix();
-    auto view = camera_.GetViewMatrix();
-    // copy
-    ubo_transform_->Bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(view));
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
-                    glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return meshes;
+}
 
-    { // cube program
-        glActiveTexture(GL_TEXTURE0);
-        cube_texture_->Bind();
+// the records are used straight from the mapped file, what is left is making the objects
+bool Context::LoadScene(const std::string& filename) {
+    auto file = SceneFile::Load(filename);
+    if (!file) {
+        return false;
+    }
 
-        auto model = glm::translate(glm::mat4(1.0), camera_.position_) *
-                     glm::scale(glm::mat4(1.0), glm::vec3(200.0f));
-        cube_program_->Use();
-        cube_program_->SetUniform("cube", 0);
-        cube_program_->SetUniform("model", model);
-        sphere_->Draw(cube_program_.get());
-        glActiveTexture(GL_TEXTURE0);
+    auto named = NamedMeshes();
+    auto find = [&named](const char* name) -> std::shared_ptr<Mesh> {
+        for (const auto& [mesh_name, mesh] : named) {
+            if (mesh_name == name) {
+                return mesh;
+            }
+        }
+        return nullptr;
+    };
+    std::vector<std::shared_ptr<Mesh>> meshes(file->mesh_count());
+    for (size_t i = 0; i < file->mesh_count(); ++i) {
+        const auto& record = file->meshes()[i];
+        meshes[i] = find(file->string(record.name));
+        if (!meshes[i]) {
+            SPDLOG_ERROR("{}: no mesh {}, the scene may need its model", filename,
+                         file->string(record.name));
+            return false;
+        }
+        if (record.material < file->material_count()) {
+            const auto& material = file->materials()[record.material];
+            auto owner = find(file->string(material.name));
+            if (owner && owner->material()) {
+                owner->material()->set_shininess(material.shininess);
+                meshes[i]->set_material(owner->material());
+            }
+        }
     }
-    { // simple program
-        simple_program_->Use();
-        if (is_hit_) {
-            auto model = glm::translate(glm::mat4(1.0), hit_point_) *
-                         glm::scale(glm::mat4(1.0), glm::vec3(0.1f));
-            simple_program_->SetUniform("color", glm::vec4(0.2f, 0.3f, 0.4f, 1.0f));
-            simple_program_->SetUniform("model", model);
-            sphere_->Draw(simple_program_.get());
+
+    // the first light is the one the forward path lights with
+    uint32_t light_object = SceneFile::kNone;
+    if (file->light_count() > 0) {
+        light_object = file->lights()[0].object;
+        if (file->light_count() > 1) {
+            SPDLOG_WARN("{}: {} lights, only the first is used", filename, file->light_count());
         }
     }
+    if (light_object >= file->object_count()) {
+        SPDLOG_ERROR("{}: no light", filename);
+        return false;
+    }
 
-    { // lighting program
-        lighting_program_->Use();
-        lighting_program_->SetUniform("lightType", light_->type());
-        lighting_program_->SetUniform("viewPos", camera_.position_);
-        lighting_program_->SetUniform("light.position", light_->position());
-        lighting_program_->SetUniform("light.direction", light_->direction());
-        lighting_program_->SetUniform(
-            "light.cutoff", glm::vec2(cosf(glm::radians(light_->cutoff[0])),
-                                      cosf(glm::radians(light_->cutoff[0] + light_->cutoff[1]))));
-        lighting_program_->SetUniform("light.constant", light_->constant);
-        lighting_program_->SetUniform("light.linear", light_->linear);
-        lighting_program_->SetUniform("light.quadratic", light_->quadratic);
-        lighting_program_->SetUniform("light.ambient", light_->ambient);
-        lighting_program_->SetUniform("light.diffuse", light_->diffuse);
-        lighting_program_->SetUniform("light.specular", light_->specular);
-        lighting_program_->SetUniform("isBlinn", is_blinn_);
-        lighting_program_->SetUniform("isShadow", is_active_shadow_);
-        glActiveTexture(GL_TEXTURE3);
-        depth_2d_map_->depth_map()->Bind();
-        lighting_program_->SetUniform("depthMap", 3);
-        auto rm = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-        auto lightView = glm::lookAt(light_->position(), light_->position() + light_->direction(),
-                                     glm::vec3(glm::vec4(light_->direction(), 0.0f) * rm));
-        glm::mat4 lightProjection;
-        if (light_->type() == kDirectional) {
-            lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 20.0f);
+    objects_.reserve(file->object_count());
+    for (size_t i = 0; i < file->object_count(); ++i) {
+        const auto& record = file->objects()[i];
+        if (record.mesh >= meshes.size()) {
+            SPDLOG_ERROR("{}: object {} has no mesh", filename, i);
+            return false;
+        }
+        std::shared_ptr<Object> object;
+        if (i == light_object) {
+            const auto& light = file->lights()[0];
+            light_ = Light::Create(meshes[record.mesh]);
+            light_->type() = (LightType)light.type;
+            light_->ambient = glm::make_vec3(light.ambient);
+            light_->diffuse = glm::make_vec3(light.diffuse);
+            light_->specular = glm::make_vec3(light.specular);
+            light_->cutoff = glm::make_vec2(light.cutoff);
+            object = light_;
         } else {
-            lightProjection = glm::perspective(
-                glm::radians((light_->cutoff[0] + light_->cutoff[1]) * 2.0f), 1.0f, 1.0f, 20.0f);
+            object = Object::Create(meshes[record.mesh]);
         }
-        lighting_program_->SetUniform("lightTransform", lightProjection * lightView);
-        glActiveTexture(GL_TEXTURE0);
-
-        glActiveTexture(GL_TEXTURE4);
-        depth_3d_map_->depth_map()->Bind();
-        lighting_program_->SetUniform("depthMap3d", 4);
-        glActiveTexture(GL_TEXTURE0);
-        lighting_program_->SetUniform("far_plane", 25.0f);
-
-        for (const auto& object : objects_) {
-            if (object != pick_object_) {
-                lighting_program_->SetUniform("model", object->transform().ModelMatrix());
-                object->Draw(lighting_program_.get());
-            }
+        auto& transform = object->transform();
+        transform.translate_ = glm::make_vec3(record.translate);
+        transform.set_rotate(glm::make_quat(record.rotate));
+        transform.scale_ = glm::make_vec3(record.scale);
+        if (record.bounding_radius > 0.0f) {
+            object->CreateBoundingSphere(record.bounding_radius);
         }
-        if (pick_object_) {
-            glEnable(GL_STENCIL_TEST);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-            glStencilFunc(GL_ALWAYS, 1, 0xFF);
-            glStencilMask(0xFF);
+        objects_.push_back(std::move(object));
+    }
 
-            auto modelTransform = pick_object_->transform().ModelMatrix();
-            lighting_program_->SetUniform("model", modelTransform);
-            pick_object_->Draw(lighting_program_.get());
+    point_lights_.assign(file->point_lights(),
+                         file->point_lights() +
+                             std::min(file->point_light_count(), (size_t)kMaxLightVolumes));
+    point_lights_.resize(kMaxLightVolumes, SceneFile::PointLight{});
+    SPDLOG_INFO("loaded {}: {} objects, {} point lights", filename, objects_.size(),
+                file->point_light_count());
 
-            glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
-            glStencilMask(0x00);
-            simple_program_->Use();
-            simple_program_->SetUniform("color", glm::vec4(0.8f, 0.8f, 0.4f, 1.0f));
-            simple_program_->SetUniform(
-                "model",
-                modelTransform * glm::scale(glm::mat4(1.0f), glm::vec3(1.05f, 1.05f, 1.05f)));
-            pick_object_->Draw(simple_program_.get());
+    return true;
+}
 
-            glDisable(GL_STENCIL_TEST);
-            glStencilFunc(GL_ALWAYS, 1, 0xFF);
-            glStencilMask(0xFF);
+bool Context::SceneContents(SceneFile::Contents* out) const {
+    SceneFile::Contents& contents = *out;
+    auto named = NamedMeshes();
+    // meshes and materials the objects use, in the order they come up
+    std::vector<std::pair<const Mesh*, uint32_t>> meshes;
+    std::vector<std::pair<const Material*, uint32_t>> materials;
+    auto mesh_index = [&](const Mesh* mesh) -> uint32_t {
+        for (const auto& [known, index] : meshes) {
+            if (known == mesh) {
+                return index;
+            }
         }
-
-        if (is_show_vertex_normal_) {
-            vertex_normal_program_->Use();
-            for (const auto& object : objects_) {
-                vertex_normal_program_->SetUniform("length", 0.1f);
-                vertex_normal_program_->SetUniform(
-                    "transform", projection * view * object->transform().ModelMatrix());
-                object->Draw(vertex_normal_program_.get());
+        const std::string* name = nullptr;
+        for (const auto& entry : named) {
+            if (entry.second.get() == mesh) {
+                name = &entry.first;
+                break;
+            }
+        }
+        if (!name) {
+            return SceneFile::kNone;
+        }
+        SceneFile::Mesh record{contents.AddString(*name), SceneFile::kNone};
+        if (const Material* material = mesh->material().get()) {
+            for (const auto& [known, index] : materials) {
+                if (known == material) {
+                    record.material = index;
+                }
+            }
+            for (size_t i = 0; record.material == SceneFile::kNone && i < named.size(); ++i) {
+                if (named[i].second->material().get() == material) {
+                    record.material = (uint32_t)contents.materials.size();
+                    contents.materials.push_back(SceneFile::Material{
+                        contents.AddString(named[i].first), material->shininess()});
+                    materials.emplace_back(material, record.material);
+                }
             }
         }
+        meshes.emplace_back(mesh, (uint32_t)contents.meshes.size());
+        contents.meshes.push_back(record);
+        return meshes.back().second;
+    };
+
+    contents.objects.reserve(objects_.size());
+    for (const auto& object : objects_) {
+        SceneFile::Object record;
+        record.mesh = mesh_index(object->mesh().get());
+        if (record.mesh == SceneFile::kNone) {
+            SPDLOG_ERROR("failed to save the scene, an object has a mesh without a name");
+            return false;
+        }
+        const auto& transform = object->transform();
+        memcpy(record.translate, glm::value_ptr(transform.translate_), sizeof(record.translate));
+        memcpy(record.rotate, glm::value_ptr(transform.quat_), sizeof(record.rotate));
+        memcpy(record.scale, glm::value_ptr(transform.scale_), sizeof(record.scale));
+        record.bounding_radius = object->bounding_radius();
+        if (object == light_) {
+            SceneFile::Light light;
+            light.object = (uint32_t)contents.objects.size();
+            light.type = (uint32_t)light_->type();
+            memcpy(light.ambient, glm::value_ptr(light_->ambient), sizeof(light.ambient));
+            memcpy(light.diffuse, glm::value_ptr(light_->diffuse), sizeof(light.diffuse));
+            memcpy(light.specular, glm::value_ptr(light_->specular), sizeof(light.specular));
+            memcpy(light.cutoff, glm::value_ptr(light_->cutoff), sizeof(light.cutoff));
+            contents.lights.push_back(light);
+        }
+        contents.objects.push_back(record);
     }
+    contents.point_lights = point_lights_;
 
-    index_framebuffer_->Bind();
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-    glClear(clear_bit_);
-    simple_program_->Use();
-    size_t index = 0;
+    return true;
+}
 
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+bool Context::SaveScene(const std::string& filename, bool json) const {
+    SceneFile::Contents contents;
+    if (!SceneContents(&contents) || !SceneFile::Save(filename, contents)) {
+        return false;
+    }
+    if (json) {
+        auto file = SceneFile::Load(filename);
+        return file && file->SaveJson(filename + ".json");
+    }
 
-    for (const auto& object : objects_) {
-        auto rgba = IdToRGBA(object->id());
-        uint8_t r = rgba[0];
-        uint8_t g = rgba[1];
-        uint8_t b = rgba[2];
-        uint8_t a = rgba[3];
-        simple_program_->SetUniform(
-            "color", glm::vec4((float)r / 255, (float)g / 255, (float)b / 255, (float)a / 255));
+    return true;
+}
+
+bool Context::SaveWorld(const std::string& directory, float cell_size) const {
+    SceneFile::Contents contents;
+    return SceneContents(&contents) && WorldPartition::Build(directory, contents, cell_size);
+}
 
-        simple_program_->SetUniform("model", object->transform().ModelMatrix());
-        object->Draw(simple_program_.get());
+void Context::UpdateStreaming() {
+    if (!world_ || !world_->Update(camera_.position_)) {
+        return;
     }
+    // the recordings of the last frame are done, nothing reads objects_ now
+    objects_.resize(base_object_count_);
+    world_->CollectObjects(&objects_);
+}
 
+void Context::Update() {
+    // the simulation thread starts with the first Update, the headless modes place the camera
+    // themselves and never call it
+    if (!simulation_) {
+        simulation_ = Simulation::Create(SimulationState{camera_.position_, 0});
+        simulated_position_ = camera_.position_;
+    }
+    if (camera_.position_ != simulated_position_) {
+        // placed from the settings panel, the simulation continues from there
+        ++teleport_revision_;
+        teleport_position_ = camera_.position_;
+    }
+    SimulationInput input;
+    input.camera = camera_;
+    input.teleport_revision = teleport_revision_;
+    input.teleport_position = teleport_position_;
+    simulation_->SetInput(input);
+
+    SimulationState state = simulation_->Sample(Simulation::Clock::now());
+    if (state.teleport_revision == teleport_revision_) {
+        camera_.position_ = state.camera_position;
+    }
+    simulated_position_ = camera_.position_;
+}
+
+void Context::Render() {
+    frame_arena_->BeginFrame();
+    profiler_->BeginFrame();
+    GlState::Get().BeginFrame();
+    ubo_transform_->BeginFrame();
+    draw_list_->BeginFrame();
+    overdraw_counter_->BeginFrame();
     {
-        glDisable(GL_DEPTH_TEST);
-        bool horizontal = true, flag = true;
-        auto model = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 2.0f));
-        gaussian_blur_program_->Use();
-        gaussian_blur_program_->SetUniform("transform", model);
-
-        // fbo -> fbo copy
-        // framebuffer_->Bind(GL_READ_FRAMEBUFFER);
-        // gaussian_blur_framebuffer_[0]->Bind(GL_DRAW_FRAMEBUFFER);
-        // glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_ ,
-        //                   GL_COLOR_BUFFER_BIT, GL_NEAREST);
-
-        // fbo -> texture copy
-        // framebuffer_->Bind(GL_READ_FRAMEBUFFER);
-        // gaussian_blur_framebuffer_[0]->color_attachment(0)->Bind();
-        // glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width_ / 2, height_ /
-        // 2);
-
-        for (unsigned int i = 0; i < 5 * 2; i++) {
-            gaussian_blur_framebuffer_[horizontal]->Bind();
-            gaussian_blur_program_->SetUniform("horizontal", horizontal);
-            glActiveTexture(GL_TEXTURE0);
-            if (flag) {
-                framebuffer_->color_attachment(1)->Bind();
-            } else {
-                gaussian_blur_framebuffer_[!horizontal]->color_attachment(0)->Bind();
-            }
-            gaussian_blur_program_->SetUniform("image", 0);
-            plane_->Draw(gaussian_blur_program_.get());
-            horizontal = !horizontal;
-            if (flag) {
-                flag = false;
-            }
+        Profiler::Scope scope(profiler_.get(), "imgui build");
+        RenderImGui();
+    }
+
+    {
+        Profiler::Scope scope(profiler_.get(), "scene update");
+        UpdateStreaming();
+        if (texture_streamer_) {
+            texture_streamer_->Update();
         }
+        UpdateModelMatrices();
+    }
+    {
+        Profiler::Scope scope(profiler_.get(), "record submit");
+        RecordDrawCommands();
     }
 
-    Framebuffer::BindToDefault();
-    glDisable(GL_BLEND);
-    glDisable(GL_DEPTH_TEST);
-    glClear(clear_bit_);
+    auto projection = camera_.GetPerspectiveProjectionMatrix();
+    auto view = camera_.GetViewMatrix();
+    DynamicBuffer::Allocation camera_transform;
     {
+        glm::mat4 transform[2] = {view, projection};
+        camera_transform = ubo_transform_->Upload(transform, sizeof(transform));
+    }
+    Frustum camera_frustum = Frustum::FromMatrix(projection * view);
+    HiZBuffer* hiz = is_occlusion_culling_ ? hiz_.get() : nullptr;
+
+    frame_graph_->Reset();
+    const FrameGraph::TextureDesc hdr{width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT};
+    const FrameGraph::TextureDesc depth_stencil{width_, height_, GL_DEPTH24_STENCIL8,
+                                                GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8};
+    auto shadow_2d = frame_graph_->Import("shadow map", depth_2d_map_->depth_map());
+    auto shadow_3d = frame_graph_->Import("omni shadow map", depth_3d_map_->depth_map());
+    auto index = frame_graph_->Import("index", index_framebuffer_->color_attachment(0));
+    auto backbuffer = frame_graph_->Import("backbuffer");
+    // handle lists of the passes, the closures keep copies of them
+    FrameAllocator<FrameGraph::Handle> frame_allocator(frame_arena_.get());
+    // the pyramid is no texture of the graph, the marker only orders its readers and writers
+    FrameVector<FrameGraph::Handle> pyramid(frame_allocator);
+    if (hiz) {
+        pyramid.push_back(frame_graph_->Import("hi-z pyramid"));
+    }
+    auto with_pyramid = [&](FrameGraph::HandleList handles) {
+        FrameVector<FrameGraph::Handle> list(handles.begin(), handles.end(), frame_allocator);
+        list.insert(list.end(), pyramid.begin(), pyramid.end());
+        return list;
+    };
+
+    FrameGraph::Handle shadow_maps[] = {shadow_2d, shadow_3d};
+    frame_graph_->AddPass("shadow", {}, shadow_maps,
+                          [this](FrameGraph&) { RenderDepthMap(); });
+
+    // octahedral normal, albedo, specular + shininess; position comes from the depth
+    FrameVector<FrameGraph::Handle> gbuffer(frame_allocator);
+    if (is_deferred_) {
+        gbuffer = {
+            frame_graph_->CreateTexture("g-buffer normal",
+                                        {width_, height_, GL_RG16F, GL_RG, GL_FLOAT}),
+            frame_graph_->CreateTexture("g-buffer albedo",
+                                        {width_, height_, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}),
+            frame_graph_->CreateTexture("g-buffer specular",
+                                        {width_, height_, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}),
+            frame_graph_->CreateTexture("g-buffer depth", depth_stencil)};
+        frame_graph_->AddPass("g-buffer", pyramid, with_pyramid(gbuffer), [=](FrameGraph& graph) {
+            ubo_transform_->BindRange(0, camera_transform);
+            RenderGBuffer(graph.framebuffer({gbuffer.data(), 3}, gbuffer[3]), camera_frustum,
+                          projection * view, hiz);
+        });
+    }
+
+    auto scene_color = frame_graph_->CreateTexture("scene color", hdr);
+    auto bright = frame_graph_->CreateTexture("bright color", hdr);
+    auto scene_depth = frame_graph_->CreateTexture("scene depth", depth_stencil);
+    FrameGraph::Handle scene_targets[] = {scene_color, bright, scene_depth};
+    FrameVector<FrameGraph::Handle> scene_reads = with_pyramid(shadow_maps);
+    scene_reads.insert(scene_reads.end(), gbuffer.begin(), gbuffer.end());
+    frame_graph_->AddPass(
+        "scene", scene_reads, with_pyramid(scene_targets),
+        [=](FrameGraph& graph) {
+            ubo_transform_->BindRange(0, camera_transform);
+            Framebuffer* target = graph.framebuffer({scene_targets, 2}, scene_depth);
+            target->Bind();
+            glEnable(GL_DEPTH_TEST);
+            glClearColor(clear_color_.r, clear_color_.g, clear_color_.b, clear_color_.a);
+            glClear(clear_bit_);
+            if (is_deferred_) {
+                // lit objects first, the forward passes depth test against them
+                RenderDeferredLighting(graph.framebuffer({gbuffer.data(), 3}, gbuffer[3]), target,
+                                       projection * view);
+            }
+            RenderScene(target, camera_frustum, projection, view, hiz);
+        });
+
+    if (texture_streamer_ && texture_streamer_->feedback_due()) {
+        auto feedback = frame_graph_->Import("texture feedback",
+                                             texture_streamer_->feedback_texture());
+        frame_graph_->AddPass("texture feedback", {}, feedback, [=](FrameGraph&) {
+            ubo_transform_->BindRange(0, camera_transform);
+            texture_streamer_->BeginFeedback();
+            glDisable(GL_BLEND);
+            glEnable(GL_DEPTH_TEST);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            const Program* program =
+                draw_list_->indirect() ? feedback_indirect_program_.get() : feedback_program_.get();
+            program->Use();
+            program->SetUniform("lodBias", texture_streamer_->feedback_lod_bias());
+
+            ReplayRecorded(&recorded_feedback_);
+            draw_list_->Submit(program, &camera_frustum);
+            texture_streamer_->EndFeedback();
+            glViewport(0, 0, width_, height_);
+        });
+    }
+
+    auto index_depth = frame_graph_->CreateTexture("index depth", depth_stencil);
+    FrameGraph::Handle index_targets[] = {index, index_depth};
+    frame_graph_->AddPass("index", pyramid, index_targets, [=](FrameGraph& graph) {
+        ubo_transform_->BindRange(0, camera_transform);
+        graph.framebuffer(index, index_depth)->Bind();
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(clear_bit_);
+        const Program* simple =
+            draw_list_->indirect() ? simple_indirect_program_.get() : simple_program_.get();
+        simple->Use();
+
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        ReplayRecorded(&recorded_index_);
+        draw_list_->Submit(simple, &camera_frustum, hiz);
+    });
+
+    FrameVector<FrameGraph::Handle> bloom_levels(frame_allocator);
+    if (bloom_) {
+        glm::ivec2 sizes[Bloom::kMaxLevelCount];
+        size_t level_count = Bloom::LevelSizes(width_, height_, sizes);
+        for (size_t i = 0; i < level_count; ++i) {
+            char name[16];
+            snprintf(name, sizeof(name), "bloom %zu", i);
+            bloom_levels.push_back(frame_graph_->CreateTexture(
+                name, {sizes[i].x, sizes[i].y, GL_RGBA16F, GL_RGBA, GL_FLOAT}));
+        }
+        frame_graph_->AddPass("bloom", bright, bloom_levels, [=](FrameGraph& graph) {
+            Framebuffer* levels[Bloom::kMaxLevelCount];
+            for (size_t i = 0; i < bloom_levels.size(); ++i) {
+                levels[i] = graph.framebuffer(bloom_levels[i]);
+            }
+            glDisable(GL_DEPTH_TEST);
+            bloom_pass_->Render(graph.texture(bright), levels, bloom_levels.size(), plane_.get());
+            glViewport(0, 0, width_, height_);
+        });
+    }
+
+    FrameVector<FrameGraph::Handle> post_reads({scene_color}, frame_allocator);
+    if (!bloom_levels.empty()) {
+        post_reads.push_back(bloom_levels[0]);
+    }
+    frame_graph_->AddPass("post", post_reads, backbuffer, [=](FrameGraph& graph) {
+        if (output_framebuffer_) {
+            output_framebuffer_->Bind();
+        } else {
+            Framebuffer::BindToDefault();
+        }
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glClear(clear_bit_);
         auto model = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 2.0f, 2.0f));
         post_program_->Use();
         post_program_->SetUniform("transform", model);
         post_program_->SetUniform("gamma", gamma_);
         post_program_->SetUniform("exposure", exposure_);
         post_program_->SetUniform("hdr_on", hdr_);
-        post_program_->SetUniform("bloom_on", bloom_);
-        glActiveTexture(GL_TEXTURE0);
-        framebuffer_->color_attachment(0)->Bind();
+        post_program_->SetUniform("bloom_on", !bloom_levels.empty());
+        GlState::Get().ActiveTexture(0);
+        graph.texture(scene_color)->Bind();
         post_program_->SetUniform("colorTex", 0);
-        glActiveTexture(GL_TEXTURE1);
-        gaussian_blur_framebuffer_[0]->color_attachment(0)->Bind();
-        post_program_->SetUniform("bloomBlur", 1);
+        if (!bloom_levels.empty()) {
+            // every level adds a blurred copy of the bright color
+            post_program_->SetUniform("bloomStrength",
+                                      bloom_strength_ / (float)bloom_levels.size());
+            GlState::Get().ActiveTexture(1);
+            graph.texture(bloom_levels[0])->Bind();
+            post_program_->SetUniform("bloomBlur", 1);
+            GlState::Get().ActiveTexture(0);
+        }
         plane_->Draw(post_program_.get());
+    });
+
+    if (frame_graph_->Compile()) {
+        frame_graph_->Execute();
+    }
+    // the graph may have culled the pass of a recording, none may outlive the frame
+    for (Recording* recording :
+         {&recorded_shadow_, &recorded_scene_, &recorded_index_, &recorded_feedback_}) {
+        ThreadPool::Default()->Wait(&recording->recorded);
     }
 
     if (is_active_wireframe_) {
@@ -449,6 +819,8 @@ void Context::Render() {
     } else {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
+    draw_list_->EndFrame();
+    ubo_transform_->EndFrame();
 }
 
 void Context::ProcessKeyboardInput(GLFWwindow* window, int key, int action) {
@@ -640,34 +1012,142 @@ void Context::ReshapeViewport(int width, int height) {
     height_ = height;
     camera_.ChangeAspect(width_, height_);
     glViewport(0, 0, width_, height_);
-    framebuffer_ =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT),
-                             Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
-    index_framebuffer_ = Framebuffer::Create({Texture2d::Create(width_, height_)});
-    gaussian_blur_framebuffer_[0] =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
-    gaussian_blur_framebuffer_[1] =
-        Framebuffer::Create({Texture2d::Create(width_, height_, GL_RGBA16F, GL_RGBA, GL_FLOAT)});
+    // the frame graph sizes its targets from width_ / height_, only persistent ones remain here
+    index_framebuffer_ = CreateIndexFramebuffer(width_, height_);
+    if (texture_streamer_) {
+        texture_streamer_->Resize(width_, height_);
+    }
+    if (hiz_) {
+        hiz_ = HiZBuffer::Create(width_, height_);
+    }
+}
+
+void Context::UpdateModelMatrices() {
+    // after RenderImGui, which moves the picked object. every pass reads these
+    model_matrices_.resize(objects_.size());
+    ThreadPool::Default()->ParallelFor(objects_.size(), 256, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            model_matrices_[i] = objects_[i]->transform().ModelMatrix();
+        }
+    });
+}
+
+void Context::RecordDrawCommands() {
+    // on the workers while the GL thread goes through the first passes, every pass waits only
+    // for the recording it replays
+    ThreadPool* pool = ThreadPool::Default();
+    pool->Submit(
+        [this] {
+            CommandBuffer& commands = recorded_shadow_.commands;
+            commands.Reset();
+            for (size_t i = 0; i < objects_.size(); ++i) {
+                DrawList::Record(&commands, objects_[i]->mesh().get(), model_matrices_[i]);
+            }
+        },
+        &recorded_shadow_.recorded);
+    pool->Submit(
+        [this] {
+            CommandBuffer& commands = recorded_scene_.commands;
+            commands.Reset();
+            for (size_t i = 0; i < objects_.size(); ++i) {
+                if (objects_[i] != pick_object_) {
+                    DrawList::Record(&commands, objects_[i]->mesh().get(), model_matrices_[i]);
+                }
+            }
+        },
+        &recorded_scene_.recorded);
+    pool->Submit(
+        [this] {
+            CommandBuffer& commands = recorded_index_.commands;
+            commands.Reset();
+            for (size_t i = 0; i < objects_.size(); ++i) {
+                auto rgba = IdToRGBA(objects_[i]->id());
+                uint8_t r = rgba[0];
+                uint8_t g = rgba[1];
+                uint8_t b = rgba[2];
+                uint8_t a = rgba[3];
+                DrawList::Record(
+                    &commands, objects_[i]->mesh().get(), model_matrices_[i],
+                    glm::vec4((float)r / 255, (float)g / 255, (float)b / 255, (float)a / 255));
+            }
+        },
+        &recorded_index_.recorded);
+    if (texture_streamer_ && texture_streamer_->feedback_due()) {
+        pool->Submit(
+            [this] {
+                CommandBuffer& commands = recorded_feedback_.commands;
+                commands.Reset();
+                for (size_t i = 0; i < objects_.size(); ++i) {
+                    const Mesh* mesh = objects_[i]->mesh().get();
+                    glm::vec4 ids = texture_streamer_->FeedbackColor(mesh->material().get());
+                    if (ids.x > 0.0f || ids.y > 0.0f) {
+                        DrawList::Record(&commands, mesh, model_matrices_[i], ids);
+                    }
+                }
+            },
+            &recorded_feedback_.recorded);
+    }
+}
+
+void Context::ReplayRecorded(Recording* recording) {
+    ThreadPool::Default()->Wait(&recording->recorded);
+    draw_list_->Clear();
+    draw_list_->Replay(recording->commands);
 }
 
 void Context::RenderImGui() {
     if (is_open_setting_) {
         if (ImGui::Begin("Settings", &is_open_setting_, ImGuiWindowFlags_AlwaysAutoResize)) {
-            static float prev_time = 0;
-            static int frames = 0;
-            static float fps = 0.0f;
-            static int prev_frames = 0;
-
-            frames++;
-            float curr_time = (float)glfwGetTime();
-            if (curr_time - prev_time >= 1.0) {
-                prev_frames = frames;
-                fps = 1000.0f / frames;
-                prev_time = curr_time;
-                frames = 0;
+            auto frame = profiler_->frame_history().cpu(frame_arena_.get());
+            ImGui::Text("%.3f ms/frame (%.0ffps)", frame.avg,
+                        frame.avg > 0.0f ? 1000.0f / frame.avg : 0.0f);
+            ImGui::Checkbox("Profiler", &is_open_profiler_);
+            const DrawList::Stats& draw_stats = draw_list_->stats();
+            ImGui::Text("%zu draws in %zu draw calls (%s)", draw_stats.draws,
+                        draw_stats.draw_calls,
+                        draw_list_->indirect() ? "multi draw indirect" : "direct");
+            ImGui::Text("%zu visible, %zu frustum culled, %zu occlusion culled", draw_stats.visible,
+                        draw_stats.frustum_culled, draw_stats.occlusion_culled);
+            if (const MaterialTable* materials = draw_list_->material_table()) {
+                ImGui::Text("%zu materials in %zu texture sets of %zu arrays (%zu views), "
+                            "%zu uploaded last",
+                            materials->material_count(), materials->texture_set_count(),
+                            materials->array_count(), materials->view_count(),
+                            materials->uploaded_count());
+            }
+            const GlState::Counters& gl = GlState::Get().last_frame();
+            ImGui::Text("GL: %zu draws, %zu dispatches, %zu state changes", gl.draws,
+                        gl.dispatches, gl.state_changes());
+            ImGui::Text("binds: %zu program, %zu texture, %zu framebuffer, %zu vertex array, "
+                        "%zu buffer",
+                        gl.program_binds, gl.texture_binds, gl.framebuffer_binds,
+                        gl.vertex_array_binds, gl.buffer_binds);
+            ImGui::Text("%zu uniforms, %zu buffer uploads (%.1f KB), %zu binds skipped",
+                        gl.uniform_uploads, gl.buffer_uploads, gl.buffer_upload_bytes / 1024.0f,
+                        gl.skipped);
+            FrameArena::Stats arena = frame_arena_->stats();
+            ImGui::Text("frame arena: %.1f KB peak of %.1f KB, %zu blocks spilled",
+                        arena.high_watermark / 1024.0f, arena.capacity / 1024.0f,
+                        arena.spilled_blocks);
+            if (world_) {
+                WorldPartition::Stats world = world_->stats();
+                ImGui::Text("world: %zu of %zu cells, %zu loading, %.1f MB, %zu loads, %zu evicted",
+                            world.resident, world.cells, world.loading,
+                            world.resident_bytes / 1048576.0f, world.loads, world.evictions);
+            }
+            TextureStreamer::Stats textures =
+                texture_streamer_ ? texture_streamer_->stats() : TextureStreamer::Stats();
+            if (textures.textures > 0) {
+                ImGui::Text("textures: %zu, %.1f of %.1f MB resident, %zu loading, %zu loads, "
+                            "%zu evicted",
+                            textures.textures, textures.resident_bytes / 1048576.0f,
+                            textures.full_bytes / 1048576.0f, textures.loading, textures.loads,
+                            textures.evictions);
+            }
+            bool caching = GlState::Get().caching();
+            if (ImGui::Checkbox("Skip redundant binds", &caching)) {
+                GlState::Get().set_caching(caching);
             }
-
-            ImGui::Text("%.3f ms/frame (%dfps)", fps, prev_frames);
             ImGui::Spacing();
             ImGui::Spacing();
 
@@ -686,6 +1166,10 @@ void Context::RenderImGui() {
                             camera_.front_.z);
                 ImGui::Text("Up    : x(%.3f), y(%.3f), z(%.3f)", camera_.up_.x, camera_.up_.y,
                             camera_.up_.z);
+                if (simulation_) {
+                    ImGui::Text("Update: %.0f Hz, %llu steps", 1.0f / simulation_->step_seconds(),
+                                (unsigned long long)simulation_->tick_count());
+                }
                 if (ImGui::Button("Reset camera")) {
                     camera_.Reset();
                 }
@@ -731,11 +1215,59 @@ void Context::RenderImGui() {
                         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
                     }
                 }
-                ImGui::Checkbox("Show vertex normal", &is_show_vertex_normal_);
+                ImGui::Checkbox("Show tangent frames", &is_show_vertex_normal_);
+                ImGui::Checkbox("Deferred shading", &is_deferred_);
+                if (is_deferred_) {
+                    ImGui::SliderInt("Light volumes", &light_volume_count_, 0, kMaxLightVolumes);
+                }
+                ImGui::Text("Depth prepass");
+                ImGui::SameLine();
+                ImGui::RadioButton("Off", (int*)&depth_prepass_, kDepthPrepassOff);
+                ImGui::SameLine();
+                ImGui::RadioButton("On", (int*)&depth_prepass_, kDepthPrepassOn);
+                ImGui::SameLine();
+                ImGui::RadioButton("Auto", (int*)&depth_prepass_, kDepthPrepassAuto);
+                ImGui::Text("overdraw %.2fx (%llu samples, %llu shaded)",
+                            overdraw_counter_->ratio(),
+                            (unsigned long long)overdraw_counter_->depth_samples(),
+                            (unsigned long long)overdraw_counter_->shaded_samples());
+                if (draw_list_->indirect()) {
+                    bool gpu_culling = draw_list_->gpu_culling();
+                    if (ImGui::Checkbox("GPU culling", &gpu_culling)) {
+                        draw_list_->set_gpu_culling(gpu_culling);
+                    }
+                    if (hiz_) {
+                        ImGui::Checkbox("Occlusion culling", &is_occlusion_culling_);
+                    }
+                    bool validate = draw_list_->validate_culling();
+                    if (ImGui::Checkbox("Validate GPU culling", &validate)) {
+                        draw_list_->set_validate_culling(validate);
+                    }
+                }
+                const auto& graph = frame_graph_->stats();
+                ImGui::Text("frame graph: %zu passes (%zu culled)", graph.passes,
+                            graph.culled_passes);
+                ImGui::Text("%zu targets in %zu textures, %.1f of %.1f MB", graph.transients,
+                            graph.textures, graph.allocated_bytes / 1048576.0,
+                            graph.requested_bytes / 1048576.0);
+                if (ImGui::Button("Export frame graph")) {
+                    frame_graph_->ExportGraphviz("frame_graph.dot");
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Save scene")) {
+                    SaveScene("save/scene.bin", true);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Save world")) {
+                    SaveWorld("save/world", 16.0f);
+                }
                 ImGui::Separator();
                 ImGui::Text("Post processing");
                 ImGui::Checkbox("HDR", &hdr_);
                 ImGui::Checkbox("Bloom", &bloom_);
+                if (bloom_) {
+                    ImGui::SliderFloat("Bloom strength", &bloom_strength_, 0.0f, 4.0f);
+                }
                 ImGui::DragFloat("Gamma", &gamma_, 0.01f, 0.0f, 5.0f);
                 ImGui::DragFloat("Exposure", &exposure_, 0.01f, 0.0f, 10.0f);
             }
@@ -743,6 +1275,10 @@ void Context::RenderImGui() {
         ImGui::End();
     }
 
+    if (is_open_profiler_) {
+        RenderProfilerImGui();
+    }
+
     if (ImGui::Begin("Index framebuffer", NULL)) {
         auto window_size = ImGui::GetWindowSize();
 
@@ -762,30 +1298,30 @@ void Context::RenderImGui() {
         }
     }
     ImGui::End();
+    // the textures of the last frame graph, an aliased one may hold a later pass' output
     if (ImGui::Begin("for blur", NULL)) {
         auto window_size = ImGui::GetWindowSize();
-        ImGui::Text("framebuffer_->color_attachment(1)");
-        ImGui::Image(reinterpret_cast<ImTextureID>(
-                         static_cast<uintptr_t>(framebuffer_->color_attachment(1)->id())),
-                     ImVec2(window_size.x, window_size.x * ((float)height_ / (float)width_)),
-                     ImVec2(0, 1), ImVec2(1, 0));
-        ImGui::Text("pingpong_[0]->color_attachment(0)");
-        ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(
-                         gaussian_blur_framebuffer_[0]->color_attachment(0)->id())),
-                     ImVec2(window_size.x, window_size.x * ((float)height_ / (float)width_)),
-                     ImVec2(0, 1), ImVec2(1, 0));
-        ImGui::Text("pingpong_[1]->color_attachment(0)");
-        ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(
-                         gaussian_blur_framebuffer_[1]->color_attachment(0)->id())),
-                     ImVec2(window_size.x, window_size.x * ((float)height_ / (float)width_)),
-                     ImVec2(0, 1), ImVec2(1, 0));
+        char names[Bloom::kMaxLevelCount + 1][16] = {"bright color"};
+        for (int i = 0; i < Bloom::kMaxLevelCount; ++i) {
+            snprintf(names[i + 1], sizeof(names[i + 1]), "bloom %d", i);
+        }
+        for (const char* name : names) {
+            auto texture = frame_graph_->Find(name);
+            if (!texture) {
+                continue;
+            }
+            ImGui::Text("%s", name);
+            ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(texture->id())),
+                         ImVec2(window_size.x, window_size.x * ((float)height_ / (float)width_)),
+                         ImVec2(0, 1), ImVec2(1, 0));
+        }
     }
     ImGui::End();
 
-    if (ImGui::Begin("Framebuffer", NULL)) {
+    auto scene_color = frame_graph_->Find("scene color");
+    if (ImGui::Begin("Framebuffer", NULL) && scene_color) {
         auto window_size = ImGui::GetWindowSize();
-        ImGui::Image(reinterpret_cast<ImTextureID>(
-                         static_cast<uintptr_t>(framebuffer_->color_attachment(0)->id())),
+        ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(scene_color->id())),
                      ImVec2(window_size.x, window_size.x * ((float)height_ / (float)width_)),
                      ImVec2(0, 1), ImVec2(1, 0));
 
@@ -795,8 +1331,7 @@ void Context::RenderImGui() {
         ImGui::InputText("", buf, 512 - 1);
         ImGui::SameLine();
         if (ImGui::Button("OK", ImVec2(50, 0))) {
-            framebuffer_->color_attachment(0)->SaveAsPng(std::string("save/") + std::string(buf) +
-                                                         std::string(".png"));
+            scene_color->SaveAsPng(std::string("save/") + std::string(buf) + std::string(".png"));
         }
     }
     ImGui::End();
@@ -813,9 +1348,8 @@ void Context::RenderImGui() {
         ImGui::SameLine();
         ImGui::InputText("", buf, 512 - 1);
         ImGui::SameLine();
-        if (ImGui::Button("OK", ImVec2(50, 0))) {
-            framebuffer_->color_attachment(0)->SaveAsPng(std::string("save/") + std::string(buf) +
-                                                         std::string(".png"));
+        if (ImGui::Button("OK", ImVec2(50, 0)) && scene_color) {
+            scene_color->SaveAsPng(std::string("save/") + std::string(buf) + std::string(".png"));
         }
     }
     ImGui::End();
@@ -858,7 +1392,10 @@ void Context::RenderImGui() {
                                          ImVec2((float)150, (float)150), ImVec2(0, 1),
                                          ImVec2(1, 0));
                         }
-                        ImGui::DragFloat("shininess", &mesh->material()->shininess_, 0.01f);
+                        float shininess = mesh->material()->shininess();
+                        if (ImGui::DragFloat("shininess", &shininess, 0.01f)) {
+                            mesh->material()->set_shininess(shininess);
+                        }
                     }
                 }
 
@@ -917,6 +1454,59 @@ size_t RGBAToId(std::array<uint8_t, 4> rgba) {
 
     return id;
 }
+void Context::RenderProfilerImGui() {
+    if (ImGui::Begin("Profiler", &is_open_profiler_)) {
+        if (ImGui::Button("Export Chrome trace")) {
+            profiler_->ExportChromeTrace("profile.json");
+        }
+        ImGui::SameLine();
+        ImGui::Text("last %d frames, ms over %d frames", Profiler::kTraceFrames,
+                    Profiler::kHistorySize);
+
+        const auto& timings = profiler_->last_frame();
+        if (ImGui::BeginTable("scopes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+            ImGui::TableSetupColumn("scope");
+            ImGui::TableSetupColumn("cpu avg");
+            ImGui::TableSetupColumn("gpu min");
+            ImGui::TableSetupColumn("gpu avg");
+            ImGui::TableSetupColumn("gpu p99");
+            ImGui::TableHeadersRow();
+            for (const auto& timing : timings) {
+                const auto* history = profiler_->history(timing.name);
+                auto cpu = history->cpu(frame_arena_.get());
+                auto gpu = history->gpu(frame_arena_.get());
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%*s%s", timing.depth * 2, "", timing.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", cpu.avg);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", gpu.min);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", gpu.avg);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", gpu.p99);
+            }
+            ImGui::EndTable();
+        }
+
+        auto window_width = ImGui::GetWindowSize().x;
+        for (const auto& timing : timings) {
+            const auto* history = profiler_->history(timing.name);
+            if (ImGui::TreeNode(timing.name.c_str())) {
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "gpu p99 %.3f ms",
+                         history->gpu(frame_arena_.get()).p99);
+                ImGui::PlotLines("##gpu", history->gpu_ms.data(), (int)history->gpu_ms.size(),
+                                 (int)history->next, overlay, 0.0f, FLT_MAX,
+                                 ImVec2(window_width - 40.0f, 60.0f));
+                ImGui::TreePop();
+            }
+        }
+    }
+    ImGui::End();
+}
+
 std::array<uint8_t, 4> IdToRGBA(size_t id) {
     uint8_t rgba[4];
 
@@ -956,7 +1546,147 @@ void Context::CalcCursorRay(glm::vec2 cursor) {
     cursor_ray_ = ray;
 }
 
-void Context::RenderDepthMap() const {
+std::unique_ptr<Framebuffer> Context::CreateIndexFramebuffer(int width, int height) {
+    // color only, picking reads it back; the frame graph pairs it with a transient depth
+    return Framebuffer::Create({Texture2d::Create(width, height)}, std::shared_ptr<Texture2d>());
+}
+
+void Context::RenderScene(const Framebuffer* target, const Frustum& camera_frustum,
+                          const glm::mat4& projection, const glm::mat4& view, HiZBuffer* hiz) {
+    { // cube program
+        Profiler::Scope scope(profiler_.get(), "skybox");
+        GlState::Get().ActiveTexture(0);
+        cube_texture_->Bind();
+
+        auto model = glm::translate(glm::mat4(1.0), camera_.position_) *
+                     glm::scale(glm::mat4(1.0), glm::vec3(200.0f));
+        cube_program_->Use();
+        cube_program_->SetUniform("cube", 0);
+        cube_program_->SetUniform("model", model);
+        sphere_->Draw(cube_program_.get());
+        GlState::Get().ActiveTexture(0);
+    }
+    { // simple program
+        simple_program_->Use();
+        if (is_hit_) {
+            auto model = glm::translate(glm::mat4(1.0), hit_point_) *
+                         glm::scale(glm::mat4(1.0), glm::vec3(0.1f));
+            simple_program_->SetUniform("color", glm::vec4(0.2f, 0.3f, 0.4f, 1.0f));
+            simple_program_->SetUniform("model", model);
+            sphere_->Draw(simple_program_.get());
+        }
+    }
+
+    bool prepass =
+        !is_deferred_ &&
+        (depth_prepass_ == kDepthPrepassOn ||
+         (depth_prepass_ == kDepthPrepassAuto && overdraw_counter_->ShouldPrepass()));
+    if (prepass) { // depth prepass
+        Profiler::Scope scope(profiler_.get(), "depth prepass");
+        const Program* depth =
+            draw_list_->indirect() ? simple_indirect_program_.get() : simple_program_.get();
+        depth->Use();
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        overdraw_counter_->Begin(OverdrawCounter::kDepthPass);
+
+        ReplayRecorded(&recorded_shadow_);
+        draw_list_->Submit(depth, &camera_frustum, hiz);
+        if (hiz) {
+            hiz->Build(target->depth_attachment().get(), projection * view);
+            draw_list_->SubmitRetest(depth, hiz);
+        }
+
+        overdraw_counter_->End();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        // every fragment left is the visible one, shade it once
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    { // lighting program
+        if (!is_deferred_) {
+            Profiler::Scope scope(profiler_.get(), "lighting");
+            const Program* lighting =
+                draw_list_->indirect() ? lighting_indirect_program_.get() : lighting_program_.get();
+            lighting->Use();
+            SetLightUniforms(lighting);
+
+            ReplayRecorded(&recorded_scene_);
+            overdraw_counter_->Begin(prepass ? OverdrawCounter::kShadePass
+                                             : OverdrawCounter::kDepthPass);
+            // without a prepass: last frame's pyramid first, then what it hid against the depth
+            // drawn so far. the prepass already built this frame's pyramid
+            draw_list_->Submit(lighting, &camera_frustum, hiz);
+            if (hiz && !prepass) {
+                hiz->Build(target->depth_attachment().get(), projection * view);
+                draw_list_->SubmitRetest(lighting, hiz);
+            }
+            if (pick_object_) {
+                glEnable(GL_STENCIL_TEST);
+                glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+                glStencilFunc(GL_ALWAYS, 1, 0xFF);
+                glStencilMask(0xFF);
+
+                draw_list_->Clear();
+                draw_list_->Add(pick_object_->mesh().get(),
+                                pick_object_->transform().ModelMatrix());
+                draw_list_->Submit(lighting);
+            }
+            overdraw_counter_->End();
+            if (prepass) {
+                glDepthFunc(GL_LESS);
+                glDepthMask(GL_TRUE);
+            }
+        }
+
+        if (pick_object_) {
+            auto modelTransform = pick_object_->transform().ModelMatrix();
+            glEnable(GL_STENCIL_TEST);
+            glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+            glStencilMask(0x00);
+            simple_program_->Use();
+            simple_program_->SetUniform("color", glm::vec4(0.8f, 0.8f, 0.4f, 1.0f));
+            simple_program_->SetUniform(
+                "model",
+                modelTransform * glm::scale(glm::mat4(1.0f), glm::vec3(1.05f, 1.05f, 1.05f)));
+            pick_object_->Draw(simple_program_.get());
+
+            glDisable(GL_STENCIL_TEST);
+            glStencilFunc(GL_ALWAYS, 1, 0xFF);
+            glStencilMask(0xFF);
+        }
+
+        if (is_show_vertex_normal_) {
+            vertex_normal_program_->Use();
+            for (size_t i = 0; i < objects_.size(); ++i) {
+                vertex_normal_program_->SetUniform("length", 0.1f);
+                vertex_normal_program_->SetUniform("transform",
+                                                   projection * view * model_matrices_[i]);
+                objects_[i]->Draw(vertex_normal_program_.get());
+            }
+        }
+    }
+}
+
+void Context::SetLightUniforms(const Program* program) const {
+    program->SetUniform("lightType", light_->type());
+    program->SetUniform("viewPos", camera_.position_);
+    program->SetUniform("light.position", light_->position());
+    program->SetUniform("light.direction", light_->direction());
+    program->SetUniform(
+        "light.cutoff", glm::vec2(cosf(glm::radians(light_->cutoff[0])),
+                                  cosf(glm::radians(light_->cutoff[0] + light_->cutoff[1]))));
+    program->SetUniform("light.constant", light_->constant);
+    program->SetUniform("light.linear", light_->linear);
+    program->SetUniform("light.quadratic", light_->quadratic);
+    program->SetUniform("light.ambient", light_->ambient);
+    program->SetUniform("light.diffuse", light_->diffuse);
+    program->SetUniform("light.specular", light_->specular);
+    program->SetUniform("isBlinn", is_blinn_);
+    program->SetUniform("isShadow", is_active_shadow_);
+    GlState::Get().ActiveTexture(3);
+    depth_2d_map_->depth_map()->Bind();
+    program->SetUniform("depthMap", 3);
     auto rm = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
     auto lightView = glm::lookAt(light_->position(), light_->position() + light_->direction(),
                                  glm::vec3(glm::vec4(light_->direction(), 0.0f) * rm));
@@ -967,27 +1697,141 @@ void Context::RenderDepthMap() const {
         lightProjection = glm::perspective(
             glm::radians((light_->cutoff[0] + light_->cutoff[1]) * 2.0f), 1.0f, 1.0f, 20.0f);
     }
-    ubo_transform_->Bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(lightView));
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4),
-                    glm::value_ptr(lightProjection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    program->SetUniform("lightTransform", lightProjection * lightView);
+    GlState::Get().ActiveTexture(0);
+
+    GlState::Get().ActiveTexture(4);
+    depth_3d_map_->depth_map()->Bind();
+    program->SetUniform("depthMap3d", 4);
+    GlState::Get().ActiveTexture(0);
+    program->SetUniform("far_plane", 25.0f);
+}
+
+void Context::RenderGBuffer(Framebuffer* gbuffer, const Frustum& frustum,
+                            const glm::mat4& view_projection, HiZBuffer* hiz) {
+    gbuffer->Bind();
+    glEnable(GL_DEPTH_TEST);
+    glClear(clear_bit_);
+    const Program* program =
+        draw_list_->indirect() ? gbuffer_indirect_program_.get() : gbuffer_program_.get();
+    program->Use();
+
+    ReplayRecorded(&recorded_scene_);
+    draw_list_->Submit(program, &frustum, hiz);
+    if (hiz) {
+        hiz->Build(gbuffer->depth_attachment().get(), view_projection);
+        draw_list_->SubmitRetest(program, hiz);
+    }
+    if (pick_object_) {
+        glEnable(GL_STENCIL_TEST);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilMask(0xFF);
+
+        draw_list_->Clear();
+        draw_list_->Add(pick_object_->mesh().get(), pick_object_->transform().ModelMatrix());
+        draw_list_->Submit(program);
+        glDisable(GL_STENCIL_TEST);
+    }
+}
+
+void Context::RenderDeferredLighting(Framebuffer* gbuffer, Framebuffer* target,
+                                     const glm::mat4& view_projection) {
+    // scene depth for the forward passes, stencil for the pick outline
+    gbuffer->Bind(GL_READ_FRAMEBUFFER);
+    target->Bind(GL_DRAW_FRAMEBUFFER);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_,
+                      GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    target->Bind();
+
+    glDisable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    for (int i = 0; i < 3; ++i) {
+        GlState::Get().ActiveTexture(i);
+        gbuffer->color_attachment(i)->Bind();
+    }
+    GlState::Get().ActiveTexture(5);
+    gbuffer->depth_attachment()->Bind();
+    GlState::Get().ActiveTexture(0);
+    auto set_gbuffer = [&](const Program* program) {
+        program->SetUniform("gNormal", 0);
+        program->SetUniform("gAlbedo", 1);
+        program->SetUniform("gSpecular", 2);
+        program->SetUniform("gDepth", 5);
+        program->SetUniform("screenSize", glm::vec2(width_, height_));
+        program->SetUniform("inverseViewProjection", glm::inverse(view_projection));
+    };
+
+    { // the scene light, once per covered pixel
+        deferred_light_program_->Use();
+        deferred_light_program_->SetUniform("transform",
+                                            glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)));
+        set_gbuffer(deferred_light_program_.get());
+        SetLightUniforms(deferred_light_program_.get());
+        plane_->Draw(deferred_light_program_.get());
+    }
+
+    if (light_volume_count_ > 0) { // point lights, only the pixels inside their volume
+        Profiler::Scope scope(profiler_.get(), "light volumes");
+        // back faces only: one fragment per pixel, also with the camera inside a volume
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        light_volume_program_->Use();
+        set_gbuffer(light_volume_program_.get());
+        light_volume_program_->SetUniform("viewPos", camera_.position_);
+        light_volume_program_->SetUniform("isBlinn", is_blinn_);
+        // sphere mesh radius is 0.5, grown so its 12 x 8 facets stay outside the light radius
+        light_volume_program_->SetUniform(
+            "volumeScale",
+            2.0f / (cosf(glm::pi<float>() / 12.0f) * cosf(glm::pi<float>() / 16.0f)));
+        glBindBufferBase(GL_UNIFORM_BUFFER, kLightVolumeBinding, light_volume_buffer_->id());
+        light_volume_mesh_->Draw(light_volume_program_.get(), light_volume_count_);
+        glDisable(GL_BLEND);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    if (is_active_wireframe_) {
+        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    }
+}
+
+void Context::RenderDepthMap() {
+    auto rm = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+    auto lightView = glm::lookAt(light_->position(), light_->position() + light_->direction(),
+                                 glm::vec3(glm::vec4(light_->direction(), 0.0f) * rm));
+    glm::mat4 lightProjection;
+    if (light_->type() == kDirectional) {
+        lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 20.0f);
+    } else {
+        lightProjection = glm::perspective(
+            glm::radians((light_->cutoff[0] + light_->cutoff[1]) * 2.0f), 1.0f, 1.0f, 20.0f);
+    }
+    {
+        glm::mat4 transform[2] = {lightView, lightProjection};
+        ubo_transform_->BindRange(0, ubo_transform_->Upload(transform, sizeof(transform)));
+    }
 
     glCullFace(GL_FRONT);
     {
+        Profiler::Scope scope(profiler_.get(), "shadow 2d");
         depth_2d_map_->Bind();
         glEnable(GL_DEPTH_TEST);
         glClear(GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, depth_2d_map_->depth_map()->width(), depth_2d_map_->depth_map()->height());
-        simple_program_->Use();
-        simple_program_->SetUniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+        const Program* simple =
+            draw_list_->indirect() ? simple_indirect_program_.get() : simple_program_.get();
+        simple->Use();
 
-        for (const auto& object : objects_) {
-            simple_program_->SetUniform("model", object->transform().ModelMatrix());
-            object->Draw(simple_program_.get());
-        }
+        ReplayRecorded(&recorded_shadow_);
+        Frustum light_frustum = Frustum::FromMatrix(lightProjection * lightView);
+        draw_list_->Submit(simple, &light_frustum);
     }
     {
+        Profiler::Scope scope(profiler_.get(), "shadow cube");
         depth_3d_map_->Bind();
         glEnable(GL_DEPTH_TEST);
         glClear(GL_DEPTH_BUFFER_BIT);
@@ -996,7 +1840,8 @@ void Context::RenderDepthMap() const {
         float aspect = (float)depth_3d_map_->depth_map()->width() /
                        (float)depth_3d_map_->depth_map()->height();
         glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, 0.5f, 25.0f);
-        std::vector<glm::mat4> shadowTransforms;
+        FrameVector<glm::mat4> shadowTransforms(frame_arena_.get());
+        shadowTransforms.reserve(6);
         shadowTransforms.push_back(shadowProj *
                                    glm::lookAt(light_->position(),
                                                light_->position() + glm::vec3(1.0, 0.0, 0.0),
@@ -1022,16 +1867,16 @@ void Context::RenderDepthMap() const {
                                                light_->position() + glm::vec3(0.0, 0.0, -1.0),
                                                glm::vec3(0.0, -1.0, 0.0)));
 
-        depth_3d_program_->Use();
-        depth_3d_program_->SetUniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-        depth_3d_program_->SetUniform("shadowMatrices", shadowTransforms);
-        depth_3d_program_->SetUniform("far_plane", 25.0f);
-        depth_3d_program_->SetUniform("lightPos", light_->position());
+        const Program* depth_3d =
+            draw_list_->indirect() ? depth_3d_indirect_program_.get() : depth_3d_program_.get();
+        depth_3d->Use();
+        depth_3d->SetUniform("shadowMatrices", shadowTransforms.data(), shadowTransforms.size());
+        depth_3d->SetUniform("far_plane", 25.0f);
+        depth_3d->SetUniform("lightPos", light_->position());
 
-        for (const auto& object : objects_) {
-            depth_3d_program_->SetUniform("model", object->transform().ModelMatrix());
-            object->Draw(depth_3d_program_.get());
-        }
+        // the object list is unchanged since the 2d pass
+        Frustum light_range = Frustum::FromBox(light_->position(), glm::vec3(25.0f));
+        draw_list_->Submit(depth_3d, &light_range);
     }
     glViewport(0, 0, width_, height_);
     glCullFace(GL_BACK);
@@ -1,23 +1,63 @@
 #ifndef INCLUDED_CONTEXT_HPP
 #define INCLUDED_CONTEXT_HPP
 
+#include "bloom.hpp"
 #include "camera.hpp"
 #include "common.hpp"
+#include "draw_list.hpp"
+#include "dynamic_buffer.hpp"
+#include "frame_arena.hpp"
+#include "frame_graph.hpp"
 #include "framebuffer.hpp"
+#include "hiz_buffer.hpp"
 #include "light.hpp"
 #include "material.hpp"
 #include "mesh.hpp"
 #include "model.hpp"
 #include "object.hpp"
+#include "overdraw_counter.hpp"
+#include "profiler.hpp"
 #include "program.hpp"
 #include "ray.hpp"
+#include "scene_file.hpp"
 #include "shader.hpp"
+#include "simulation.hpp"
+#include "texture_streamer.hpp"
+#include "thread_pool.hpp"
+#include "world_partition.hpp"
+
+enum DepthPrepass {
+    kDepthPrepassOff,
+    kDepthPrepassOn,
+    kDepthPrepassAuto, // whenever the measured overdraw is high
+};
+
+// what Init puts into the world, the defaults are the interactive scene
+struct SceneDesc {
+    uint32_t seed{0}; // 0: a different scene every run
+    int box_count{100};
+    int light_count{0}; // deferred point lights, at most 256
+    std::string model_path;
+    bool closed_room{false}; // all six walls, every face of the omni shadow map has casters
+    int shadow_map_size{1024};
+    bool deferred{false};
+    // loads the objects and lights from a scene file instead of generating them
+    std::string scene_path;
+    // a directory of cells (Context::SaveWorld, WorldPartition::Build) streamed in around the
+    // camera, on top of the scene
+    std::string world_path;
+    size_t world_budget_bytes{4 * 1024 * 1024};
+    // diffuse texture of the wood boxes, streamed like the ones of the model
+    std::string wood_texture_path{"image/wood.png"};
+    size_t texture_budget_bytes{64 * 1024 * 1024};
+};
 
 class Context {
   public:
-    static std::unique_ptr<Context> Create();
+    static std::unique_ptr<Context> Create(const SceneDesc& scene = SceneDesc());
     ~Context();
 
+    // takes the camera position from the simulation thread, started by the first call
     void Update();
     void Render();
     void RenderImGui();
@@ -27,15 +67,63 @@ class Context {
     void ProcessMouseScroll(double xoffset, double yoffset);
     void ReshapeViewport(int width, int height);
 
+    inline Profiler* profiler() const { return profiler_.get(); }
+    inline const DrawList* draw_list() const { return draw_list_.get(); }
+    inline const FrameGraph* frame_graph() const { return frame_graph_.get(); }
+    inline const FrameArena* frame_arena() const { return frame_arena_.get(); }
+    // null without a world_path
+    inline const WorldPartition* world() const { return world_.get(); }
+    // null where TextureStreamer::IsSupported is not
+    inline const TextureStreamer* texture_streamer() const { return texture_streamer_.get(); }
+    inline Camera& camera() { return camera_; }
+    // where post processing ends up, the default framebuffer when null
+    inline void set_output_framebuffer(Framebuffer* framebuffer) {
+        output_framebuffer_ = framebuffer;
+    }
+
     void CalcCursorRay(glm::vec2 cursor);
+    // objects, lights and their mesh / material names as a SceneFile, plus filename.json
+    bool SaveScene(const std::string& filename, bool json = false) const;
+    // the objects split into the cell files of a streamed world
+    bool SaveWorld(const std::string& directory, float cell_size) const;
 
   private:
     Context();
 
-    bool Init();
-
-    void RenderDepthMap() const;
-    std::unique_ptr<Buffer> ubo_transform_{nullptr};
+    bool Init(const SceneDesc& scene);
+    void GenerateScene(const SceneDesc& scene);
+    bool LoadScene(const std::string& filename);
+    // what scene files call the meshes, a material is called after the mesh it came with
+    std::vector<std::pair<std::string, std::shared_ptr<Mesh>>> NamedMeshes() const;
+    bool SceneContents(SceneFile::Contents* contents) const;
+    // takes the cells that came in or went out since the last frame
+    void UpdateStreaming();
+
+    struct Recording {
+        CommandBuffer commands;
+        ThreadPool::Counter recorded;
+    };
+
+    void UpdateModelMatrices();
+    // draw lists of the passes, recorded on the thread pool
+    void RecordDrawCommands();
+    // waits for the recording, then fills the draw list from it
+    void ReplayRecorded(Recording* recording);
+    void RenderDepthMap();
+    void RenderProfilerImGui();
+    void SetLightUniforms(const Program* program) const;
+    // skybox, forward lit objects, pick outline, ... into the bound target
+    void RenderScene(const Framebuffer* target, const Frustum& camera_frustum,
+                     const glm::mat4& projection, const glm::mat4& view, HiZBuffer* hiz);
+    void RenderGBuffer(Framebuffer* gbuffer, const Frustum& frustum,
+                       const glm::mat4& view_projection, HiZBuffer* hiz);
+    // depth / stencil copy to target, then the lights in screen space
+    void RenderDeferredLighting(Framebuffer* gbuffer, Framebuffer* target,
+                                const glm::mat4& view_projection);
+    static std::unique_ptr<Framebuffer> CreateIndexFramebuffer(int width, int height);
+    std::unique_ptr<DynamicBuffer> ubo_transform_{nullptr};
+    std::unique_ptr<DrawList> draw_list_{nullptr};
+    std::unique_ptr<OverdrawCounter> overdraw_counter_{nullptr};
 
     glm::vec4 clear_color_{0.0f};
     uint32_t clear_bit_{0};
@@ -50,19 +138,45 @@ class Context {
     std::unique_ptr<Program> post_program_{nullptr};
     std::unique_ptr<Program> depth_3d_program_{nullptr};
     std::unique_ptr<Program> vertex_normal_program_{nullptr};
+    // gl_DrawIDARB variants, only created when the draw list submits indirectly
+    std::unique_ptr<Program> lighting_indirect_program_{nullptr};
+    std::unique_ptr<Program> simple_indirect_program_{nullptr};
+    std::unique_ptr<Program> depth_3d_indirect_program_{nullptr};
+    // deferred path
+    std::unique_ptr<Program> gbuffer_program_{nullptr};
+    std::unique_ptr<Program> gbuffer_indirect_program_{nullptr};
+    std::unique_ptr<Program> deferred_light_program_{nullptr};
+    std::unique_ptr<Program> light_volume_program_{nullptr};
+    // texture feedback, the indirect one only with the indirect draw list
+    std::unique_ptr<Program> feedback_program_{nullptr};
+    std::unique_ptr<Program> feedback_indirect_program_{nullptr};
 
     // textures
     std::unique_ptr<Texture3d> cube_texture_{nullptr};
+    std::unique_ptr<TextureStreamer> texture_streamer_{nullptr};
 
     // Meshes
     std::shared_ptr<Mesh> box_{nullptr};
     std::shared_ptr<Mesh> wood_box_{nullptr};
     std::shared_ptr<Mesh> sphere_{nullptr};
     std::shared_ptr<Mesh> plane_{nullptr};
+    std::shared_ptr<Mesh> light_volume_mesh_{nullptr};
     std::shared_ptr<Model> model_{nullptr};
 
     // objects
     std::vector<std::shared_ptr<Object>> objects_;
+    // the objects of the resident world cells follow the first base_object_count_
+    std::unique_ptr<WorldPartition> world_{nullptr};
+    size_t base_object_count_{0};
+    // of objects_, once a frame
+    std::vector<glm::mat4> model_matrices_;
+    // every object for the shadow maps and the depth prepass, all but the picked one for the
+    // lit passes, every object in its id color for the index pass, the ones with streamed
+    // textures in their feedback ids for the texture feedback pass when it is due
+    Recording recorded_shadow_;
+    Recording recorded_scene_;
+    Recording recorded_index_;
+    Recording recorded_feedback_;
     size_t pick_id_{(size_t)-1};
     std::shared_ptr<Object> pick_object_{nullptr};
     ObjectType object_type_{kNormal};
@@ -85,28 +199,48 @@ class Context {
     bool is_blinn_{false};
 
     Camera camera_;
+    // moves the camera at a fixed rate, camera_ takes its position every Update
+    std::unique_ptr<Simulation> simulation_{nullptr};
+    glm::vec3 simulated_position_{0.0f};
+    uint32_t teleport_revision_{0};
+    glm::vec3 teleport_position_{0.0f};
     glm::vec2 prev_cursor_{0.0f};
     bool camera_direction_control_{false};
     bool camera_fast_move_{false};
 
-    std::unique_ptr<Framebuffer> framebuffer_{nullptr};
+    // transient data of the frame, outlives the frame graph which keeps pass closures in it
+    std::unique_ptr<FrameArena> frame_arena_{nullptr};
+    // per-frame render targets live in the frame graph
+    std::unique_ptr<FrameGraph> frame_graph_{nullptr};
+    std::unique_ptr<Profiler> profiler_{nullptr};
     std::unique_ptr<Framebuffer> index_framebuffer_{nullptr};
+    Framebuffer* output_framebuffer_{nullptr};
+    std::unique_ptr<Buffer> light_volume_buffer_{nullptr};
+    // what light_volume_buffer_ holds
+    std::vector<SceneFile::PointLight> point_lights_;
+    // depth pyramid of the scene depth, only built when the draw list culls on the GPU
+    std::unique_ptr<HiZBuffer> hiz_{nullptr};
     std::unique_ptr<DepthMap2d> depth_2d_map_{nullptr};
     std::unique_ptr<DepthMap3d> depth_3d_map_{nullptr};
 
-    std::unique_ptr<Framebuffer> gaussian_blur_framebuffer_[2];
-    std::unique_ptr<Program> gaussian_blur_program_{nullptr};
+    std::unique_ptr<Bloom> bloom_pass_{nullptr};
 
     float gamma_{2.0f};
     float exposure_{3.0f};
     bool bloom_{true};
+    float bloom_strength_{1.0f};
     bool hdr_{true};
 
     int imgui_image_size_{800};
     bool is_open_setting_{true};
+    bool is_open_profiler_{true};
     bool is_active_wireframe_{false};
     bool is_show_vertex_normal_{false};
     bool is_active_shadow_{true};
+    bool is_occlusion_culling_{true};
+    DepthPrepass depth_prepass_{kDepthPrepassAuto};
+    bool is_deferred_{false};
+    int light_volume_count_{0};
 };
 
 size_t RGBAToId(std::array<uint8_t, 4> rgba);
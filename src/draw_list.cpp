@@ -0,0 +1,432 @@
+#include "draw_list.hpp"
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+DrawList::DrawList() {}
+
+DrawList::~DrawList() {}
+
+std::unique_ptr<DrawList> DrawList::Create(size_t max_draws_per_frame) {
+    auto draw_list = std::unique_ptr<DrawList>(new DrawList());
+    if (!draw_list->Init(max_draws_per_frame)) {
+        return nullptr;
+    }
+
+    return std::move(draw_list);
+}
+
+bool DrawList::IsIndirectSupported() {
+    return GLAD_GL_VERSION_4_3 && GLAD_GL_ARB_shader_draw_parameters;
+}
+
+bool DrawList::Init(size_t max_draws_per_frame) {
+    if (!IsIndirectSupported()) {
+        SPDLOG_INFO("multi draw indirect unavailable, drawing one mesh per call");
+        return true;
+    }
+
+    int alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ssbo_alignment_ = std::max(alignment, 4);
+    // culled DrawData of a batch is bound as its own SSBO range, so batches start at slots that
+    // are both a DrawData and an SSBO offset alignment apart
+    slot_granularity_ = std::lcm(sizeof(DrawData), ssbo_alignment_) / sizeof(DrawData);
+    count_draws_ = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_indirect_parameters;
+
+    // culled submissions need inputs, compacted outputs and padding between batches
+    command_buffer_ = DynamicBuffer::Create(
+        GL_DRAW_INDIRECT_BUFFER, max_draws_per_frame * sizeof(DrawElementsIndirectCommand) * 2);
+    data_buffer_ = DynamicBuffer::Create(
+        GL_SHADER_STORAGE_BUFFER, max_draws_per_frame * (sizeof(CullInput) + sizeof(DrawData)));
+    if (!command_buffer_ || !data_buffer_) {
+        return false;
+    }
+
+    cull_program_ = Program::CreateCompute("shader/cull.cs");
+    material_table_ = MaterialTable::Create();
+    if (!cull_program_ || !material_table_) {
+        return false;
+    }
+
+    size_t counter_stride = (3 * sizeof(uint32_t) + ssbo_alignment_ - 1) / ssbo_alignment_ *
+                            ssbo_alignment_;
+    std::vector<uint8_t> zeros(counter_stride * data_buffer_->frame_count(), 0);
+    counter_buffer_ = Buffer::Create(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_READ, zeros.data(),
+                                     counter_stride, data_buffer_->frame_count());
+
+    return true;
+}
+
+void DrawList::BeginFrame() {
+    if (indirect()) {
+        command_buffer_->BeginFrame();
+        data_buffer_->BeginFrame();
+
+        // the fence data_buffer_ waited on covers the cull.cs runs that wrote this range
+        uint32_t counters[3] = {0, 0, 0};
+        size_t offset = counter_buffer_->stride() * data_buffer_->frame_index();
+        counter_buffer_->Bind();
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, sizeof(counters), counters);
+        gpu_stats_.visible = counters[0];
+        gpu_stats_.frustum_culled = counters[1];
+        gpu_stats_.occlusion_culled = counters[2];
+        std::fill(counters, counters + 3, 0);
+        counter_buffer_->Upload(counters, sizeof(counters), offset);
+    }
+    stats_ = {};
+    cull_pass_.retest = false;
+}
+
+void DrawList::EndFrame() {
+    if (indirect()) {
+        command_buffer_->EndFrame();
+        data_buffer_->EndFrame();
+    }
+    last_stats_ = stats_;
+    last_stats_.visible += gpu_stats_.visible;
+    last_stats_.frustum_culled += gpu_stats_.frustum_culled;
+    last_stats_.occlusion_culled += gpu_stats_.occlusion_culled;
+}
+
+void DrawList::Add(const Mesh* mesh, const glm::mat4& model, const glm::vec4& color) {
+    Add(DrawCommand{mesh, mesh->bounds(), DrawData{model, color, glm::uvec4(0)}});
+}
+
+void DrawList::Record(CommandBuffer* commands, const Mesh* mesh, const glm::mat4& model,
+                      const glm::vec4& color) {
+    commands->Record(DrawCommand{mesh, mesh->bounds(), DrawData{model, color, glm::uvec4(0)}});
+}
+
+void DrawList::Replay(const CommandBuffer& commands) {
+    draws_.reserve(draws_.size() + commands.count());
+    commands.ForEach([this](uint32_t type, const uint8_t* bytes) {
+        if (type == DrawCommand::kType) {
+            Add(CommandBuffer::Read<DrawCommand>(bytes));
+        }
+    });
+}
+
+void DrawList::Add(const DrawCommand& command) {
+    Draw draw;
+    draw.mesh = command.mesh;
+    draw.material = command.mesh->material().get();
+    draw.material_key = draw.material ? draw.material->id() : 0;
+    draw.bounds = command.bounds;
+    draw.data = command.data;
+    if (material_table_) {
+        uint32_t index = material_table_->Register(command.mesh->material());
+        draw.material_key = material_table_->sort_key(index);
+        draw.data.material.x = index;
+    }
+    draws_.push_back(draw);
+}
+
+void DrawList::Submit(const Program* program, const Frustum* frustum, const HiZBuffer* hiz) {
+    cull_pass_.retest = false;
+    if (draws_.empty()) {
+        return;
+    }
+    stats_.draws += draws_.size();
+    if (material_table_) {
+        material_table_->Upload();
+    }
+    if (frustum && gpu_culling()) {
+        SubmitCulled(program, *frustum, hiz);
+        return;
+    }
+
+    order_.clear();
+    if (!frustum) {
+        order_.resize(draws_.size());
+        std::iota(order_.begin(), order_.end(), 0);
+    } else {
+        // tested in parallel, compacted in order so batches come out the same
+        visible_.resize(draws_.size());
+        ThreadPool::Default()->ParallelFor(
+            draws_.size(), kCullGrain, [this, frustum](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    const Draw& draw = draws_[i];
+                    visible_[i] =
+                        frustum->Intersect(Frustum::TransformSphere(draw.data.model, draw.bounds));
+                }
+            });
+        for (uint32_t i = 0; i < (uint32_t)draws_.size(); ++i) {
+            if (visible_[i]) {
+                order_.push_back(i);
+            }
+        }
+    }
+    stats_.visible += order_.size();
+    stats_.frustum_culled += draws_.size() - order_.size();
+    if (indirect()) {
+        SubmitIndirect(program);
+    } else {
+        SubmitDirect(program);
+    }
+}
+
+bool DrawList::Less(uint32_t a, uint32_t b) const {
+    const Draw& l = draws_[a];
+    const Draw& r = draws_[b];
+    return std::make_tuple(l.mesh->pool(), l.mesh->primitive_type(), l.material_key) <
+           std::make_tuple(r.mesh->pool(), r.mesh->primitive_type(), r.material_key);
+}
+
+bool DrawList::SameBatch(uint32_t a, uint32_t b) const {
+    const Draw& l = draws_[a];
+    const Draw& r = draws_[b];
+    // the texture set is the upper half of the key
+    return l.mesh->pool() == r.mesh->pool() &&
+           l.mesh->primitive_type() == r.mesh->primitive_type() &&
+           l.material_key >> 32 == r.material_key >> 32;
+}
+
+void DrawList::SortOrder() {
+    // order_ comes in ascending, so ties broken by index keep draws in the order they were added
+    // within a batch, like a stable sort but without its temporary buffer every frame
+    std::sort(order_.begin(), order_.end(),
+              [this](uint32_t a, uint32_t b) { return Less(a, b) || (!Less(b, a) && a < b); });
+}
+
+void DrawList::BuildBatches() {
+    SortOrder();
+    batches_.clear();
+    for (size_t begin = 0; begin < order_.size();) {
+        size_t end = begin + 1;
+        while (end < order_.size() && SameBatch(order_[begin], order_[end])) {
+            ++end;
+        }
+        batches_.emplace_back(begin, end);
+        begin = end;
+    }
+}
+
+void DrawList::SubmitIndirect(const Program* program) {
+    BuildBatches();
+    for (const auto& batch : batches_) {
+        size_t count = batch.second - batch.first;
+        auto commands = command_buffer_->Map(count * sizeof(DrawElementsIndirectCommand));
+        auto data = data_buffer_->Map(count * sizeof(DrawData));
+        if (!commands.data || !data.data) {
+            command_buffer_->Unmap(commands);
+            data_buffer_->Unmap(data);
+            return;
+        }
+        auto command = (DrawElementsIndirectCommand*)commands.data;
+        auto draw_data = (DrawData*)data.data;
+        for (size_t i = 0; i < count; ++i) {
+            const Draw& draw = draws_[order_[batch.first + i]];
+            const GeometryPool::Range& range = draw.mesh->range();
+            command[i] = {range.index_count, 1, range.first_index, (int32_t)range.base_vertex, 0};
+            draw_data[i] = draw.data;
+        }
+        command_buffer_->Unmap(commands);
+        data_buffer_->Unmap(data);
+
+        const Draw& first = draws_[order_[batch.first]];
+        first.mesh->pool()->Bind();
+        material_table_->Bind(material_table_->texture_set(first.data.material.x), program);
+        data_buffer_->BindRange(kDrawDataBinding, data);
+        command_buffer_->Bind();
+        glMultiDrawElementsIndirect(first.mesh->primitive_type(), GL_UNSIGNED_INT,
+                                    (const void*)commands.offset, (GLsizei)count, 0);
+        ++stats_.draw_calls;
+        GlState::Get().CountDraw();
+    }
+}
+
+void DrawList::SubmitRetest(const Program* program, const HiZBuffer* hiz) {
+    if (!cull_pass_.retest || !hiz || !hiz->valid()) {
+        return;
+    }
+    cull_pass_.retest = false;
+
+    cull_program_->Use();
+    cull_program_->SetUniform("retest", true);
+    BindHiZ(hiz);
+    CullAndDraw(program);
+}
+
+void DrawList::SubmitCulled(const Program* program, const Frustum& frustum,
+                            const HiZBuffer* hiz) {
+    order_.resize(draws_.size());
+    std::iota(order_.begin(), order_.end(), 0);
+    BuildBatches();
+
+    // every batch reserves room for all of its draws, cull.cs fills it from the front
+    cull_pass_.first_slots.resize(batches_.size());
+    cull_pass_.slot_count = 0;
+    for (size_t b = 0; b < batches_.size(); ++b) {
+        size_t count = batches_[b].second - batches_[b].first;
+        cull_pass_.first_slots[b] = cull_pass_.slot_count;
+        cull_pass_.slot_count +=
+            (count + slot_granularity_ - 1) / slot_granularity_ * slot_granularity_;
+    }
+
+    auto inputs = data_buffer_->Map(draws_.size() * sizeof(CullInput));
+    auto occluded = data_buffer_->Reserve(draws_.size() * sizeof(uint32_t), ssbo_alignment_);
+    if (!inputs.data || !occluded.size) {
+        data_buffer_->Unmap(inputs);
+        return;
+    }
+    auto input = (CullInput*)inputs.data;
+    for (size_t b = 0; b < batches_.size(); ++b) {
+        for (size_t i = batches_[b].first; i < batches_[b].second; ++i) {
+            const Draw& draw = draws_[order_[i]];
+            const GeometryPool::Range& range = draw.mesh->range();
+            input[i].data = draw.data;
+            input[i].bounds = draw.bounds;
+            input[i].command =
+                glm::uvec4(range.index_count, range.first_index, range.base_vertex, (uint32_t)b);
+            input[i].slots = glm::uvec4((uint32_t)cull_pass_.first_slots[b], 0, 0, 0);
+        }
+    }
+    data_buffer_->Unmap(inputs);
+    cull_pass_.inputs = inputs;
+    cull_pass_.occluded = occluded;
+
+    // validation compares against the frustum test alone
+    bool occlusion = hiz && hiz->valid() && !validate_culling_;
+    cull_program_->Use();
+    cull_program_->SetUniform("retest", false);
+    cull_program_->SetUniform("planes", frustum.planes, 6);
+    cull_program_->SetUniform("occlusion", occlusion);
+    if (occlusion) {
+        BindHiZ(hiz);
+    }
+    CullAndDraw(program);
+    cull_pass_.retest = occlusion;
+
+    if (validate_culling_) {
+        ValidateCulling(frustum);
+    }
+}
+
+void DrawList::BindHiZ(const HiZBuffer* hiz) {
+    GlState::Get().ActiveTexture(HiZBuffer::kTextureUnit);
+    GlState::Get().BindTexture(GL_TEXTURE_2D, hiz->id());
+    GlState::Get().ActiveTexture(0);
+    cull_program_->SetUniform("hiz", HiZBuffer::kTextureUnit);
+    cull_program_->SetUniform("hizViewProjection", hiz->view_projection());
+    cull_program_->SetUniform("hizLevelCount", hiz->level_count());
+}
+
+void DrawList::CullAndDraw(const Program* program) {
+    const auto& first_slots = cull_pass_.first_slots;
+    size_t slot_count = cull_pass_.slot_count;
+    auto outputs = data_buffer_->Reserve(slot_count * sizeof(DrawData),
+                                         slot_granularity_ * sizeof(DrawData));
+    auto counts = data_buffer_->Reserve(batches_.size() * sizeof(uint32_t), ssbo_alignment_);
+    auto commands = command_buffer_->Reserve(
+        slot_count * sizeof(DrawElementsIndirectCommand), ssbo_alignment_);
+    counts_ = {};
+    if (!outputs.size || !counts.size || !commands.size) {
+        return;
+    }
+    counts_ = counts;
+
+    data_buffer_->Bind();
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, counts_.offset, counts_.size,
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    if (!count_draws_) {
+        // drawn with the batch size as count, so the slots nothing was written to must be empty
+        command_buffer_->Bind();
+        glClearBufferSubData(GL_DRAW_INDIRECT_BUFFER, GL_R32UI, commands.offset, commands.size,
+                             GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+
+    cull_program_->Use();
+    cull_program_->SetUniform("drawCount", (int)draws_.size());
+    const auto& inputs = cull_pass_.inputs;
+    const auto& occluded = cull_pass_.occluded;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, data_buffer_->id(), inputs.offset, inputs.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, command_buffer_->id(), commands.offset,
+                      commands.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, data_buffer_->id(), outputs.offset,
+                      outputs.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, data_buffer_->id(), counts_.offset,
+                      counts_.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 4, data_buffer_->id(), occluded.offset,
+                      occluded.size);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 5, counter_buffer_->id(),
+                      counter_buffer_->stride() * data_buffer_->frame_index(),
+                      counter_buffer_->stride());
+    glDispatchCompute((GLuint)((draws_.size() + 63) / 64), 1, 1);
+    GlState::Get().CountDispatch();
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    program->Use();
+    for (size_t b = 0; b < batches_.size(); ++b) {
+        size_t count = batches_[b].second - batches_[b].first;
+        const Draw& first = draws_[order_[batches_[b].first]];
+        first.mesh->pool()->Bind();
+        material_table_->Bind(material_table_->texture_set(first.data.material.x), program);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, kDrawDataBinding, data_buffer_->id(),
+                          outputs.offset + first_slots[b] * sizeof(DrawData),
+                          count * sizeof(DrawData));
+        command_buffer_->Bind();
+        auto indirect = (const void*)(commands.offset +
+                                      first_slots[b] * sizeof(DrawElementsIndirectCommand));
+        if (count_draws_) {
+            glBindBuffer(GL_PARAMETER_BUFFER, data_buffer_->id());
+            GLintptr draw_count = counts_.offset + b * sizeof(uint32_t);
+            if (GLAD_GL_VERSION_4_6) {
+                glMultiDrawElementsIndirectCount(first.mesh->primitive_type(), GL_UNSIGNED_INT,
+                                                 indirect, draw_count, (GLsizei)count, 0);
+            } else {
+                glMultiDrawElementsIndirectCountARB(first.mesh->primitive_type(), GL_UNSIGNED_INT,
+                                                    indirect, draw_count, (GLsizei)count, 0);
+            }
+        } else {
+            glMultiDrawElementsIndirect(first.mesh->primitive_type(), GL_UNSIGNED_INT, indirect,
+                                        (GLsizei)count, 0);
+        }
+        ++stats_.draw_calls;
+        GlState::Get().CountDraw();
+    }
+}
+
+void DrawList::ValidateCulling(const Frustum& frustum) {
+    if (!counts_.size) {
+        return;
+    }
+    std::vector<uint32_t> gpu_counts(batches_.size());
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    data_buffer_->Bind();
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, counts_.offset, counts_.size, gpu_counts.data());
+
+    for (size_t b = 0; b < batches_.size(); ++b) {
+        size_t cpu_count = 0;
+        for (size_t i = batches_[b].first; i < batches_[b].second; ++i) {
+            const Draw& draw = draws_[order_[i]];
+            if (frustum.Intersect(Frustum::TransformSphere(draw.data.model, draw.bounds))) {
+                ++cpu_count;
+            }
+        }
+        if (cpu_count != gpu_counts[b]) {
+            SPDLOG_WARN("gpu culling mismatch in batch {}: {} visible on the gpu, {} on the cpu",
+                        b, gpu_counts[b], cpu_count);
+        }
+    }
+}
+
+void DrawList::SubmitDirect(const Program* program) {
+    SortOrder();
+    const Material* material = nullptr;
+    for (auto index : order_) {
+        const Draw& draw = draws_[index];
+        program->SetUniform("model", draw.data.model);
+        program->SetUniform("color", draw.data.color);
+        if (draw.material && draw.material != material) {
+            draw.material->SetToProgram(program);
+            material = draw.material;
+        }
+        draw.mesh->pool()->Bind();
+        draw.mesh->pool()->Draw(draw.mesh->primitive_type(), draw.mesh->range());
+        ++stats_.draw_calls;
+    }
+}
\ No newline at end of file
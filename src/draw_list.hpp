@@ -0,0 +1,171 @@
+#ifndef INCLUDED_DRAW_LIST_HPP
+#define INCLUDED_DRAW_LIST_HPP
+
+#include "buffer.hpp"
+#include "command_buffer.hpp"
+#include "common.hpp"
+#include "dynamic_buffer.hpp"
+#include "frustum.hpp"
+#include "hiz_buffer.hpp"
+#include "material_table.hpp"
+#include "mesh.hpp"
+#include "program.hpp"
+
+// matches the layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+// per-draw data, std430 array indexed by gl_DrawIDARB in the *_indirect shaders
+struct DrawData {
+    glm::mat4 model;
+    glm::vec4 color;
+    glm::uvec4 material; // x: MaterialTable index
+};
+
+// a draw recorded off the GL thread, DrawList::Replay adds it to the list
+struct DrawCommand {
+    static const uint32_t kType = 1;
+
+    const Mesh* mesh;
+    glm::vec4 bounds;
+    DrawData data; // material is filled in on replay
+};
+
+// one entry of the cull.cs input array
+struct CullInput {
+    DrawData data;
+    glm::vec4 bounds;
+    glm::uvec4 command; // index count, first index, base vertex, batch
+    glm::uvec4 slots;   // x: first output slot of the batch
+};
+
+// Collects the draws of one pass and submits them with one glMultiDrawElementsIndirect per
+// texture set of the material table. Commands and DrawData are streamed through DynamicBuffers,
+// so a list can be refilled and submitted several times a frame. Without GL 4.3 and
+// ARB_shader_draw_parameters Submit falls back to one draw call per entry, setting the "model"
+// and "color" uniforms, sorted by material so a material is set once per run of its draws.
+//
+// When a frustum is given, the indirect path culls in cull.cs: every entry is tested on the GPU
+// and the visible ones are compacted into the commands and DrawData of their batch. The direct
+// path tests the same bounds on the CPU, in jobs of the thread pool for long lists.
+//
+// Given a Hi-Z pyramid, cull.cs also drops what lies behind it. The pyramid is the one of the
+// last frame, so entries it hides are remembered and SubmitRetest draws the ones a pyramid of
+// the current depth no longer hides, otherwise an object coming into view shows up a frame late.
+class DrawList {
+  public:
+    struct Stats {
+        size_t draws{0};
+        size_t visible{0};
+        size_t frustum_culled{0};
+        size_t occlusion_culled{0};
+        size_t draw_calls{0};
+    };
+
+    static const uint32_t kDrawDataBinding = 0;
+
+    static std::unique_ptr<DrawList> Create(size_t max_draws_per_frame);
+    static bool IsIndirectSupported();
+    ~DrawList();
+
+    void BeginFrame();
+    void EndFrame();
+
+    void Clear() { draws_.clear(); }
+    void Add(const Mesh* mesh, const glm::mat4& model, const glm::vec4& color = glm::vec4(1.0f));
+    // the part of Add that needs no GL and no list, safe on any thread
+    static void Record(CommandBuffer* commands, const Mesh* mesh, const glm::mat4& model,
+                       const glm::vec4& color = glm::vec4(1.0f));
+    // adds the DrawCommands of `commands` in the order they were recorded
+    void Replay(const CommandBuffer& commands);
+    // the program has to be the *_indirect variant when indirect() is true
+    void Submit(const Program* program, const Frustum* frustum = nullptr,
+                const HiZBuffer* hiz = nullptr);
+    // draws what the last Submit occluded but `hiz` does not, call it before any other Submit
+    void SubmitRetest(const Program* program, const HiZBuffer* hiz);
+
+    inline bool indirect() const { return command_buffer_ != nullptr; }
+    inline bool gpu_culling() const { return cull_program_ != nullptr && gpu_culling_; }
+    inline void set_gpu_culling(bool enable) { gpu_culling_ = enable; }
+    // reads the visible counts back and compares them to a CPU test, stalls the pipeline
+    inline bool validate_culling() const { return validate_culling_; }
+    inline void set_validate_culling(bool enable) { validate_culling_ = enable; }
+    inline size_t size() const { return draws_.size(); }
+    // nullptr on the direct path
+    inline const MaterialTable* material_table() const { return material_table_.get(); }
+    // counters of the last finished frame, the GPU culling ones arrive a few frames late
+    inline const Stats& stats() const { return last_stats_; }
+
+  private:
+    // draws per job of the CPU frustum test, small lists stay on the calling thread
+    static const size_t kCullGrain = 512;
+
+    struct Draw {
+        const Mesh* mesh;
+        const Material* material;
+        // MaterialTable::sort_key, the material id on the direct path
+        uint64_t material_key;
+        glm::vec4 bounds;
+        DrawData data;
+    };
+
+    // what SubmitRetest needs of the last culled Submit
+    struct CullPass {
+        DynamicBuffer::Allocation inputs;
+        DynamicBuffer::Allocation occluded;
+        std::vector<size_t> first_slots;
+        size_t slot_count{0};
+        bool retest{false};
+    };
+
+    DrawList();
+    bool Init(size_t max_draws_per_frame);
+
+    // registers the material, which may copy its textures into the material table
+    void Add(const DrawCommand& command);
+
+    // by pool, primitive type and material key
+    bool Less(uint32_t a, uint32_t b) const;
+    bool SameBatch(uint32_t a, uint32_t b) const;
+    // order_ by Less, draws of a batch in the order they were added
+    void SortOrder();
+    // sorts order_ and splits it into batches of equal pool / primitive type / texture set
+    void BuildBatches();
+    void SubmitIndirect(const Program* program);
+    void SubmitCulled(const Program* program, const Frustum& frustum, const HiZBuffer* hiz);
+    // runs cull.cs over cull_pass_ and draws the compacted batches
+    void CullAndDraw(const Program* program);
+    void BindHiZ(const HiZBuffer* hiz);
+    void SubmitDirect(const Program* program);
+    // compares the batch counts of the last CullAndDraw with a CPU frustum test
+    void ValidateCulling(const Frustum& frustum);
+
+    std::vector<Draw> draws_;
+    std::vector<uint32_t> order_;
+    // CPU frustum test results, not vector<bool> since jobs write neighbouring entries
+    std::vector<uint8_t> visible_;
+    std::vector<std::pair<size_t, size_t>> batches_;
+    std::unique_ptr<DynamicBuffer> command_buffer_{nullptr};
+    std::unique_ptr<DynamicBuffer> data_buffer_{nullptr};
+    std::unique_ptr<Program> cull_program_{nullptr};
+    std::unique_ptr<MaterialTable> material_table_{nullptr};
+    // visible / frustum culled / occlusion culled counters of cull.cs, one range per frame
+    std::unique_ptr<Buffer> counter_buffer_{nullptr};
+    CullPass cull_pass_;
+    DynamicBuffer::Allocation counts_;
+    size_t ssbo_alignment_{4};
+    size_t slot_granularity_{1};
+    bool count_draws_{false};
+    bool gpu_culling_{true};
+    bool validate_culling_{false};
+    Stats stats_;
+    Stats gpu_stats_;
+    Stats last_stats_;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "dynamic_buffer.hpp"
+
+DynamicBuffer::DynamicBuffer() {}
+
+DynamicBuffer::~DynamicBuffer() {
+    for (auto fence : fences_) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (id_) {
+        if (persistent_data_) {
+            Bind();
+            glUnmapBuffer(buffer_type_);
+        }
+        glDeleteBuffers(1, &id_);
+    }
+}
+
+std::unique_ptr<DynamicBuffer> DynamicBuffer::Create(uint32_t buffer_type, size_t frame_size,
+                                                     int frame_count) {
+    auto buffer = std::unique_ptr<DynamicBuffer>(new DynamicBuffer());
+    if (!buffer->Init(buffer_type, frame_size, frame_count)) {
+        return nullptr;
+    }
+
+    return std::move(buffer);
+}
+
+bool DynamicBuffer::Init(uint32_t buffer_type, size_t frame_size, int frame_count) {
+    buffer_type_ = buffer_type;
+    fences_.resize(frame_count, nullptr);
+
+    int alignment = 0;
+    if (buffer_type_ == GL_UNIFORM_BUFFER) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    } else if (buffer_type_ == GL_SHADER_STORAGE_BUFFER && GLAD_GL_VERSION_4_3) {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+    alignment_ = std::max<size_t>(alignment_, alignment);
+    frame_size_ = (frame_size + alignment_ - 1) / alignment_ * alignment_;
+    size_t total_size = frame_size_ * frame_count;
+
+    glGenBuffers(1, &id_);
+    Bind();
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(buffer_type_, total_size, nullptr, flags);
+        persistent_data_ = (uint8_t*)glMapBufferRange(buffer_type_, 0, total_size, flags);
+        if (!persistent_data_) {
+            SPDLOG_ERROR("failed to map persistent buffer");
+            return false;
+        }
+    } else {
+        glBufferData(buffer_type_, total_size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(buffer_type_, 0);
+
+    return true;
+}
+
+void DynamicBuffer::BeginFrame() {
+    frame_index_ = (frame_index_ + 1) % (int)fences_.size();
+    head_ = 0;
+
+    // only blocks when the CPU runs more than frame_count frames ahead of the GPU
+    GLsync& fence = fences_[frame_index_];
+    if (fence) {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void DynamicBuffer::EndFrame() {
+    fences_[frame_index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+DynamicBuffer::Allocation DynamicBuffer::Reserve(size_t size, size_t alignment) {
+    // aligned in the whole buffer, not only in the segment, so odd alignments work too
+    alignment = std::max(alignment, alignment_);
+    size_t base = frame_size_ * frame_index_;
+    size_t offset = (base + head_ + alignment - 1) / alignment * alignment - base;
+    if (offset + size > frame_size_) {
+        SPDLOG_ERROR("dynamic buffer overflow: {} bytes requested, {} of {} used", size, head_,
+                     frame_size_);
+        return {};
+    }
+    head_ = offset + size;
+
+    Allocation allocation;
+    allocation.offset = base + offset;
+    allocation.size = size;
+
+    return allocation;
+}
+
+DynamicBuffer::Allocation DynamicBuffer::Map(size_t size, size_t alignment) {
+    Allocation allocation = Reserve(size, alignment);
+    if (allocation.size == 0) {
+        return allocation;
+    }
+    GlState::Get().CountBufferUpload(size);
+    if (persistent_data_) {
+        allocation.data = persistent_data_ + allocation.offset;
+    } else {
+        // the fence in BeginFrame already guarantees the GPU is done with this range
+        Bind();
+        allocation.data = glMapBufferRange(buffer_type_, allocation.offset, size,
+                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                               GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+
+    return allocation;
+}
+
+void DynamicBuffer::Unmap(const Allocation& allocation) {
+    if (!persistent_data_ && allocation.data) {
+        Bind();
+        glUnmapBuffer(buffer_type_);
+    }
+}
+
+DynamicBuffer::Allocation DynamicBuffer::Upload(const void* data, size_t size, size_t alignment) {
+    Allocation allocation = Map(size, alignment);
+    if (allocation.data) {
+        memcpy(allocation.data, data, size);
+        Unmap(allocation);
+    }
+
+    return allocation;
+}
+
+void DynamicBuffer::BindRange(uint32_t index, const Allocation& allocation) const {
+    // an overflowed frame, binding a range of size 0 is GL_INVALID_VALUE
+    if (allocation.size == 0) {
+        return;
+    }
+    glBindBufferRange(buffer_type_, index, id_, allocation.offset, allocation.size);
+    GlState::Get().CountBufferBind();
+}
@@ -0,0 +1,61 @@
+#ifndef INCLUDED_DYNAMIC_BUFFER_HPP
+#define INCLUDED_DYNAMIC_BUFFER_HPP
+
+#include "common.hpp"
+#include "gl_state.hpp"
+
+// Ring of `frame_count` segments for data rewritten every frame (uniforms, instance data, debug
+// geometry). A fence per segment keeps the CPU from overwriting what the GPU may still read, so
+// writes never need an implicit sync. Uses a persistent coherent mapping when glBufferStorage is
+// available and unsynchronized glMapBufferRange otherwise.
+class DynamicBuffer {
+  public:
+    struct Allocation {
+        void* data{nullptr};
+        size_t offset{0};
+        size_t size{0};
+    };
+
+    static std::unique_ptr<DynamicBuffer> Create(uint32_t buffer_type, size_t frame_size,
+                                                 int frame_count = 3);
+    ~DynamicBuffer();
+
+    void BeginFrame();
+    void EndFrame();
+
+    // data stays writable until Unmap; returns an empty allocation when the frame is full
+    Allocation Map(size_t size, size_t alignment = 0);
+    // a range only the GPU writes to (compute output, cleared counters), never mapped
+    Allocation Reserve(size_t size, size_t alignment = 0);
+    void Unmap(const Allocation& allocation);
+    Allocation Upload(const void* data, size_t size, size_t alignment = 0);
+
+    void Bind() const {
+        glBindBuffer(buffer_type_, id_);
+        GlState::Get().CountBufferBind();
+    }
+    // does nothing for an empty allocation, the binding point keeps what it had
+    void BindRange(uint32_t index, const Allocation& allocation) const;
+
+    inline uint32_t id() const { return id_; }
+    inline bool persistent() const { return persistent_data_ != nullptr; }
+    inline size_t frame_size() const { return frame_size_; }
+    inline size_t used() const { return head_; }
+    inline int frame_index() const { return frame_index_; }
+    inline int frame_count() const { return (int)fences_.size(); }
+
+  private:
+    DynamicBuffer();
+    bool Init(uint32_t buffer_type, size_t frame_size, int frame_count);
+
+    uint32_t id_{0};
+    uint32_t buffer_type_{0};
+    size_t frame_size_{0};
+    size_t alignment_{16};
+    int frame_index_{0};
+    size_t head_{0};
+    uint8_t* persistent_data_{nullptr};
+    std::vector<GLsync> fences_;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+std::unique_ptr<FrameArena> FrameArena::Create(size_t capacity) {
+    auto arena = std::unique_ptr<FrameArena>(new FrameArena());
+    if (!arena->Init(capacity)) {
+        return nullptr;
+    }
+
+    return std::move(arena);
+}
+
+bool FrameArena::Init(size_t capacity) {
+    if (capacity == 0) {
+        SPDLOG_ERROR("frame arena needs a capacity");
+        return false;
+    }
+    for (auto& half : halves_) {
+        half.block.data = std::make_unique<uint8_t[]>(capacity);
+        half.block.size = capacity;
+    }
+
+    return true;
+}
+
+void FrameArena::BeginFrame() {
+    current_ ^= 1;
+    Half& half = halves_[current_];
+    // the frames so far fit into one block from now on
+    if (half.block.size < high_watermark_) {
+        size_t capacity = half.block.size;
+        while (capacity < high_watermark_) {
+            capacity *= 2;
+        }
+        half.block.data = std::make_unique<uint8_t[]>(capacity);
+        half.block.size = capacity;
+    }
+    half.spilled.clear();
+    half.head = 0;
+    half.used = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+    Half& half = halves_[current_];
+    Block* block = half.spilled.empty() ? &half.block : &half.spilled.back();
+    // blocks come from new[], aligned for any alignment up to max_align_t
+    size_t offset = (half.head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > block->size) {
+        half.used += block->size - half.head;
+        Block spilled;
+        spilled.size = std::max(size, half.block.size);
+        spilled.data = std::make_unique<uint8_t[]>(spilled.size);
+        half.spilled.push_back(std::move(spilled));
+        ++spilled_blocks_;
+        block = &half.spilled.back();
+        half.head = 0;
+        offset = 0;
+    }
+    half.used += offset + size - half.head;
+    half.head = offset + size;
+    high_watermark_ = std::max(high_watermark_, half.used);
+
+    return block->data.get() + offset;
+}
+
+const char* FrameArena::Copy(const char* text) {
+    size_t size = strlen(text) + 1;
+    char* copy = Allocate<char>(size);
+    memcpy(copy, text, size);
+
+    return copy;
+}
+
+FrameArena::Stats FrameArena::stats() const {
+    Stats stats;
+    stats.used = halves_[current_].used;
+    stats.capacity = halves_[current_].block.size;
+    stats.high_watermark = high_watermark_;
+    stats.spilled_blocks = spilled_blocks_;
+
+    return stats;
+}
@@ -0,0 +1,89 @@
+#ifndef INCLUDED_FRAME_ARENA_HPP
+#define INCLUDED_FRAME_ARENA_HPP
+
+#include "common.hpp"
+
+#include <cstddef>
+
+// Bump allocator for data that lives no longer than a frame: an allocation moves a pointer and
+// nothing is freed on its own, BeginFrame drops a whole frame at once. Two halves take turns, so
+// what frame N allocated stays valid until frame N + 2 begins, e.g. the frame graph of the last
+// frame for debug views. A frame that outgrows its half spills into heap blocks and the half
+// grows to the high watermark when its turn comes again, after that the frame loop allocates
+// from the arena only.
+//
+// Not thread-safe, it belongs to the render thread.
+class FrameArena {
+  public:
+    struct Stats {
+        size_t used{0};           // by the current frame
+        size_t capacity{0};       // of the current half
+        size_t high_watermark{0}; // most any frame used
+        size_t spilled_blocks{0}; // heap blocks frames had to take, in total
+    };
+
+    static std::unique_ptr<FrameArena> Create(size_t capacity = 64 * 1024);
+
+    // switches to the other half and drops what it held
+    void BeginFrame();
+
+    // never null, alignment is a power of two no larger than alignof(std::max_align_t)
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template <typename T> T* Allocate(size_t count) {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+    // a copy of the terminated string
+    const char* Copy(const char* text);
+
+    Stats stats() const;
+
+  private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size{0};
+    };
+
+    struct Half {
+        Block block;
+        std::vector<Block> spilled; // in the order the frame took them, the last one is current
+        size_t head{0};             // into the current block
+        size_t used{0};             // all blocks, alignment padding included
+    };
+
+    FrameArena() {}
+    bool Init(size_t capacity);
+
+    Half halves_[2];
+    int current_{0};
+    size_t high_watermark_{0};
+    size_t spilled_blocks_{0};
+};
+
+// STL allocator handing out arena memory. deallocate does nothing, a container that grows leaves
+// its old storage behind until the frame is dropped, so reserve when the size is known
+template <typename T> class FrameAllocator {
+  public:
+    using value_type = T;
+
+    FrameAllocator(FrameArena* arena) : arena_(arena) {}
+    template <typename U> FrameAllocator(const FrameAllocator<U>& other) : arena_(other.arena()) {}
+
+    T* allocate(size_t count) { return arena_->Allocate<T>(count); }
+    void deallocate(T*, size_t) {}
+
+    inline FrameArena* arena() const { return arena_; }
+
+    template <typename U> bool operator==(const FrameAllocator<U>& other) const {
+        return arena_ == other.arena();
+    }
+    template <typename U> bool operator!=(const FrameAllocator<U>& other) const {
+        return arena_ != other.arena();
+    }
+
+  private:
+    FrameArena* arena_;
+};
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
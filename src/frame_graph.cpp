@@ -0,0 +1,385 @@
+#include "frame_graph.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+size_t BytesPerPixel(uint32_t inner_format) {
+    switch (inner_format) {
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+    case GL_R16F:
+        return 2;
+    case GL_RGB8:
+        return 3;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_RGB16F:
+        return 6;
+    case GL_RGBA32F:
+        return 16;
+    case GL_RGB32F:
+        return 12;
+    default: // RGBA8, RG16F, R32F, DEPTH24_STENCIL8, ...
+        return 4;
+    }
+}
+
+size_t TextureBytes(const FrameGraph::TextureDesc& desc) {
+    return static_cast<size_t>(desc.width) * desc.height * BytesPerPixel(desc.inner_format);
+}
+
+} // namespace
+
+std::unique_ptr<FrameGraph> FrameGraph::Create(FrameArena* arena) {
+    auto graph = std::unique_ptr<FrameGraph>(new FrameGraph());
+    graph->arena_ = arena;
+
+    return std::move(graph);
+}
+
+FrameGraph::~FrameGraph() {
+    Reset();
+}
+
+void FrameGraph::Reset() {
+    for (auto& pass : passes_) {
+        pass.execute.destroy(pass.execute.closure);
+    }
+    resources_.clear();
+    passes_.clear();
+    order_.clear();
+    compiled_ = false;
+}
+
+FrameGraph::Handle FrameGraph::CreateTexture(const char* name, const TextureDesc& desc) {
+    resources_.push_back(Resource{arena_->Copy(name), desc, false, nullptr,
+                                  FrameVector<int>(arena_), FrameVector<int>(arena_), -1});
+
+    return Handle{static_cast<int>(resources_.size()) - 1};
+}
+
+FrameGraph::Handle FrameGraph::Import(const char* name, std::shared_ptr<BaseTexture> texture) {
+    TextureDesc desc{0, 0, GL_NONE, GL_NONE, GL_NONE};
+    if (auto texture_2d = dynamic_cast<const Texture2d*>(texture.get())) {
+        desc = TextureDesc{texture_2d->width(), texture_2d->height(), texture_2d->inner_format(),
+                           texture_2d->format(), texture_2d->type()};
+    }
+    resources_.push_back(Resource{arena_->Copy(name), desc, true, std::move(texture),
+                                  FrameVector<int>(arena_), FrameVector<int>(arena_), -1});
+
+    return Handle{static_cast<int>(resources_.size()) - 1};
+}
+
+void FrameGraph::AddPass(const char* name, HandleList reads, HandleList writes,
+                         PassFunction execute) {
+    Pass pass{arena_->Copy(name), FrameVector<int>(arena_), FrameVector<int>(arena_), execute,
+              false};
+    pass.reads.reserve(reads.size());
+    pass.writes.reserve(writes.size());
+    int index = static_cast<int>(passes_.size());
+    for (auto handle : reads) {
+        pass.reads.push_back(handle.index);
+        resources_[handle.index].readers.push_back(index);
+    }
+    for (auto handle : writes) {
+        pass.writes.push_back(handle.index);
+        resources_[handle.index].writers.push_back(index);
+    }
+    passes_.push_back(std::move(pass));
+}
+
+bool FrameGraph::Compile() {
+    compiled_ = false;
+    for (const auto& resource : resources_) {
+        if (!resource.imported && resource.writers.empty() && !resource.readers.empty()) {
+            SPDLOG_ERROR("frame graph: \"{}\" is read but never written", resource.name);
+            return false;
+        }
+    }
+    if (!SortPasses()) {
+        return false;
+    }
+    CullPasses();
+    AllocateTextures();
+    compiled_ = true;
+
+    return true;
+}
+
+// Kahn's algorithm, ties go to the pass added first
+bool FrameGraph::SortPasses() {
+    FrameAllocator<int> allocator(arena_);
+    FrameVector<FrameVector<int>> edges(passes_.size(), FrameVector<int>(allocator), allocator);
+    FrameVector<int> in_degree(passes_.size(), 0, allocator);
+    auto add_edge = [&](int from, int to) {
+        if (from != to) {
+            edges[from].push_back(to);
+            ++in_degree[to];
+        }
+    };
+    for (const auto& resource : resources_) {
+        // writers of one resource keep the order they were added in
+        for (size_t i = 1; i < resource.writers.size(); ++i) {
+            add_edge(resource.writers[i - 1], resource.writers[i]);
+        }
+        // a read sees the last write added before it and is done before the next write. Without
+        // an earlier write an imported resource or a pass also writing it sees what was there
+        // before, any other read waits for the last write
+        for (int reader : resource.readers) {
+            auto next = std::lower_bound(resource.writers.begin(), resource.writers.end(), reader);
+            bool has_previous = next != resource.writers.begin();
+            bool writes_too = next != resource.writers.end() && *next == reader;
+            if (has_previous) {
+                add_edge(*(next - 1), reader);
+            } else if (!resource.imported && !writes_too && !resource.writers.empty()) {
+                add_edge(resource.writers.back(), reader);
+                continue;
+            }
+            if (writes_too) {
+                ++next;
+            }
+            if (next != resource.writers.end()) {
+                add_edge(reader, *next);
+            }
+        }
+    }
+
+    order_.clear();
+    FrameVector<int> ready(allocator);
+    ready.reserve(passes_.size());
+    for (size_t i = 0; i < passes_.size(); ++i) {
+        if (in_degree[i] == 0) {
+            ready.push_back(static_cast<int>(i));
+        }
+    }
+    while (!ready.empty()) {
+        auto first = std::min_element(ready.begin(), ready.end());
+        int pass = *first;
+        ready.erase(first);
+        order_.push_back(pass);
+        for (int next : edges[pass]) {
+            if (--in_degree[next] == 0) {
+                ready.push_back(next);
+            }
+        }
+    }
+    if (order_.size() != passes_.size()) {
+        SPDLOG_ERROR("frame graph: passes depend on each other in a cycle");
+        return false;
+    }
+
+    return true;
+}
+
+// walks back from the passes writing imported resources, a pass lives when a live pass reads
+// something it writes
+void FrameGraph::CullPasses() {
+    FrameVector<bool> needed(resources_.size(), false, FrameAllocator<bool>(arena_));
+    for (size_t i = 0; i < resources_.size(); ++i) {
+        needed[i] = resources_[i].imported;
+    }
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        auto& pass = passes_[*it];
+        pass.culled = std::none_of(pass.writes.begin(), pass.writes.end(),
+                                   [&](int resource) { return needed[resource]; });
+        if (!pass.culled) {
+            for (int resource : pass.reads) {
+                needed[resource] = true;
+            }
+        }
+    }
+}
+
+void FrameGraph::AllocateTextures() {
+    // first and last live pass, as positions in order_
+    FrameVector<std::pair<int, int>> lifetimes(resources_.size(), {-1, -1},
+                                               FrameAllocator<std::pair<int, int>>(arena_));
+    for (size_t position = 0; position < order_.size(); ++position) {
+        const auto& pass = passes_[order_[position]];
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto* list : {&pass.reads, &pass.writes}) {
+            for (int resource : *list) {
+                auto& lifetime = lifetimes[resource];
+                if (lifetime.first < 0) {
+                    lifetime.first = static_cast<int>(position);
+                }
+                lifetime.second = static_cast<int>(position);
+            }
+        }
+    }
+
+    for (auto& pooled : pool_) {
+        pooled.used = false;
+    }
+    // the pool only grows while the frame allocates, room for every transient is enough
+    FrameVector<bool> in_use(pool_.size(), false, FrameAllocator<bool>(arena_));
+    in_use.reserve(pool_.size() + resources_.size());
+    stats_ = Stats();
+    for (size_t position = 0; position < order_.size(); ++position) {
+        // everything a pass touches is acquired before the ones it touches last are released
+        for (size_t i = 0; i < resources_.size(); ++i) {
+            auto& resource = resources_[i];
+            if (resource.imported || lifetimes[i].first != static_cast<int>(position)) {
+                continue;
+            }
+            size_t pooled = 0;
+            while (pooled < pool_.size() &&
+                   (in_use[pooled] || !(pool_[pooled].desc == resource.desc))) {
+                ++pooled;
+            }
+            if (pooled == pool_.size()) {
+                const auto& desc = resource.desc;
+                std::shared_ptr<Texture2d> texture = Texture2d::Create(
+                    desc.width, desc.height, desc.inner_format, desc.format, desc.type);
+                if (desc.format == GL_DEPTH_STENCIL || desc.format == GL_DEPTH_COMPONENT) {
+                    texture->SetFilter(GL_NEAREST, GL_NEAREST);
+                }
+                pool_.push_back(PooledTexture{desc, texture, false});
+                in_use.push_back(false);
+            }
+            in_use[pooled] = true;
+            pool_[pooled].used = true;
+            resource.pooled = static_cast<int>(pooled);
+            resource.texture = pool_[pooled].texture;
+            ++stats_.transients;
+            stats_.requested_bytes += TextureBytes(resource.desc);
+        }
+        for (size_t i = 0; i < resources_.size(); ++i) {
+            if (resources_[i].pooled >= 0 && lifetimes[i].second == static_cast<int>(position)) {
+                in_use[resources_[i].pooled] = false;
+            }
+        }
+    }
+
+    // textures this frame did not ask for go, and so do the framebuffers made of them
+    size_t kept = 0;
+    FrameVector<int> remap(pool_.size(), -1, FrameAllocator<int>(arena_));
+    for (size_t i = 0; i < pool_.size(); ++i) {
+        if (pool_[i].used) {
+            remap[i] = static_cast<int>(kept);
+            pool_[kept++] = std::move(pool_[i]);
+        }
+    }
+    if (kept != pool_.size()) {
+        pool_.resize(kept);
+        framebuffers_.clear();
+        for (auto& resource : resources_) {
+            if (resource.pooled >= 0) {
+                resource.pooled = remap[resource.pooled];
+            }
+        }
+    }
+
+    stats_.passes = passes_.size();
+    stats_.culled_passes =
+        std::count_if(passes_.begin(), passes_.end(), [](const Pass& pass) { return pass.culled; });
+    stats_.textures = pool_.size();
+    for (const auto& pooled : pool_) {
+        stats_.allocated_bytes += TextureBytes(pooled.desc);
+    }
+}
+
+void FrameGraph::Execute() {
+    if (!compiled_) {
+        return;
+    }
+    for (int index : order_) {
+        if (passes_[index].culled) {
+            continue;
+        }
+        if (profiler_) {
+            Profiler::Scope scope(profiler_, passes_[index].name);
+            passes_[index].execute.call(passes_[index].execute.closure, *this);
+        } else {
+            passes_[index].execute.call(passes_[index].execute.closure, *this);
+        }
+    }
+}
+
+Framebuffer* FrameGraph::framebuffer(HandleList colors, Handle depth_stencil) {
+    framebuffer_key_.clear();
+    for (auto handle : colors) {
+        auto color = texture(handle);
+        if (!color) {
+            SPDLOG_ERROR("frame graph: \"{}\" is no 2d texture", resources_[handle.index].name);
+            return nullptr;
+        }
+        framebuffer_key_.push_back(color->id());
+    }
+    const Texture2d* depth = depth_stencil.valid() ? texture(depth_stencil) : nullptr;
+    framebuffer_key_.push_back(depth ? depth->id() : 0);
+
+    auto it = framebuffers_.find(framebuffer_key_);
+    if (it == framebuffers_.end()) {
+        std::vector<std::shared_ptr<Texture2d>> color_textures;
+        for (auto handle : colors) {
+            color_textures.push_back(
+                std::static_pointer_cast<Texture2d>(resources_[handle.index].texture));
+        }
+        std::shared_ptr<Texture2d> depth_texture{nullptr};
+        if (depth) {
+            depth_texture =
+                std::static_pointer_cast<Texture2d>(resources_[depth_stencil.index].texture);
+        }
+        auto created = Framebuffer::Create(color_textures, depth_texture);
+        if (!created) {
+            return nullptr;
+        }
+        it = framebuffers_.emplace(framebuffer_key_, std::move(created)).first;
+    }
+
+    return it->second.get();
+}
+
+std::shared_ptr<Texture2d> FrameGraph::Find(const char* name) const {
+    for (const auto& resource : resources_) {
+        if (strcmp(name, resource.name) == 0) {
+            return std::dynamic_pointer_cast<Texture2d>(resource.texture);
+        }
+    }
+
+    return nullptr;
+}
+
+bool FrameGraph::ExportGraphviz(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+
+    out << "digraph FrameGraph {\n";
+    out << "  rankdir=LR;\n";
+    for (size_t position = 0; position < order_.size(); ++position) {
+        const auto& pass = passes_[order_[position]];
+        out << "  pass" << order_[position] << " [shape=box, label=\"" << position << ": "
+            << pass.name << "\"" << (pass.culled ? ", style=dashed, fontcolor=gray" : "")
+            << "];\n";
+    }
+    for (size_t i = 0; i < resources_.size(); ++i) {
+        const auto& resource = resources_[i];
+        out << "  res" << i << " [shape=ellipse, label=\"" << resource.name;
+        if (resource.desc.width > 0) {
+            out << "\\n" << resource.desc.width << "x" << resource.desc.height;
+        }
+        if (resource.pooled >= 0) {
+            out << "\\ntexture #" << resource.pooled;
+        }
+        out << "\"" << (resource.imported ? ", style=filled, fillcolor=lightgray" : "") << "];\n";
+        for (int writer : resource.writers) {
+            out << "  pass" << writer << " -> res" << i << " [color=red];\n";
+        }
+        for (int reader : resource.readers) {
+            out << "  res" << i << " -> pass" << reader << ";\n";
+        }
+    }
+    out << "}\n";
+
+    return true;
+}
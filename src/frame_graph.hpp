@@ -0,0 +1,161 @@
+#ifndef INCLUDED_FRAME_GRAPH_HPP
+#define INCLUDED_FRAME_GRAPH_HPP
+
+#include "common.hpp"
+#include "frame_arena.hpp"
+#include "framebuffer.hpp"
+#include "profiler.hpp"
+#include "texture.hpp"
+#include <map>
+
+// Passes of one frame and the textures they read and write. Compile orders the passes so every
+// writer runs before its readers, culls the passes nothing needs, and assigns the transient
+// textures to pooled ones: two transients of the same description whose lifetimes do not overlap
+// share a texture. Imported resources live outside the graph, writing one keeps a pass alive.
+//
+// The graph is rebuilt every frame (Reset, Create / Import, AddPass, Compile, Execute), the pool
+// and the framebuffers made from it are kept as long as the frame keeps asking for them. Names,
+// edges and pass closures of a frame live in the frame arena, which the caller advances before
+// Reset; the last compiled graph stays readable until the arena drops its frame.
+class FrameGraph {
+  public:
+    struct TextureDesc {
+        int width;
+        int height;
+        uint32_t inner_format;
+        uint32_t format;
+        uint32_t type;
+
+        bool operator==(const TextureDesc& other) const {
+            return width == other.width && height == other.height &&
+                   inner_format == other.inner_format && format == other.format &&
+                   type == other.type;
+        }
+    };
+
+    // index of a resource, valid until the next Reset
+    struct Handle {
+        int index{-1};
+        inline bool valid() const { return index >= 0; }
+    };
+
+    struct Stats {
+        size_t passes{0};
+        size_t culled_passes{0};
+        size_t transients{0};
+        size_t textures{0};
+        size_t requested_bytes{0}; // what the transients would take without aliasing
+        size_t allocated_bytes{0};
+    };
+
+    // the handles a pass reads or writes: one handle, an array, a vector or a pointer and a
+    // count. Only a view, the handles have to outlive the call
+    class HandleList {
+      public:
+        HandleList() {}
+        HandleList(const Handle* data, size_t size) : data_(data), size_(size) {}
+        HandleList(const Handle& handle) : data_(&handle), size_(1) {}
+        template <size_t N> HandleList(const Handle (&handles)[N]) : data_(handles), size_(N) {}
+        template <typename A>
+        HandleList(const std::vector<Handle, A>& handles)
+            : data_(handles.data()), size_(handles.size()) {}
+
+        inline const Handle* begin() const { return data_; }
+        inline const Handle* end() const { return data_ + size_; }
+        inline size_t size() const { return size_; }
+
+      private:
+        const Handle* data_{nullptr};
+        size_t size_{0};
+    };
+
+    static std::unique_ptr<FrameGraph> Create(FrameArena* arena);
+    ~FrameGraph();
+
+    void Reset();
+    Handle CreateTexture(const char* name, const TextureDesc& desc);
+    // texture: null for a resource that only orders passes, e.g. the default framebuffer
+    Handle Import(const char* name, std::shared_ptr<BaseTexture> texture = nullptr);
+    // execute: a callable taking FrameGraph&, moved into the frame arena
+    template <typename F>
+    void AddPass(const char* name, HandleList reads, HandleList writes, F&& execute) {
+        using Closure = std::decay_t<F>;
+        void* closure = arena_->Allocate(sizeof(Closure), alignof(Closure));
+        new (closure) Closure(std::forward<F>(execute));
+        AddPass(name, reads, writes,
+                PassFunction{closure,
+                             [](void* closure, FrameGraph& graph) {
+                                 (*static_cast<Closure*>(closure))(graph);
+                             },
+                             [](void* closure) { static_cast<Closure*>(closure)->~Closure(); }});
+    }
+    bool Compile();
+    void Execute();
+
+    // during Execute: the texture behind a handle, nullptr for culled or markers of another type
+    template <typename T = Texture2d> T* texture(Handle handle) const {
+        return dynamic_cast<T*>(resources_[handle.index].texture.get());
+    }
+    // during Execute: a framebuffer of 2d textures, kept while the textures stay in the pool
+    Framebuffer* framebuffer(HandleList colors, Handle depth_stencil);
+    Framebuffer* framebuffer(HandleList colors) { return framebuffer(colors, Handle()); }
+
+    // texture of the last compiled graph by resource name, for debug views
+    std::shared_ptr<Texture2d> Find(const char* name) const;
+    bool ExportGraphviz(const std::string& filename) const;
+    inline const Stats& stats() const { return stats_; }
+    // every executed pass becomes a profiler scope of its name
+    inline void set_profiler(Profiler* profiler) { profiler_ = profiler; }
+
+  private:
+    // a closure in the frame arena, destroyed on Reset
+    struct PassFunction {
+        void* closure;
+        void (*call)(void* closure, FrameGraph& graph);
+        void (*destroy)(void* closure);
+    };
+
+    struct Resource {
+        const char* name;
+        TextureDesc desc;
+        bool imported;
+        std::shared_ptr<BaseTexture> texture;
+        FrameVector<int> writers;
+        FrameVector<int> readers;
+        int pooled; // index into pool_, transients only
+    };
+
+    struct Pass {
+        const char* name;
+        FrameVector<int> reads;
+        FrameVector<int> writes;
+        PassFunction execute;
+        bool culled;
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        std::shared_ptr<Texture2d> texture;
+        bool used{false}; // by this frame
+    };
+
+    FrameGraph() {}
+
+    void AddPass(const char* name, HandleList reads, HandleList writes, PassFunction execute);
+    bool SortPasses();
+    void CullPasses();
+    void AllocateTextures();
+
+    std::vector<Resource> resources_;
+    std::vector<Pass> passes_;
+    std::vector<int> order_; // pass indices in execution order, culled passes included
+    std::vector<PooledTexture> pool_;
+    std::map<std::vector<uint32_t>, std::unique_ptr<Framebuffer>> framebuffers_;
+    std::vector<uint32_t> framebuffer_key_; // reused for the lookups
+    FrameArena* arena_{nullptr};
+    Profiler* profiler_{nullptr};
+    bool compiled_{false};
+    Stats stats_;
+};
+
+#endif
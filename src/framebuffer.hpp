@@ -2,23 +2,25 @@
 #define INCLUDED_FRAMEBUFFER_HPP
 
 #include "common.hpp"
+#include "gl_state.hpp"
 #include "texture.hpp"
 
 class BaseFramebuffer {
   public:
     inline static void BindToDefault(uint32_t target = GL_FRAMEBUFFER) {
-        glBindFramebuffer(target, 0);
+        GlState::Get().BindFramebuffer(target, 0);
     };
 
     BaseFramebuffer() {}
     ~BaseFramebuffer() {
         if (id_) {
+            GlState::Get().ForgetFramebuffer(id_);
             glDeleteFramebuffers(1, &id_);
         }
     }
 
     virtual inline void Bind(uint32_t target = GL_FRAMEBUFFER) final {
-        glBindFramebuffer(target, id_);
+        GlState::Get().BindFramebuffer(target, id_);
     }
     virtual inline uint32_t id() const final { return id_; }
     virtual bool Init() final {
@@ -49,11 +51,29 @@ class BaseFramebuffer {
 
 class Framebuffer : public BaseFramebuffer {
   public:
+    // depth_texture: sampleable depth-stencil texture instead of a renderbuffer
     static std::unique_ptr<Framebuffer>
-    Create(const std::vector<std::shared_ptr<Texture2d>> color_attachments) {
+    Create(const std::vector<std::shared_ptr<Texture2d>> color_attachments,
+           bool depth_texture = false) {
         auto framebuffer = std::unique_ptr<Framebuffer>(new Framebuffer());
 
         framebuffer->set_color_attachments(color_attachments);
+        framebuffer->depth_texture_ = depth_texture;
+        if (!framebuffer->Init()) {
+            return nullptr;
+        }
+
+        return std::move(framebuffer);
+    }
+    // depth_stencil: an existing GL_DEPTH24_STENCIL8 texture, or null for no depth attachment
+    static std::unique_ptr<Framebuffer>
+    Create(const std::vector<std::shared_ptr<Texture2d>> color_attachments,
+           std::shared_ptr<Texture2d> depth_stencil) {
+        auto framebuffer = std::unique_ptr<Framebuffer>(new Framebuffer());
+
+        framebuffer->set_color_attachments(color_attachments);
+        framebuffer->depth_stencil_texture_ = depth_stencil;
+        framebuffer->external_depth_ = true;
         if (!framebuffer->Init()) {
             return nullptr;
         }
@@ -74,6 +94,9 @@ class Framebuffer : public BaseFramebuffer {
 
         return nullptr;
     };
+    inline const std::shared_ptr<Texture2d> depth_attachment() const {
+        return depth_stencil_texture_;
+    }
 
   private:
     Framebuffer() : BaseFramebuffer() {}
@@ -91,7 +114,23 @@ class Framebuffer : public BaseFramebuffer {
             }
             glDrawBuffers(color_attachments_.size(), attachments.data());
 
+            if (external_depth_) {
+                if (depth_stencil_texture_) {
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                           GL_TEXTURE_2D, depth_stencil_texture_->id(), 0);
+                }
+                return;
+            }
             // depth stencil buffer
+            if (depth_texture_) {
+                depth_stencil_texture_ = Texture2d::Create(
+                    color_attachments_[0]->width(), color_attachments_[0]->height(),
+                    GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+                depth_stencil_texture_->SetFilter(GL_NEAREST, GL_NEAREST);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D,
+                                       depth_stencil_texture_->id(), 0);
+                return;
+            }
             glGenRenderbuffers(1, &depth_stencil_buffer_);
             glBindRenderbuffer(GL_RENDERBUFFER, depth_stencil_buffer_);
             glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
@@ -106,7 +145,10 @@ class Framebuffer : public BaseFramebuffer {
         color_attachments_ = color_attachments;
     }
 
+    bool depth_texture_{false};
+    bool external_depth_{false};
     uint32_t depth_stencil_buffer_{0};
+    std::shared_ptr<Texture2d> depth_stencil_texture_{nullptr};
     std::vector<std::shared_ptr<Texture2d>> color_attachments_;
 };
 
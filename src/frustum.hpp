@@ -0,0 +1,61 @@
+#ifndef INCLUDED_FRUSTUM_HPP
+#define INCLUDED_FRUSTUM_HPP
+
+#include "common.hpp"
+
+// six inward facing planes (xyz: normal, w: distance), laid out the way cull.cs reads them
+class Frustum {
+  public:
+    // Gribb & Hartmann: the planes are sums/differences of the rows of projection * view
+    static Frustum FromMatrix(const glm::mat4& m) {
+        Frustum frustum;
+        for (int i = 0; i < 3; ++i) {
+            glm::vec4 row(m[0][i], m[1][i], m[2][i], m[3][i]);
+            glm::vec4 w(m[0][3], m[1][3], m[2][3], m[3][3]);
+            frustum.planes[i * 2] = w + row;
+            frustum.planes[i * 2 + 1] = w - row;
+        }
+        for (auto& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        return frustum;
+    }
+
+    // axis aligned box, e.g. everything an omni-directional shadow map can see
+    static Frustum FromBox(const glm::vec3& center, const glm::vec3& extent) {
+        Frustum frustum;
+        for (int i = 0; i < 3; ++i) {
+            glm::vec3 axis(0.0f);
+            axis[i] = 1.0f;
+            frustum.planes[i * 2] = glm::vec4(axis, extent[i] - center[i]);
+            frustum.planes[i * 2 + 1] = glm::vec4(-axis, extent[i] + center[i]);
+        }
+
+        return frustum;
+    }
+
+    // bounds: local bounding sphere (xyz: center, w: radius)
+    static glm::vec4 TransformSphere(const glm::mat4& model, const glm::vec4& bounds) {
+        glm::vec3 center = model * glm::vec4(glm::vec3(bounds), 1.0f);
+        float scale = glm::max(glm::max(glm::length(glm::vec3(model[0])),
+                                        glm::length(glm::vec3(model[1]))),
+                               glm::length(glm::vec3(model[2])));
+
+        return glm::vec4(center, bounds.w * scale);
+    }
+
+    bool Intersect(const glm::vec4& sphere) const {
+        for (const auto& plane : planes) {
+            if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    glm::vec4 planes[6];
+};
+
+#endif
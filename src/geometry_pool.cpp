@@ -0,0 +1,118 @@
+#include "geometry_pool.hpp"
+
+GeometryPool::GeometryPool() {}
+
+GeometryPool::~GeometryPool() {}
+
+std::shared_ptr<GeometryPool> GeometryPool::Create(size_t vertex_stride,
+                                                   const std::vector<Attrib>& attribs,
+                                                   size_t vertex_capacity, size_t index_capacity) {
+    auto pool = std::shared_ptr<GeometryPool>(new GeometryPool());
+    if (!pool->Init(vertex_stride, attribs, vertex_capacity, index_capacity)) {
+        return nullptr;
+    }
+
+    return std::move(pool);
+}
+
+bool GeometryPool::Init(size_t vertex_stride, const std::vector<Attrib>& attribs,
+                        size_t vertex_capacity, size_t index_capacity) {
+    if (vertex_stride == 0 || vertex_capacity == 0 || index_capacity == 0) {
+        SPDLOG_ERROR("invalid geometry pool size");
+        return false;
+    }
+    attribs_ = attribs;
+
+    // the element buffer binding is VAO state, so the VAO has to be bound before the buffers
+    vertex_array_ = VertexArray::Create();
+    vertex_buffer_ = Buffer::Create(GL_ARRAY_BUFFER, GL_STATIC_DRAW, nullptr, vertex_stride,
+                                    vertex_capacity);
+    index_buffer_ = Buffer::Create(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, nullptr,
+                                   sizeof(uint32_t), index_capacity);
+    SetAttribs();
+    vertex_allocator_.Grow(vertex_capacity);
+    index_allocator_.Grow(index_capacity);
+
+    return true;
+}
+
+void GeometryPool::SetAttribs() const {
+    vertex_buffer_->Bind();
+    for (const auto& attrib : attribs_) {
+        vertex_array_->SetAttrib(attrib.index, attrib.count, attrib.type, attrib.normalized,
+                                 vertex_buffer_->stride(), attrib.offset);
+    }
+}
+
+void GeometryPool::Grow(uint32_t buffer_type, std::unique_ptr<Buffer>& buffer,
+                        RangeAllocator& allocator, size_t required) {
+    size_t capacity = std::max(allocator.capacity() * 2, allocator.capacity() + required);
+    SPDLOG_INFO("geometry pool grows: {} -> {} elements", allocator.capacity(), capacity);
+
+    auto grown = Buffer::Create(buffer_type, GL_STATIC_DRAW, nullptr, buffer->stride(), capacity);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer->id());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown->id());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, buffer->size());
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    buffer = std::move(grown);
+    allocator.Grow(capacity);
+}
+
+GeometryPool::Range GeometryPool::Allocate(const void* vertices, size_t vertex_count,
+                                           const uint32_t* indices, size_t index_count) {
+    if (vertex_count == 0 || index_count == 0) {
+        return {};
+    }
+    if (vertex_count > (size_t)INT32_MAX || index_count > (size_t)UINT32_MAX) {
+        SPDLOG_ERROR("mesh too large for geometry pool: {} vertices, {} indices", vertex_count,
+                     index_count);
+        return {};
+    }
+    Bind();
+
+    size_t base_vertex = vertex_allocator_.Allocate(vertex_count);
+    if (base_vertex == RangeAllocator::kInvalid) {
+        Grow(GL_ARRAY_BUFFER, vertex_buffer_, vertex_allocator_, vertex_count);
+        SetAttribs();
+        base_vertex = vertex_allocator_.Allocate(vertex_count);
+    }
+    size_t first_index = index_allocator_.Allocate(index_count);
+    if (first_index == RangeAllocator::kInvalid) {
+        Grow(GL_ELEMENT_ARRAY_BUFFER, index_buffer_, index_allocator_, index_count);
+        first_index = index_allocator_.Allocate(index_count);
+    }
+
+    Range range;
+    range.base_vertex = (uint32_t)base_vertex;
+    range.vertex_count = (uint32_t)vertex_count;
+    range.first_index = (uint32_t)first_index;
+    range.index_count = (uint32_t)index_count;
+
+    size_t vertex_stride = vertex_buffer_->stride();
+    vertex_buffer_->Upload(vertices, vertex_count * vertex_stride, base_vertex * vertex_stride);
+    index_buffer_->Upload(indices, index_count * sizeof(uint32_t), first_index * sizeof(uint32_t));
+
+    return range;
+}
+
+void GeometryPool::Free(const Range& range) {
+    if (range.index_count == 0) {
+        return;
+    }
+    vertex_allocator_.Free(range.base_vertex, range.vertex_count);
+    index_allocator_.Free(range.first_index, range.index_count);
+}
+
+void GeometryPool::Draw(uint32_t primitive_type, const Range& range, int instance_count) const {
+    auto indices = (const void*)(range.first_index * sizeof(uint32_t));
+    if (instance_count == 1) {
+        glDrawElementsBaseVertex(primitive_type, range.index_count, GL_UNSIGNED_INT, indices,
+                                 range.base_vertex);
+    } else {
+        glDrawElementsInstancedBaseVertex(primitive_type, range.index_count, GL_UNSIGNED_INT,
+                                          indices, instance_count, range.base_vertex);
+    }
+    GlState::Get().CountDraw();
+}
@@ -0,0 +1,68 @@
+#ifndef INCLUDED_GEOMETRY_POOL_HPP
+#define INCLUDED_GEOMETRY_POOL_HPP
+
+#include "buffer.hpp"
+#include "common.hpp"
+#include "range_allocator.hpp"
+#include "vertex_array.hpp"
+
+// One VAO plus one large vertex/index buffer pair for every mesh sharing a vertex layout. Meshes
+// own ranges inside the pool and draw with glDrawElementsBaseVertex, so switching meshes never
+// rebinds a VAO. Buffers grow by doubling and copy their contents on the GPU.
+class GeometryPool {
+  public:
+    struct Attrib {
+        uint32_t index;
+        int count;
+        uint32_t type;
+        bool normalized;
+        size_t offset;
+    };
+
+    struct Range {
+        uint32_t base_vertex{0};
+        uint32_t vertex_count{0};
+        uint32_t first_index{0};
+        uint32_t index_count{0};
+    };
+
+    static std::shared_ptr<GeometryPool> Create(size_t vertex_stride,
+                                                const std::vector<Attrib>& attribs,
+                                                size_t vertex_capacity, size_t index_capacity);
+    ~GeometryPool();
+
+    // indices are relative to the range, base_vertex is added at draw time.
+    // returns an empty range (index_count == 0) on failure
+    Range Allocate(const void* vertices, size_t vertex_count, const uint32_t* indices,
+                   size_t index_count);
+    void Free(const Range& range);
+
+    inline void Bind() const { vertex_array_->Bind(); }
+    void Draw(uint32_t primitive_type, const Range& range, int instance_count = 1) const;
+
+    inline const VertexArray* vertex_array() const { return vertex_array_.get(); }
+    inline const Buffer* vertex_buffer() const { return vertex_buffer_.get(); }
+    inline const Buffer* index_buffer() const { return index_buffer_.get(); }
+    inline size_t vertex_capacity() const { return vertex_allocator_.capacity(); }
+    inline size_t vertex_used() const { return vertex_allocator_.used(); }
+    inline size_t index_capacity() const { return index_allocator_.capacity(); }
+    inline size_t index_used() const { return index_allocator_.used(); }
+
+  private:
+    GeometryPool();
+    bool Init(size_t vertex_stride, const std::vector<Attrib>& attribs, size_t vertex_capacity,
+              size_t index_capacity);
+
+    void SetAttribs() const;
+    void Grow(uint32_t buffer_type, std::unique_ptr<Buffer>& buffer, RangeAllocator& allocator,
+              size_t required);
+
+    std::vector<Attrib> attribs_;
+    std::unique_ptr<VertexArray> vertex_array_{nullptr};
+    std::unique_ptr<Buffer> vertex_buffer_{nullptr};
+    std::unique_ptr<Buffer> index_buffer_{nullptr};
+    RangeAllocator vertex_allocator_;
+    RangeAllocator index_allocator_;
+};
+
+#endif
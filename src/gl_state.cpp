@@ -0,0 +1,137 @@
+#include "gl_state.hpp"
+
+GlState& GlState::Get() {
+    static GlState state;
+
+    return state;
+}
+
+void GlState::BeginFrame() {
+    last_frame_ = counters_;
+    counters_ = Counters();
+}
+
+void GlState::Invalidate() {
+    program_ = kUnknown;
+    active_unit_ = kUnknown;
+    for (auto& unit : textures_) {
+        unit.fill(kUnknown);
+    }
+    draw_framebuffer_ = kUnknown;
+    read_framebuffer_ = kUnknown;
+    vertex_array_ = kUnknown;
+}
+
+void GlState::set_caching(bool caching) {
+    caching_ = caching;
+    Invalidate();
+}
+
+int GlState::TargetIndex(uint32_t target) {
+    switch (target) {
+    case GL_TEXTURE_2D:
+        return 0;
+    case GL_TEXTURE_CUBE_MAP:
+        return 1;
+    case GL_TEXTURE_2D_ARRAY:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+void GlState::UseProgram(uint32_t program) {
+    if (caching_ && program_ == program) {
+        ++counters_.skipped;
+        return;
+    }
+    glUseProgram(program);
+    program_ = program;
+    ++counters_.program_binds;
+}
+
+void GlState::ActiveTexture(uint32_t unit) {
+    if (caching_ && active_unit_ == unit) {
+        ++counters_.skipped;
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    active_unit_ = unit;
+    ++counters_.texture_binds;
+}
+
+void GlState::BindTexture(uint32_t target, uint32_t texture) {
+    int index = TargetIndex(target);
+    uint32_t* bound = nullptr;
+    if (index >= 0 && active_unit_ < (uint32_t)kTextureUnits) {
+        bound = &textures_[active_unit_][index];
+    }
+    if (caching_ && bound && *bound == texture) {
+        ++counters_.skipped;
+        return;
+    }
+    glBindTexture(target, texture);
+    if (bound) {
+        *bound = texture;
+    }
+    ++counters_.texture_binds;
+}
+
+void GlState::BindFramebuffer(uint32_t target, uint32_t framebuffer) {
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if (caching_ && (!draw || draw_framebuffer_ == framebuffer) &&
+        (!read || read_framebuffer_ == framebuffer)) {
+        ++counters_.skipped;
+        return;
+    }
+    glBindFramebuffer(target, framebuffer);
+    if (draw) {
+        draw_framebuffer_ = framebuffer;
+    }
+    if (read) {
+        read_framebuffer_ = framebuffer;
+    }
+    ++counters_.framebuffer_binds;
+}
+
+void GlState::BindVertexArray(uint32_t vertex_array) {
+    if (caching_ && vertex_array_ == vertex_array) {
+        ++counters_.skipped;
+        return;
+    }
+    glBindVertexArray(vertex_array);
+    vertex_array_ = vertex_array;
+    ++counters_.vertex_array_binds;
+}
+
+void GlState::ForgetProgram(uint32_t program) {
+    if (program_ == program) {
+        program_ = kUnknown;
+    }
+}
+
+void GlState::ForgetTexture(uint32_t texture) {
+    for (auto& unit : textures_) {
+        for (auto& bound : unit) {
+            if (bound == texture) {
+                bound = kUnknown;
+            }
+        }
+    }
+}
+
+void GlState::ForgetFramebuffer(uint32_t framebuffer) {
+    if (draw_framebuffer_ == framebuffer) {
+        draw_framebuffer_ = kUnknown;
+    }
+    if (read_framebuffer_ == framebuffer) {
+        read_framebuffer_ = kUnknown;
+    }
+}
+
+void GlState::ForgetVertexArray(uint32_t vertex_array) {
+    if (vertex_array_ == vertex_array) {
+        vertex_array_ = kUnknown;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef INCLUDED_GL_STATE_HPP
+#define INCLUDED_GL_STATE_HPP
+
+#include "common.hpp"
+
+#include <array>
+
+// Shadow copy of the bindings the renderer changes most: program, active texture unit, textures per
+// unit, framebuffers and vertex array. Program::Use, BaseTexture::Bind, Framebuffer::Bind and
+// VertexArray::Bind go through it, so a bind that changes nothing never reaches the driver. Code
+// binding behind its back (the ImGui backend) calls Invalidate afterwards.
+// It also counts the GL work of the frame for the settings panel and the benchmark.
+class GlState {
+  public:
+    struct Counters {
+        size_t draws{0}; // a multi draw is one
+        size_t dispatches{0};
+        size_t program_binds{0};
+        size_t texture_binds{0}; // glActiveTexture and glBindTexture
+        size_t framebuffer_binds{0};
+        size_t vertex_array_binds{0};
+        size_t buffer_binds{0};
+        size_t uniform_uploads{0};
+        size_t buffer_uploads{0};
+        size_t buffer_upload_bytes{0};
+        size_t skipped{0}; // binds the cache dropped
+
+        inline size_t state_changes() const {
+            return program_binds + texture_binds + framebuffer_binds + vertex_array_binds +
+                   buffer_binds;
+        }
+    };
+
+    static const int kTextureUnits = 32;
+
+    // there is one GL context
+    static GlState& Get();
+
+    // counters of the frame before are kept in last_frame
+    void BeginFrame();
+    void Invalidate();
+
+    void UseProgram(uint32_t program);
+    // unit index, not GL_TEXTURE0 + unit
+    void ActiveTexture(uint32_t unit);
+    // on the active unit
+    void BindTexture(uint32_t target, uint32_t texture);
+    void BindFramebuffer(uint32_t target, uint32_t framebuffer);
+    void BindVertexArray(uint32_t vertex_array);
+
+    // GL unbinds deleted objects and may hand their ids out again
+    void ForgetProgram(uint32_t program);
+    void ForgetTexture(uint32_t texture);
+    void ForgetFramebuffer(uint32_t framebuffer);
+    void ForgetVertexArray(uint32_t vertex_array);
+
+    inline void CountDraw() { ++counters_.draws; }
+    inline void CountDispatch() { ++counters_.dispatches; }
+    inline void CountBufferBind() { ++counters_.buffer_binds; }
+    inline void CountUniform() { ++counters_.uniform_uploads; }
+    inline void CountBufferUpload(size_t bytes) {
+        ++counters_.buffer_uploads;
+        counters_.buffer_upload_bytes += bytes;
+    }
+
+    inline const Counters& counters() const { return counters_; }
+    inline const Counters& last_frame() const { return last_frame_; }
+    // off: every bind reaches GL, to compare against
+    inline bool caching() const { return caching_; }
+    void set_caching(bool caching);
+
+  private:
+    static const uint32_t kUnknown = 0xffffffff;
+    // the texture targets the renderer binds, others are passed through
+    static const int kTextureTargets = 3;
+
+    GlState() { Invalidate(); }
+    static int TargetIndex(uint32_t target);
+
+    bool caching_{true};
+    uint32_t program_;
+    uint32_t active_unit_;
+    std::array<std::array<uint32_t, kTextureTargets>, kTextureUnits> textures_;
+    uint32_t draw_framebuffer_;
+    uint32_t read_framebuffer_;
+    uint32_t vertex_array_;
+
+    Counters counters_;
+    Counters last_frame_;
+};
+
+#endif
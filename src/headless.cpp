@@ -0,0 +1,248 @@
+#include "headless.hpp"
+#include "context.hpp"
+
+#include <filesystem>
+#include <imgui.h>
+
+#ifdef HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace {
+
+bool WriteFrame(const Texture2d* texture, const std::string& path, bool raw) {
+    if (!raw) {
+        return texture->SaveAsPng(path + ".png");
+    }
+    std::unique_ptr<unsigned char[]> data(texture->GetTexImage());
+    std::ofstream out(path + ".rgba", std::ios::binary);
+    if (!data || !out) {
+        SPDLOG_ERROR("failed to write {}.rgba", path);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(data.get()),
+              (std::streamsize)texture->width() * texture->height() * 4);
+
+    return true;
+}
+
+} // namespace
+
+std::unique_ptr<HeadlessGL> HeadlessGL::Create(int width, int height) {
+    auto gl = std::unique_ptr<HeadlessGL>(new HeadlessGL());
+    if (!gl->Init(width, height)) {
+        return nullptr;
+    }
+
+    return std::move(gl);
+}
+
+HeadlessGL::~HeadlessGL() {
+    if (imgui_) {
+        ImGui::DestroyContext(imgui_);
+    }
+#ifdef HAS_EGL
+    if (display_ != EGL_NO_DISPLAY) {
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context_ != EGL_NO_CONTEXT) {
+            eglDestroyContext(display_, context_);
+        }
+        eglTerminate(display_);
+    }
+#endif
+}
+
+// surfaceless: no window system at all, the default framebuffer does not exist
+bool HeadlessGL::Init(int width, int height) {
+#ifndef HAS_EGL
+    SPDLOG_ERROR("built without EGL, no headless GL context");
+    return false;
+#else
+    SPDLOG_INFO("Create headless EGL context");
+    auto get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+        display_ =
+            get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display_ == EGL_NO_DISPLAY) {
+        display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+        SPDLOG_ERROR("failed to initialize EGL");
+        display_ = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        SPDLOG_ERROR("EGL has no desktop OpenGL");
+        return false;
+    }
+
+    // the newest core profile, the renderer picks its paths from the GLAD flags
+    const int versions[][2] = {{4, 6}, {4, 5}, {4, 3}, {3, 3}};
+    for (const auto& version : versions) {
+        EGLint attributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                               version[0],
+                               EGL_CONTEXT_MINOR_VERSION,
+                               version[1],
+                               EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                               EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                               EGL_NONE};
+        context_ = eglCreateContext(display_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (context_ != EGL_NO_CONTEXT) {
+            break;
+        }
+    }
+    if (context_ == EGL_NO_CONTEXT) {
+        SPDLOG_ERROR("failed to create an OpenGL 3.3+ core context");
+        return false;
+    }
+    if (!eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+        SPDLOG_ERROR("failed to make the EGL context current");
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        SPDLOG_ERROR("failed to initialize GLAD");
+        return false;
+    }
+    SPDLOG_INFO("{} | {}", (const char*)glGetString(GL_RENDERER),
+                (const char*)glGetString(GL_VERSION));
+
+    // Context builds its panels every frame, ImGui only needs a display size and fonts for that
+    imgui_ = ImGui::CreateContext();
+    ImGui::SetCurrentContext(imgui_);
+    auto& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)width, (float)height);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.IniFilename = nullptr;
+    unsigned char* font_pixels = nullptr;
+    int font_width = 0;
+    int font_height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+
+    return true;
+#endif
+}
+
+std::vector<CameraKey> LoadCameraPath(const std::string& filename) {
+    std::vector<CameraKey> keys;
+    std::ifstream in(filename);
+    if (!in) {
+        SPDLOG_ERROR("failed to open camera path {}", filename);
+        return keys;
+    }
+    CameraKey key;
+    while (in >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch) {
+        keys.push_back(key);
+    }
+
+    return keys;
+}
+
+CameraKey SampleCameraPath(const std::vector<CameraKey>& keys, float t) {
+    float position = t * (keys.size() - 1);
+    size_t i = std::min((size_t)position, keys.size() - 1);
+    size_t j = std::min(i + 1, keys.size() - 1);
+    float f = position - i;
+
+    return CameraKey{glm::mix(keys[i].position, keys[j].position, f),
+                     glm::mix(keys[i].yaw, keys[j].yaw, f),
+                     glm::mix(keys[i].pitch, keys[j].pitch, f)};
+}
+
+void SetCameraKey(Camera& camera, const CameraKey& key) {
+    camera.position_ = key.position;
+    camera.yaw_ = key.yaw;
+    camera.pitch_ = key.pitch;
+}
+
+bool ParseHeadlessOptions(int argc, char** argv, HeadlessOptions* options) {
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--frames" && has_value) {
+            options->frame_count = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--size" && has_value) {
+            auto size = Split(argv[++i], "x");
+            if (size.size() == 2) {
+                options->width = std::max(std::atoi(size[0].c_str()), 1);
+                options->height = std::max(std::atoi(size[1].c_str()), 1);
+            }
+        } else if (arg == "--output" && has_value) {
+            options->output_dir = argv[++i];
+        } else if (arg == "--camera-path" && has_value) {
+            options->camera_path = argv[++i];
+        } else if (arg == "--raw") {
+            options->raw = true;
+        } else if (arg == "--no-write") {
+            options->write_frames = false;
+        } else if (arg == "--scene" && has_value) {
+            options->scene_path = argv[++i];
+        } else if (arg == "--world" && has_value) {
+            options->world_path = argv[++i];
+        } else {
+            SPDLOG_WARN("unknown argument {}", arg);
+        }
+    }
+
+    return headless;
+}
+
+int RunHeadless(const HeadlessOptions& options) {
+    auto gl = HeadlessGL::Create(options.width, options.height);
+    if (!gl) {
+        return -1;
+    }
+    SceneDesc scene;
+    scene.scene_path = options.scene_path;
+    scene.world_path = options.world_path;
+    auto context = Context::Create(scene);
+    auto output = Framebuffer::Create({Texture2d::Create(options.width, options.height)},
+                                      std::shared_ptr<Texture2d>());
+    if (!context || !output) {
+        SPDLOG_ERROR("failed to initialize context");
+        return -1;
+    }
+    context->ReshapeViewport(options.width, options.height);
+    context->set_output_framebuffer(output.get());
+
+    std::vector<CameraKey> keys;
+    if (!options.camera_path.empty()) {
+        keys = LoadCameraPath(options.camera_path);
+        if (keys.empty()) {
+            return -1;
+        }
+    } else {
+        const Camera& camera = context->camera();
+        keys = {{camera.position_, camera.yaw_, camera.pitch_},
+                {camera.position_, camera.yaw_ + 360.0f, camera.pitch_}};
+    }
+
+    if (options.write_frames) {
+        std::error_code error;
+        std::filesystem::create_directories(options.output_dir, error);
+    }
+    SPDLOG_INFO("Render {} frames of {}x{}", options.frame_count, options.width, options.height);
+    for (int frame = 0; frame < options.frame_count; ++frame) {
+        float t = options.frame_count > 1 ? (float)frame / (options.frame_count - 1) : 0.0f;
+        SetCameraKey(context->camera(), SampleCameraPath(keys, t));
+
+        ImGui::NewFrame();
+        context->Render();
+        if (options.write_frames) {
+            char name[32];
+            snprintf(name, sizeof(name), "/frame_%04d", frame);
+            if (!WriteFrame(output->color_attachment(0).get(), options.output_dir + name,
+                            options.raw)) {
+                return -1;
+            }
+        }
+    }
+    glFinish();
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef INCLUDED_HEADLESS_HPP
+#define INCLUDED_HEADLESS_HPP
+
+#include "camera.hpp"
+#include "common.hpp"
+
+struct ImGuiContext;
+
+// Offscreen batch runs without a window or input: a surfaceless EGL context (Mesa llvmpipe works
+// on GPU-less machines) renders frame_count frames along a scripted camera path and writes every
+// frame to output_dir.
+struct HeadlessOptions {
+    int width{WINDOW_WIDTH};
+    int height{WINDOW_HEIGHT};
+    int frame_count{60};
+    std::string output_dir{"save/headless"};
+    // one "x y z yaw pitch" key per line, spread evenly over the frames. Empty: turn in place
+    std::string camera_path;
+    // frame_NNNN.rgba (width * height * 4 bytes, bottom row first) instead of PNG
+    bool raw{false};
+    bool write_frames{true};
+    // a SceneFile to load instead of the generated scene and a world directory to stream, also
+    // read by the windowed mode
+    std::string scene_path;
+    std::string world_path;
+};
+
+struct CameraKey {
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// a current GL context with GLAD loaded and no window, plus the ImGui context Context builds its
+// panels into every frame. Null when EGL is missing
+class HeadlessGL {
+  public:
+    static std::unique_ptr<HeadlessGL> Create(int width, int height);
+    ~HeadlessGL();
+
+  private:
+    HeadlessGL() {}
+    bool Init(int width, int height);
+
+    void* display_{nullptr}; // EGLDisplay
+    void* context_{nullptr}; // EGLContext
+    ImGuiContext* imgui_{nullptr};
+};
+
+std::vector<CameraKey> LoadCameraPath(const std::string& filename);
+// t in [0, 1] over the whole path, linear between keys
+CameraKey SampleCameraPath(const std::vector<CameraKey>& keys, float t);
+void SetCameraKey(Camera& camera, const CameraKey& key);
+
+// true when argv asks for --headless, the other flags fill options:
+// --frames N, --size WxH, --output DIR, --camera-path FILE, --raw, --no-write, --scene FILE,
+// --world DIR
+bool ParseHeadlessOptions(int argc, char** argv, HeadlessOptions* options);
+// exit code for main
+int RunHeadless(const HeadlessOptions& options);
+
+#endif
@@ -0,0 +1,75 @@
+#include "hiz_buffer.hpp"
+
+HiZBuffer::HiZBuffer() {}
+
+HiZBuffer::~HiZBuffer() {
+    if (id_) {
+        GlState::Get().ForgetTexture(id_);
+        glDeleteTextures(1, &id_);
+    }
+}
+
+std::unique_ptr<HiZBuffer> HiZBuffer::Create(int width, int height) {
+    auto hiz = std::unique_ptr<HiZBuffer>(new HiZBuffer());
+    if (!hiz->Init(width, height)) {
+        return nullptr;
+    }
+
+    return std::move(hiz);
+}
+
+bool HiZBuffer::Init(int width, int height) {
+    copy_program_ = Program::CreateCompute("shader/hiz_copy.cs");
+    if (!copy_program_) {
+        return false;
+    }
+
+    reduce_program_ = Program::CreateCompute("shader/hiz_reduce.cs");
+    if (!reduce_program_) {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    level_count_ = 1;
+    while ((std::max(width_, height_) >> level_count_) > 0) {
+        ++level_count_;
+    }
+
+    glGenTextures(1, &id_);
+    GlState::Get().BindTexture(GL_TEXTURE_2D, id_);
+    glTexStorage2D(GL_TEXTURE_2D, level_count_, GL_R32F, width_, height_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return true;
+}
+
+void HiZBuffer::Build(const Texture2d* depth, const glm::mat4& view_projection) {
+    auto groups = [](int size) { return (GLuint)((size + 7) / 8); };
+
+    copy_program_->Use();
+    GlState::Get().ActiveTexture(kTextureUnit);
+    depth->Bind();
+    copy_program_->SetUniform("depth", kTextureUnit);
+    GlState::Get().ActiveTexture(0);
+    glBindImageTexture(0, id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(groups(width_), groups(height_), 1);
+    GlState::Get().CountDispatch();
+
+    reduce_program_->Use();
+    for (int level = 1; level < level_count_; ++level) {
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        glBindImageTexture(0, id_, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, id_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute(groups(std::max(width_ >> level, 1)),
+                          groups(std::max(height_ >> level, 1)), 1);
+        GlState::Get().CountDispatch();
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    view_projection_ = view_projection;
+    valid_ = true;
+}
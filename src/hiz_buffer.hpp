@@ -0,0 +1,43 @@
+#ifndef INCLUDED_HIZ_BUFFER_HPP
+#define INCLUDED_HIZ_BUFFER_HPP
+
+#include "common.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+
+// Hierarchical-Z pyramid of a depth buffer for occlusion culling. Level 0 is a copy of the depth,
+// every further level keeps the farthest depth of the texels below it, so anything whose nearest
+// depth lies behind a pyramid texel is hidden in all the pixels that texel covers.
+class HiZBuffer {
+  public:
+    // texture unit the pyramid passes use, clear of the units the lighting pass binds
+    static const int kTextureUnit = 7;
+
+    static std::unique_ptr<HiZBuffer> Create(int width, int height);
+    ~HiZBuffer();
+
+    // view_projection: the matrix the depth was rendered with, objects are projected with it
+    void Build(const Texture2d* depth, const glm::mat4& view_projection);
+
+    inline bool valid() const { return valid_; }
+    inline uint32_t id() const { return id_; }
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline int level_count() const { return level_count_; }
+    inline const glm::mat4& view_projection() const { return view_projection_; }
+
+  private:
+    HiZBuffer();
+    bool Init(int width, int height);
+
+    uint32_t id_{0};
+    int width_{0};
+    int height_{0};
+    int level_count_{0};
+    glm::mat4 view_projection_{1.0f};
+    bool valid_{false};
+    std::unique_ptr<Program> copy_program_{nullptr};
+    std::unique_ptr<Program> reduce_program_{nullptr};
+};
+
+#endif
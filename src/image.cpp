@@ -57,7 +57,8 @@ std::unique_ptr<Image> Image::CreateSingleColorImage(int width, int height,
 }
 
 bool Image::LoadFile(const std::string& filepath, bool flip_vertical) {
-    stbi_set_flip_vertically_on_load(flip_vertical);
+    // per thread, models decode their images on the thread pool
+    stbi_set_flip_vertically_on_load_thread(flip_vertical);
     data_ = stbi_load(filepath.c_str(), &width_, &height_, &channel_count_, 0);
     if (!data_) {
         SPDLOG_ERROR("failed to load image: {}", filepath);
@@ -14,7 +14,7 @@ enum LightType {
 class Light : public Object {
   public:
     static std::shared_ptr<Light> Create(std::shared_ptr<Mesh> mesh) {
-        auto sptr = std::shared_ptr<Light>(new Light(mesh));
+        auto sptr = ObjectPool<Light>::Default().MakeShared(mesh);
 
         return sptr;
     }
@@ -40,6 +40,8 @@ class Light : public Object {
     glm::vec3 specular{glm::vec3(1.0f, 1.0f, 1.0f)};
 
   private:
+    friend class ObjectPool<Light>;
+
     Light(std::shared_ptr<Mesh> mesh) : Object(mesh) {};
 
     glm::vec3 direction_{glm::vec3(0.0f, -1.0f, 0.0f)};
@@ -1,4 +1,5 @@
 #include "context.hpp"
+#include "headless.hpp"
 
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -13,6 +14,11 @@ void OnMouseButton(GLFWwindow* window, int button, int action, int modifier);
 void ScaleCursorToFramebuffer(GLFWwindow* window, double* x, double* y);
 
 int main(int argc, char** argv) {
+    HeadlessOptions headless_options;
+    if (ParseHeadlessOptions(argc, argv, &headless_options)) {
+        return RunHeadless(headless_options);
+    }
+
     SPDLOG_INFO("Initialize glfw");
     if (!glfwInit()) {
         const char* description = nullptr;
@@ -58,7 +64,10 @@ int main(int argc, char** argv) {
     glfwSetMouseButtonCallback(window, OnMouseButton);
     glfwSetScrollCallback(window, OnScroll);
 
-    auto context = Context::Create();
+    SceneDesc scene;
+    scene.scene_path = headless_options.scene_path;
+    scene.world_path = headless_options.world_path;
+    auto context = Context::Create(scene);
     if (!context) {
         SPDLOG_ERROR("failed to initialize context");
         glfwTerminate();
@@ -79,7 +88,12 @@ int main(int argc, char** argv) {
 
         context->Update();
         context->Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            Profiler::Scope scope(context->profiler(), "imgui");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        // the backend binds its own program, texture and vertex array
+        GlState::Get().Invalidate();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -1,22 +1,31 @@
 #include "material.hpp"
 
-Material::Material() {}
+std::shared_ptr<Material> Material::Create() {
+    auto& pool = ObjectPool<Material>::Default();
+    auto material = pool.MakeShared();
+    material->id_ = pool.HandleOf(material.get()).index;
 
-Material::~Material() {}
+    return std::move(material);
+}
 
-std::shared_ptr<Material> Material::Create() { return std::shared_ptr<Material>(new Material()); }
+void Material::set_shininess(float shininess) {
+    if (shininess_ != shininess) {
+        shininess_ = shininess;
+        ++revision_;
+    }
+}
 
 void Material::SetToProgram(const Program* program) const {
     int textureCount = 0;
 
     if (diffuse_) {
-        glActiveTexture(GL_TEXTURE0 + textureCount);
+        GlState::Get().ActiveTexture(textureCount);
         program->SetUniform("material.diffuse", textureCount);
         diffuse_->Bind();
         ++textureCount;
     }
     if (specular_) {
-        glActiveTexture(GL_TEXTURE0 + textureCount);
+        GlState::Get().ActiveTexture(textureCount);
         program->SetUniform("material.specular", textureCount);
         specular_->Bind();
         ++textureCount;
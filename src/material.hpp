@@ -2,22 +2,36 @@
 #define INCLUDED_MATERIAL_HPP
 
 #include "common.hpp"
+#include "object_pool.hpp"
 #include "program.hpp"
 #include "texture.hpp"
 
+// Materials live in an ObjectPool, the id is the slot, so it is compact and the ids of destroyed
+// materials are handed out again. Materials are made on the render thread, they share their
+// textures with the texture streamer.
 class Material {
   public:
     static std::shared_ptr<Material> Create();
-    ~Material();
 
     void SetToProgram(const Program* program) const;
 
-    std::unique_ptr<Texture2d> diffuse_{nullptr};
-    std::unique_ptr<Texture2d> specular_{nullptr};
-    float shininess_{30.0f};
+    inline uint32_t id() const { return id_; }
+    inline float shininess() const { return shininess_; }
+    void set_shininess(float shininess);
+    // bumped by every parameter change, so copies of the parameters know when to update
+    inline uint32_t revision() const { return revision_; }
+
+    std::shared_ptr<Texture2d> diffuse_{nullptr};
+    std::shared_ptr<Texture2d> specular_{nullptr};
 
   private:
-    Material();
+    friend class ObjectPool<Material>;
+
+    Material() {}
+
+    uint32_t id_{0};
+    uint32_t revision_{0};
+    float shininess_{30.0f};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "material_table.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+bool MaterialTable::ArrayKey::operator<(const ArrayKey& other) const {
+    return std::make_tuple(width, height, level_count, inner_format) <
+           std::make_tuple(other.width, other.height, other.level_count, other.inner_format);
+}
+
+MaterialTable::MaterialTable() {}
+
+MaterialTable::~MaterialTable() {}
+
+std::unique_ptr<MaterialTable> MaterialTable::Create() {
+    auto table = std::unique_ptr<MaterialTable>(new MaterialTable());
+    if (!table->Init()) {
+        return nullptr;
+    }
+
+    return std::move(table);
+}
+
+bool MaterialTable::Init() {
+    // 4x4 like the single color textures of the scene, so it shares their array
+    white_ = Texture2d::Create(Image::CreateSingleColorImage(4, 4, glm::vec4(1.0f)).get());
+    default_ = Material::Create();
+    buffer_ = Buffer::Create(GL_SHADER_STORAGE_BUFFER, GL_DYNAMIC_DRAW, nullptr,
+                             sizeof(MaterialData), 64);
+    if (!white_ || !buffer_) {
+        return false;
+    }
+    Register(default_);
+
+    return true;
+}
+
+uint32_t MaterialTable::Register(const std::shared_ptr<Material>& material) {
+    if (!material) {
+        return Register(default_);
+    }
+    uint32_t index = material->id();
+    const auto& diffuse_texture = material->diffuse_ ? material->diffuse_ : white_;
+    const auto& specular_texture = material->specular_ ? material->specular_ : white_;
+    // views follow the revisions of their textures themselves
+    if (index < entries_.size() && entries_[index].material.lock() == material &&
+        (diffuse_texture->immutable() ||
+         entries_[index].diffuse_revision == diffuse_texture->revision()) &&
+        (specular_texture->immutable() ||
+         entries_[index].specular_revision == specular_texture->revision())) {
+        return index;
+    }
+
+    if (index < entries_.size()) {
+        // the copies of the last material of the id, or of older revisions
+        for (Layer layer : {entries_[index].diffuse, entries_[index].specular}) {
+            if (layer.first >= 0) {
+                RemoveTexture(layer);
+            }
+        }
+    }
+    auto diffuse = AddTexture(diffuse_texture);
+    auto specular = AddTexture(specular_texture);
+    auto set = std::make_pair(diffuse.first, specular.first);
+    auto set_it = texture_set_indices_.find(set);
+    if (set_it == texture_set_indices_.end()) {
+        set_it = texture_set_indices_.emplace(set, (uint32_t)texture_sets_.size()).first;
+        texture_sets_.push_back(set);
+    }
+
+    if (index >= entries_.size()) {
+        entries_.resize(index + 1);
+        data_.resize(index + 1, MaterialData{glm::uvec4(0), glm::vec4(0.0f)});
+    }
+    Entry& entry = entries_[index];
+    entry.material = material;
+    entry.revision = material->revision();
+    entry.texture_set = set_it->second;
+    entry.diffuse = diffuse;
+    entry.specular = specular;
+    entry.diffuse_revision = diffuse_texture->revision();
+    entry.specular_revision = specular_texture->revision();
+    data_[index].layers = glm::uvec4(diffuse.second, specular.second, 0, 0);
+    data_[index].params = glm::vec4(material->shininess(), 0.0f, 0.0f, 0.0f);
+    MarkDirty(index);
+
+    return index;
+}
+
+MaterialTable::Layer MaterialTable::AddTexture(const std::shared_ptr<Texture2d>& texture) {
+    if (texture->immutable()) {
+        return AddView(texture);
+    }
+    // material textures come with a full mip chain
+    int level_count = 1;
+    while ((std::max(texture->width(), texture->height()) >> level_count) > 0) {
+        ++level_count;
+    }
+
+    ArrayKey key{texture->width(), texture->height(), level_count, texture->inner_format()};
+    auto it = array_indices_.find(key);
+    if (it == array_indices_.end()) {
+        it = array_indices_.emplace(key, (int)arrays_.size()).first;
+        arrays_.push_back(Array{key, nullptr, 0});
+    }
+    Array& array = arrays_[it->second];
+    uint32_t layer;
+    if (!array.free_layers.empty()) {
+        layer = array.free_layers.back();
+        array.free_layers.pop_back();
+    } else {
+        if (!array.texture || array.layer_count == array.texture->layer_count()) {
+            Grow(array, std::max(4, array.layer_count * 2));
+        }
+        layer = (uint32_t)array.layer_count++;
+    }
+    ++array.used_count;
+    for (int level = 0; level < level_count; ++level) {
+        glCopyImageSubData(texture->id(), GL_TEXTURE_2D, level, 0, 0, 0, array.texture->id(),
+                           GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                           std::max(key.width >> level, 1), std::max(key.height >> level, 1), 1);
+    }
+
+    return {it->second, layer};
+}
+
+MaterialTable::Layer MaterialTable::AddView(const std::shared_ptr<Texture2d>& texture) {
+    auto it = view_indices_.find(texture.get());
+    if (it == view_indices_.end() || arrays_[it->second].viewed.lock() != texture) {
+        // a new texture, or a new one at the address of one that went
+        int index = (int)arrays_.size();
+        if (!free_views_.empty()) {
+            index = free_views_.back();
+            free_views_.pop_back();
+        } else {
+            arrays_.emplace_back();
+        }
+        Array& array = arrays_[index];
+        array.view = true;
+        array.viewed = texture;
+        view_indices_[texture.get()] = index;
+        it = view_indices_.find(texture.get());
+    }
+    Array& array = arrays_[it->second];
+    if (!array.texture || array.viewed_revision != texture->revision()) {
+        View(array, texture.get());
+    }
+    ++array.used_count;
+
+    return {it->second, 0};
+}
+
+void MaterialTable::View(Array& array, const Texture2d* texture) {
+    array.key = ArrayKey{texture->width(), texture->height(), texture->level_count(),
+                         texture->inner_format()};
+    array.texture = Texture2dArray::CreateView(texture);
+    array.layer_count = 1;
+    array.viewed_revision = texture->revision();
+}
+
+void MaterialTable::RemoveTexture(Layer layer) {
+    Array& array = arrays_[layer.first];
+    if (--array.used_count > 0) {
+        if (!array.view) {
+            array.free_layers.push_back(layer.second);
+        }
+        return;
+    }
+    // e.g. the full size copies of a streamed texture, once it is evicted
+    array.texture.reset();
+    array.layer_count = 0;
+    array.free_layers.clear();
+    if (array.view) {
+        // by index, the texture may be gone
+        for (auto it = view_indices_.begin(); it != view_indices_.end(); ++it) {
+            if (it->second == layer.first) {
+                view_indices_.erase(it);
+                break;
+            }
+        }
+        array.viewed.reset();
+        free_views_.push_back(layer.first);
+    }
+}
+
+void MaterialTable::Grow(Array& array, int layer_count) {
+    const ArrayKey& key = array.key;
+    auto texture = Texture2dArray::Create(key.width, key.height, layer_count, key.level_count,
+                                          key.inner_format);
+    for (int level = 0; array.layer_count > 0 && level < key.level_count; ++level) {
+        glCopyImageSubData(array.texture->id(), GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                           texture->id(), GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                           std::max(key.width >> level, 1), std::max(key.height >> level, 1),
+                           array.layer_count);
+    }
+    array.texture = std::move(texture);
+}
+
+void MaterialTable::MarkDirty(size_t index) {
+    if (dirty_begin_ == dirty_end_) {
+        dirty_begin_ = index;
+        dirty_end_ = index + 1;
+    } else {
+        dirty_begin_ = std::min(dirty_begin_, index);
+        dirty_end_ = std::max(dirty_end_, index + 1);
+    }
+}
+
+void MaterialTable::Upload() {
+    for (auto& array : arrays_) {
+        auto viewed = array.viewed.lock();
+        if (viewed && array.viewed_revision != viewed->revision()) {
+            View(array, viewed.get());
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        auto material = entries_[i].material.lock();
+        if (material && material->revision() != entries_[i].revision) {
+            entries_[i].revision = material->revision();
+            data_[i].params.x = material->shininess();
+            MarkDirty(i);
+        }
+    }
+    if (dirty_begin_ == dirty_end_) {
+        return;
+    }
+
+    if (data_.size() > buffer_->count()) {
+        buffer_->Orphan(data_.data(), data_.size() * sizeof(MaterialData));
+        uploaded_count_ = data_.size();
+    } else {
+        // an edit now and then, the GPU may still read the range but it is a few bytes
+        buffer_->Upload(&data_[dirty_begin_], (dirty_end_ - dirty_begin_) * sizeof(MaterialData),
+                        dirty_begin_ * sizeof(MaterialData));
+        uploaded_count_ = dirty_end_ - dirty_begin_;
+    }
+    dirty_begin_ = dirty_end_ = 0;
+}
+
+void MaterialTable::Bind(uint32_t texture_set, const Program* program) const {
+    const auto& set = texture_sets_[texture_set];
+    GlState::Get().ActiveTexture(kDiffuseUnit);
+    arrays_[set.first].texture->Bind();
+    GlState::Get().ActiveTexture(kSpecularUnit);
+    arrays_[set.second].texture->Bind();
+    GlState::Get().ActiveTexture(0);
+    program->SetUniform("materialDiffuse", kDiffuseUnit);
+    program->SetUniform("materialSpecular", kSpecularUnit);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kMaterialBinding, buffer_->id());
+    GlState::Get().CountBufferBind();
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef INCLUDED_MATERIAL_TABLE_HPP
+#define INCLUDED_MATERIAL_TABLE_HPP
+
+#include "buffer.hpp"
+#include "common.hpp"
+#include "material.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+
+#include <map>
+
+// per-material entry of the material_indirect.fs array
+struct MaterialData {
+    glm::uvec4 layers; // x: diffuse layer, y: specular layer
+    glm::vec4 params;  // x: shininess
+};
+
+// Copies the textures of the materials the draw list sees into GL_TEXTURE_2D_ARRAYs, one per
+// size and format, and keeps the layers and shininess of every material in an SSBO the
+// *_indirect shaders index with DrawData::material, the material id. Materials whose textures
+// share arrays share a texture set, and draws of one set need no binds in between, so the draw
+// list batches them into one indirect call whatever their material.
+//
+// Textures are copied when a material is first seen; the layers of copies no longer used are
+// reused. Textures of immutable storage, the streamed ones, are not copied but viewed: every one
+// gets an array of its own, a one layer view of its storage that costs no memory. When their
+// revision moves, as it does when the streamer changes the resident levels, Upload views the new
+// storage, so the old one goes right away even for materials nothing draws anymore. Parameter
+// changes are picked up too, Upload writes the range of entries whose revision moved.
+class MaterialTable {
+  public:
+    // cull.cs uses 0 to 5
+    static const uint32_t kMaterialBinding = 6;
+    static const int kDiffuseUnit = 0;
+    static const int kSpecularUnit = 1;
+
+    static std::unique_ptr<MaterialTable> Create();
+    ~MaterialTable();
+
+    // returns the index into the material array, the material id or the one of the stand-in for
+    // draws without a material. Textures a material lacks sample white
+    uint32_t Register(const std::shared_ptr<Material>& material);
+    inline uint32_t texture_set(uint32_t index) const { return entries_[index].texture_set; }
+    // orders draws by texture set, then by material
+    inline uint64_t sort_key(uint32_t index) const {
+        return (uint64_t)entries_[index].texture_set << 32 | index;
+    }
+
+    // writes the entries that changed since the last call, call it before drawing them
+    void Upload();
+    void Bind(uint32_t texture_set, const Program* program) const;
+
+    inline size_t material_count() const { return entries_.size(); }
+    // entries written by the last Upload that wrote any
+    inline size_t uploaded_count() const { return uploaded_count_; }
+    inline size_t texture_set_count() const { return texture_sets_.size(); }
+    inline size_t array_count() const { return arrays_.size(); }
+    inline size_t view_count() const { return view_indices_.size(); }
+
+  private:
+    struct ArrayKey {
+        int width;
+        int height;
+        int level_count;
+        uint32_t inner_format;
+
+        bool operator<(const ArrayKey& other) const;
+    };
+
+    struct Array {
+        ArrayKey key;
+        std::unique_ptr<Texture2dArray> texture;
+        int layer_count{0}; // the first ones, some may be free
+        int used_count{0};
+        std::vector<uint32_t> free_layers;
+        // of a view, layer 0 is the texture itself
+        bool view{false};
+        std::weak_ptr<Texture2d> viewed;
+        uint32_t viewed_revision{0};
+    };
+
+    // array and layer of a texture copy
+    using Layer = std::pair<int, uint32_t>;
+
+    struct Entry {
+        std::weak_ptr<Material> material;
+        uint32_t revision{0};
+        uint32_t texture_set{0};
+        Layer diffuse{-1, 0};
+        Layer specular{-1, 0};
+        uint32_t diffuse_revision{0};
+        uint32_t specular_revision{0};
+    };
+
+    MaterialTable();
+    bool Init();
+
+    // array and layer the texture was copied to, or of its view
+    Layer AddTexture(const std::shared_ptr<Texture2d>& texture);
+    Layer AddView(const std::shared_ptr<Texture2d>& texture);
+    // of the storage texture has now
+    void View(Array& array, const Texture2d* texture);
+    // frees the layer, the array goes when it has none left
+    void RemoveTexture(Layer layer);
+    // reallocates with room for `layer_count` layers and copies the ones in use over
+    void Grow(Array& array, int layer_count);
+    void MarkDirty(size_t index);
+
+    std::shared_ptr<Texture2d> white_{nullptr};
+    // stands in for draws without a material
+    std::shared_ptr<Material> default_{nullptr};
+    std::vector<Array> arrays_;
+    std::map<ArrayKey, int> array_indices_;
+    std::map<const Texture2d*, int> view_indices_;
+    // arrays of views that went, taken again before arrays_ grows
+    std::vector<int> free_views_;
+    // indexed by material id, the layers of an id's last material stay in their arrays until the
+    // id is taken again
+    std::vector<Entry> entries_;
+    std::vector<MaterialData> data_;
+    size_t dirty_begin_{0};
+    size_t dirty_end_{0};
+    size_t uploaded_count_{0};
+    // diffuse and specular array of every set
+    std::vector<std::pair<int, int>> texture_sets_;
+    std::map<std::pair<int, int>, uint32_t> texture_set_indices_;
+    std::unique_ptr<Buffer> buffer_{nullptr};
+};
+
+#endif
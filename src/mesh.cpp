@@ -1,13 +1,130 @@
 #include "mesh.hpp"
 
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+#include <float.h>
+
+namespace {
+// triangles (and vertices) per task, a multiple of the 4-wide batches
+const size_t kTangentGrain = 16 * 1024;
+
+// Writes one weighted tangent per triangle corner, four triangles at a time. Like MikkTSpace, the
+// face tangent is projected onto the plane of the corner's vertex normal and weighted by the
+// corner angle; w carries the same angle signed by the uv winding and decides the handedness.
+void ComputeCornerTangents(const std::vector<Vertex>& vertices,
+                           const std::vector<uint32_t>& indices, size_t first, size_t last,
+                           glm::vec4* corners) {
+    for (size_t t = first; t < last; t += 4) {
+        size_t lanes = std::min<size_t>(4, last - t);
+        // [corner][component][lane], short batches repeat their last triangle
+        float p[3][3][4];
+        float n[3][3][4];
+        float uv[3][2][4];
+        for (size_t l = 0; l < 4; ++l) {
+            size_t triangle = t + std::min(l, lanes - 1);
+            for (int c = 0; c < 3; ++c) {
+                const Vertex& v = vertices[indices[triangle * 3 + c]];
+                for (int k = 0; k < 3; ++k) {
+                    p[c][k][l] = v.position[k];
+                    n[c][k][l] = v.normal[k];
+                }
+                uv[c][0][l] = v.tex_coord.x;
+                uv[c][1][l] = v.tex_coord.y;
+            }
+        }
+
+        Float4x3 pos[3];
+        Float4x3 nrm[3];
+        Float4 u[3];
+        Float4 v[3];
+        for (int c = 0; c < 3; ++c) {
+            pos[c] = {Float4::Load(p[c][0]), Float4::Load(p[c][1]), Float4::Load(p[c][2])};
+            nrm[c] = {Float4::Load(n[c][0]), Float4::Load(n[c][1]), Float4::Load(n[c][2])};
+            u[c] = Float4::Load(uv[c][0]);
+            v[c] = Float4::Load(uv[c][1]);
+        }
+
+        Float4x3 edge1 = pos[1] - pos[0];
+        Float4x3 edge2 = pos[2] - pos[0];
+        Float4 du1 = u[1] - u[0];
+        Float4 dv1 = v[1] - v[0];
+        Float4 du2 = u[2] - u[0];
+        Float4 dv2 = v[2] - v[0];
+        Float4 area = du1 * dv2 - dv1 * du2;
+        Float4 sign = Select(Greater(area, Float4(0.0f)), Float4(1.0f), Float4(-1.0f));
+        Float4 valid = Greater(Abs(area), Float4(1e-12f));
+        Float4x3 face = NormalizeOrZero(edge1 * dv2 - edge2 * dv1) * sign;
+
+        for (int c = 0; c < 3; ++c) {
+            const Float4x3& normal = nrm[c];
+            Float4x3 a = pos[(c + 1) % 3] - pos[c];
+            Float4x3 b = pos[(c + 2) % 3] - pos[c];
+            a = NormalizeOrZero(a - normal * Dot(normal, a));
+            b = NormalizeOrZero(b - normal * Dot(normal, b));
+            Float4 cos_angle = Max(Min(Dot(a, b), Float4(1.0f)), Float4(-1.0f));
+            Float4 angle = Select(valid, Acos(cos_angle), Float4(0.0f));
+            Float4x3 tangent = NormalizeOrZero(face - normal * Dot(normal, face)) * angle;
+            Float4 handedness = sign * angle;
+
+            float out[4][4];
+            tangent.x.Store(out[0]);
+            tangent.y.Store(out[1]);
+            tangent.z.Store(out[2]);
+            handedness.Store(out[3]);
+            for (size_t l = 0; l < lanes; ++l) {
+                corners[(t + l) * 3 + c] = glm::vec4(out[0][l], out[1][l], out[2][l], out[3][l]);
+            }
+        }
+    }
+}
+
+// 64k vertices / 192k indices to start with, the pool doubles on demand
+const size_t kPoolVertexCapacity = 64 * 1024;
+const size_t kPoolIndexCapacity = 192 * 1024;
+
+// Meshes keep the pool alive, so it is released together with the last mesh while the GL context
+// still exists instead of at static destruction.
+std::shared_ptr<GeometryPool> SharedPool() {
+    static std::weak_ptr<GeometryPool> shared;
+    auto pool = shared.lock();
+    if (!pool) {
+        std::vector<GeometryPool::Attrib> attribs = {
+            {0, 3, GL_FLOAT, false, 0},
+            {1, 3, GL_FLOAT, false, offsetof(Vertex, normal)},
+            {2, 2, GL_FLOAT, false, offsetof(Vertex, tex_coord)},
+            {3, 4, GL_FLOAT, false, offsetof(Vertex, tangent)},
+        };
+        pool = GeometryPool::Create(sizeof(Vertex), attribs, kPoolVertexCapacity,
+                                    kPoolIndexCapacity);
+        shared = pool;
+    }
+
+    return pool;
+}
+} // namespace
+
 Mesh::Mesh(uint32_t primitive_type) : primitive_type_(primitive_type) {}
 
-Mesh::~Mesh() {}
+Mesh::~Mesh() {
+    if (pool_) {
+        pool_->Free(range_);
+    }
+}
 
 std::shared_ptr<Mesh> Mesh::Create(const std::vector<Vertex>& vertices,
                                    const std::vector<uint32_t>& indices, uint32_t primitive_type) {
-    auto mesh = std::shared_ptr<Mesh>(new Mesh(primitive_type));
-    mesh->Init(vertices, indices);
+    MeshData data{vertices, indices, primitive_type};
+    data.Prepare();
+
+    return Create(data);
+}
+
+std::shared_ptr<Mesh> Mesh::Create(const MeshData& data) {
+    auto mesh = ObjectPool<Mesh>::Default().MakeShared(data.primitive_type);
+    if (!mesh->Init(data)) {
+        return nullptr;
+    }
 
     return std::move(mesh);
 }
@@ -105,67 +222,99 @@ std::shared_ptr<Mesh> Mesh::CreatePlane() {
 }
 
 void Mesh::ComputeTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-    auto compute = [](const glm::vec3& pos1, const glm::vec3& pos2, const glm::vec3& pos3,
-                      const glm::vec2& uv1, const glm::vec2& uv2,
-                      const glm::vec2& uv3) -> glm::vec3 {
-        auto edge1 = pos2 - pos1;
-        auto edge2 = pos3 - pos1;
-        auto deltaUV1 = uv2 - uv1;
-        auto deltaUV2 = uv3 - uv1;
-        float det = (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-        if (det != 0.0f) {
-            auto invDet = 1.0f / det;
-            return deltaUV2.y * edge1 - deltaUV1.y * edge2;
-        } else {
-            return glm::vec3(0.0f, 0.0f, 0.0f);
-        }
-    };
+    size_t triangle_count = indices.size() / 3;
+    std::vector<glm::vec4> corners(triangle_count * 3);
+    ThreadPool::Default()->ParallelFor(
+        triangle_count, kTangentGrain, [&](size_t begin, size_t end) {
+            ComputeCornerTangents(vertices, indices, begin, end, corners.data());
+        });
 
-    std::vector<glm::vec3> tangents(vertices.size());
-    memset(tangents.data(), 0, tangents.size() * sizeof(glm::vec3));
+    // corners of neighbouring triangles hit the same vertices, so the scatter stays serial
+    std::vector<glm::vec4> tangents(vertices.size(), glm::vec4(0.0f));
+    for (size_t i = 0; i < corners.size(); ++i) {
+        tangents[indices[i]] += corners[i];
+    }
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        auto i0 = indices[i];
-        auto i1 = indices[i + 1];
-        auto i2 = indices[i + 2];
+    ThreadPool::Default()->ParallelFor(
+        vertices.size(), kTangentGrain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const glm::vec3& n = vertices[i].normal;
+                glm::vec3 t = glm::vec3(tangents[i]);
+                t -= n * glm::dot(n, t);
+                if (glm::dot(t, t) < 1e-20f) {
+                    // no uv gradient: any direction in the tangent plane will do
+                    t = glm::cross(n, fabsf(n.x) > 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f)
+                                                        : glm::vec3(1.0f, 0.0f, 0.0f));
+                    if (glm::dot(t, t) < 1e-20f) {
+                        t = glm::vec3(1.0f, 0.0f, 0.0f);
+                    }
+                }
+                float w = tangents[i].w < 0.0f ? -1.0f : 1.0f;
+                vertices[i].tangent = glm::vec4(glm::normalize(t), w);
+            }
+        });
+}
 
-        tangents[i0] +=
-            compute(vertices[i0].position, vertices[i1].position, vertices[i2].position,
-                    vertices[i0].tex_coord, vertices[i1].tex_coord, vertices[i2].tex_coord);
+void MeshData::Prepare() {
+    if (primitive_type != GL_TRIANGLES) {
+        return;
+    }
+    OptimizeVertexFetch();
+    if (!has_tangents) {
+        Mesh::ComputeTangents(vertices, indices);
+    }
+}
 
-        tangents[i1] =
-            compute(vertices[i1].position, vertices[i2].position, vertices[i0].position,
-                    vertices[i1].tex_coord, vertices[i2].tex_coord, vertices[i0].tex_coord);
+void MeshData::OptimizeVertexFetch() {
+    // renumber vertices in order of first use so the vertex fetch walks memory linearly
+    const uint32_t kUnused = (uint32_t)-1;
+    std::vector<uint32_t> remap(vertices.size(), kUnused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
 
-        tangents[i2] =
-            compute(vertices[i2].position, vertices[i0].position, vertices[i1].position,
-                    vertices[i2].tex_coord, vertices[i0].tex_coord, vertices[i1].tex_coord);
+    for (auto& index : indices) {
+        if (remap[index] == kUnused) {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
     }
+    vertices = std::move(reordered);
+}
 
-    for (size_t i = 0; i < vertices.size(); i++) {
-        vertices[i].tangent = glm::normalize(tangents[i]);
+bool Mesh::Init(const MeshData& data) {
+    pool_ = SharedPool();
+    if (!pool_) {
+        return false;
+    }
+    range_ = pool_->Allocate(data.vertices.data(), data.vertices.size(), data.indices.data(),
+                             data.indices.size());
+    if (range_.index_count == 0) {
+        SPDLOG_ERROR("failed to allocate mesh: {} vertices, {} indices", data.vertices.size(),
+                     data.indices.size());
+        return false;
     }
-}
 
-void Mesh::Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-    if (primitive_type_ == GL_TRIANGLES) {
-        ComputeTangents(const_cast<std::vector<Vertex>&>(vertices), indices);
+    glm::vec3 min(FLT_MAX);
+    glm::vec3 max(-FLT_MAX);
+    for (const auto& vertex : data.vertices) {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
     }
-    vertex_array_ = VertexArray::Create();
-    vertex_buffer_ = Buffer::Create(GL_ARRAY_BUFFER, GL_STATIC_DRAW, vertices.data(),
-                                    sizeof(Vertex), vertices.size());
-    index_buffer_ = Buffer::Create(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW, indices.data(),
-                                   sizeof(uint32_t), indices.size());
-    vertex_array_->SetAttrib(0, 3, GL_FLOAT, false, sizeof(Vertex), 0);
-    vertex_array_->SetAttrib(1, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, normal));
-    vertex_array_->SetAttrib(2, 2, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, tex_coord));
-    vertex_array_->SetAttrib(3, 3, GL_FLOAT, false, sizeof(Vertex), offsetof(Vertex, tangent));
+    glm::vec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (const auto& vertex : data.vertices) {
+        radius = glm::max(radius, glm::length(vertex.position - center));
+    }
+    bounds_ = glm::vec4(center, radius);
+
+    return true;
 }
 
-void Mesh::Draw(const Program* program) const {
-    vertex_array_->Bind();
+void Mesh::Draw(const Program* program, int instance_count) const {
+    pool_->Bind();
     if (material_) {
         material_->SetToProgram(program);
     }
-    glDrawElements(primitive_type_, index_buffer_->count(), GL_UNSIGNED_INT, 0);
+    pool_->Draw(primitive_type_, range_, instance_count);
 }
@@ -1,16 +1,28 @@
 #ifndef INCLUDED_MESH_HPP
 #define INCLUDED_MESH_HPP
 
-#include "buffer.hpp"
 #include "common.hpp"
+#include "geometry_pool.hpp"
 #include "material.hpp"
-#include "vertex_array.hpp"
+#include "object_pool.hpp"
 
 struct Vertex {
     glm::vec3 position;
     glm::vec3 normal;
     glm::vec2 tex_coord;
-    glm::vec3 tangent;
+    glm::vec4 tangent; // w: bitangent sign, bitangent = cross(normal, tangent.xyz) * w
+};
+
+// CPU side of a mesh. Prepare() touches no GL state, so meshes can be prepared on worker threads
+// and handed to Mesh::Create on the render thread.
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t primitive_type{GL_TRIANGLES};
+    bool has_tangents{false};
+
+    void Prepare();
+    void OptimizeVertexFetch();
 };
 
 class Mesh {
@@ -18,6 +30,7 @@ class Mesh {
     static std::shared_ptr<Mesh> Create(const std::vector<Vertex>& vertices,
                                         const std::vector<uint32_t>& indices,
                                         uint32_t primitive_type);
+    static std::shared_ptr<Mesh> Create(const MeshData& data);
     static std::shared_ptr<Mesh> CreateBox();
     static std::shared_ptr<Mesh> CreateSphere(size_t slice, size_t stack);
     static std::shared_ptr<Mesh> CreatePlane();
@@ -25,24 +38,29 @@ class Mesh {
                                 const std::vector<uint32_t>& indices);
     ~Mesh();
 
-    void Draw(const Program* program) const;
+    void Draw(const Program* program, int instance_count = 1) const;
 
-    inline const VertexArray* vertex_array() const { return vertex_array_.get(); }
-    inline std::shared_ptr<Buffer> vertex_buffer() const { return vertex_buffer_; }
-    inline std::shared_ptr<Buffer> index_buffer() const { return index_buffer_; }
+    // every mesh lives in the same pool, so this is also the VAO all meshes are drawn with
+    inline const GeometryPool* pool() const { return pool_.get(); }
+    inline const GeometryPool::Range& range() const { return range_; }
+    inline uint32_t primitive_type() const { return primitive_type_; }
+    // local bounding sphere, xyz: center, w: radius
+    inline const glm::vec4& bounds() const { return bounds_; }
     inline std::shared_ptr<Material> material() const { return material_; }
     inline void set_material(std::shared_ptr<Material> material) { material_ = material; }
 
   private:
+    friend class ObjectPool<Mesh>;
+
     Mesh(uint32_t primitive_type);
     Mesh(const Mesh& mesh);
 
-    void Init(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    bool Init(const MeshData& data);
 
     uint32_t primitive_type_{GL_TRIANGLES};
-    std::unique_ptr<VertexArray> vertex_array_{nullptr};
-    std::shared_ptr<Buffer> vertex_buffer_{nullptr};
-    std::shared_ptr<Buffer> index_buffer_{nullptr};
+    std::shared_ptr<GeometryPool> pool_{nullptr};
+    GeometryPool::Range range_;
+    glm::vec4 bounds_{0.0f};
     std::shared_ptr<Material> material_{nullptr};
 };
 
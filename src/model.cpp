@@ -1,13 +1,15 @@
 #include "model.hpp"
 
+#include <algorithm>
+
 Model::Model() {}
 
 Model::~Model() {}
 
-std::unique_ptr<Model> Model::Load(const std::string& filename) {
+std::unique_ptr<Model> Model::Load(const std::string& filename, TextureStreamer* streamer) {
     auto model = std::unique_ptr<Model>(new Model());
 
-    if (!model->LoadByAssimp(filename)) {
+    if (!model->LoadByAssimp(filename, streamer)) {
         return nullptr;
     }
     return std::move(model);
@@ -19,21 +21,17 @@ void Model::Draw(const Program* program) const {
     }
 }
 
-bool Model::LoadByAssimp(const std::string& filename) {
+bool Model::LoadByAssimp(const std::string& filename, TextureStreamer* streamer) {
     Assimp::Importer importer;
 
-    auto LoadTexture = [](const std::string& dirname, aiMaterial* ai_material,
-                          aiTextureType ai_texture_type) -> std::unique_ptr<Texture2d> {
+    auto TexturePath = [](const std::string& dirname, aiMaterial* ai_material,
+                          aiTextureType ai_texture_type) -> std::string {
         if (ai_material->GetTextureCount(ai_texture_type) <= 0) {
-            return nullptr;
+            return "";
         }
         aiString filepath;
         ai_material->GetTexture(aiTextureType_DIFFUSE, 0, &filepath);
-        auto image = Image::Load(fmt::format(dirname + "/" + filepath.C_Str()));
-        if (!image) {
-            return nullptr;
-        }
-        return Texture2d::Create(image.get());
+        return fmt::format(dirname + "/" + filepath.C_Str());
     };
     auto scene = importer.ReadFile(filename, aiProcess_Triangulate | aiProcess_FlipUVs);
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
@@ -41,50 +39,132 @@ bool Model::LoadByAssimp(const std::string& filename) {
         return false;
     }
     auto dirname = filename.substr(0, filename.find_last_of("/"));
+
+    // image decoding and mip baking need no GL context, the jobs overlap with the mesh
+    // processing below. diffuse and specular image of every material
+    std::vector<std::string> paths(scene->mNumMaterials * 2);
+    std::vector<std::unique_ptr<Image>> images(paths.size());
+    ThreadPool::Counter decoded;
+    for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
+        const aiTextureType types[2] = {aiTextureType_DIFFUSE, aiTextureType_SPECULAR};
+        for (size_t j = 0; j < 2; ++j) {
+            auto path = TexturePath(dirname, scene->mMaterials[i], types[j]);
+            paths[i * 2 + j] = path;
+            // a mip file once per image, jobs baking the same one would write it together
+            bool seen = std::find(paths.begin(), paths.begin() + i * 2 + j, path) !=
+                        paths.begin() + i * 2 + j;
+            if (path.empty() || (streamer && seen)) {
+                continue;
+            }
+            auto* image = &images[i * 2 + j];
+            ThreadPool::Default()->Submit(
+                [image, path, streamer]() {
+                    if (streamer) {
+                        TextureStreamer::Bake(path);
+                    } else {
+                        *image = Image::Load(path);
+                    }
+                },
+                &decoded);
+        }
+    }
+    std::vector<const aiMesh*> ai_meshes;
+    ProcessNode(scene->mRootNode, scene, ai_meshes);
+
+    // vertex conversion and tangent generation need no GL context, so they run on the pool and
+    // only the buffer upload below stays on the render thread
+    std::vector<MeshData> mesh_data(ai_meshes.size());
+    ThreadPool::Default()->ParallelFor(ai_meshes.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            mesh_data[i] = ProcessMesh(ai_meshes[i]);
+        }
+    });
+    ThreadPool::Default()->Wait(&decoded);
     for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
-        aiMaterial* scene_material = scene->mMaterials[i];
         std::shared_ptr<Material> material = Material::Create();
-        material->diffuse_ = LoadTexture(dirname, scene_material, aiTextureType_DIFFUSE);
-        material->specular_ = LoadTexture(dirname, scene_material, aiTextureType_SPECULAR);
+        if (streamer) {
+            // baked by now, Add only reads the small levels
+            if (!paths[i * 2].empty()) {
+                material->diffuse_ = streamer->Add(paths[i * 2]);
+            }
+            if (!paths[i * 2 + 1].empty()) {
+                material->specular_ = streamer->Add(paths[i * 2 + 1]);
+            }
+        } else {
+            if (images[i * 2]) {
+                material->diffuse_ = Texture2d::Create(images[i * 2].get());
+            }
+            if (images[i * 2 + 1]) {
+                material->specular_ = Texture2d::Create(images[i * 2 + 1].get());
+            }
+        }
 
         materials_.push_back(std::move(material));
     }
-    ProcessNode(scene->mRootNode, scene);
+    for (size_t i = 0; i < ai_meshes.size(); ++i) {
+        // null when the geometry pool cannot take it, e.g. a mesh without faces or too large
+        std::shared_ptr<Mesh> mesh = Mesh::Create(mesh_data[i]);
+        if (!mesh) {
+            SPDLOG_WARN("{}: skipped mesh {} of {}", filename, i, ai_meshes.size());
+            continue;
+        }
+        if (ai_meshes[i]->mMaterialIndex < materials_.size()) {
+            mesh->set_material(materials_[ai_meshes[i]->mMaterialIndex]);
+        }
+        meshes_.push_back(std::move(mesh));
+    }
+    if (meshes_.empty()) {
+        SPDLOG_ERROR("model has no meshes: {}", filename);
+        return false;
+    }
     return true;
 }
 
-void Model::ProcessNode(aiNode* ai_node, const aiScene* ai_scene) {
+void Model::ProcessNode(aiNode* ai_node, const aiScene* ai_scene,
+                        std::vector<const aiMesh*>& ai_meshes) {
     for (uint32_t i = 0; i < ai_node->mNumMeshes; i++) {
         auto mesh_index = ai_node->mMeshes[i];
-        auto mesh = ai_scene->mMeshes[mesh_index];
-        ProcessMesh(mesh, ai_scene);
+        ai_meshes.push_back(ai_scene->mMeshes[mesh_index]);
     }
     for (uint32_t i = 0; i < ai_node->mNumChildren; i++) {
-        ProcessNode(ai_node->mChildren[i], ai_scene);
+        ProcessNode(ai_node->mChildren[i], ai_scene, ai_meshes);
     }
 }
 
-void Model::ProcessMesh(aiMesh* ai_mesh, const aiScene* ai_scene) {
-    std::vector<Vertex> vertices(ai_mesh->mNumVertices);
-    std::vector<uint32_t> indices(ai_mesh->mNumFaces * 3);
+MeshData Model::ProcessMesh(const aiMesh* ai_mesh) {
+    MeshData data;
+    data.primitive_type = GL_TRIANGLES;
+    data.vertices.resize(ai_mesh->mNumVertices);
+    data.indices.resize(ai_mesh->mNumFaces * 3);
 
     for (uint32_t i = 0; i < ai_mesh->mNumVertices; i++) {
-        Vertex& v = vertices[i];
+        Vertex& v = data.vertices[i];
         v.position =
             glm::vec3(ai_mesh->mVertices[i].x, ai_mesh->mVertices[i].y, ai_mesh->mVertices[i].z);
         v.normal =
             glm::vec3(ai_mesh->mNormals[i].x, ai_mesh->mNormals[i].y, ai_mesh->mNormals[i].z);
         v.tex_coord = glm::vec2(ai_mesh->mTextureCoords[0][i].x, ai_mesh->mTextureCoords[0][i].y);
-        v.tangent = glm::vec3(0.0f);
+        v.tangent = glm::vec4(0.0f);
     }
-    for (uint32_t i = 0; i < ai_mesh->mNumFaces; i++) {
-        indices[i * 3] = ai_mesh->mFaces[i].mIndices[0];
-        indices[i * 3 + 1] = ai_mesh->mFaces[i].mIndices[1];
-        indices[i * 3 + 2] = ai_mesh->mFaces[i].mIndices[2];
+    // tangents stored in the file (glTF, FBX) are kept, aiProcess_CalcTangentSpace is not asked
+    // for since Prepare generates them in parallel. OBJ files have none
+    if (ai_mesh->HasTangentsAndBitangents()) {
+        for (uint32_t i = 0; i < ai_mesh->mNumVertices; i++) {
+            Vertex& v = data.vertices[i];
+            glm::vec3 t(ai_mesh->mTangents[i].x, ai_mesh->mTangents[i].y, ai_mesh->mTangents[i].z);
+            glm::vec3 b(ai_mesh->mBitangents[i].x, ai_mesh->mBitangents[i].y,
+                        ai_mesh->mBitangents[i].z);
+            float w = glm::dot(glm::cross(v.normal, t), b) < 0.0f ? -1.0f : 1.0f;
+            v.tangent = glm::vec4(t, w);
+        }
+        data.has_tangents = true;
     }
-    std::shared_ptr<Mesh> mesh = Mesh::Create(vertices, indices, GL_TRIANGLES);
-    if (ai_mesh->mMaterialIndex >= 0) {
-        mesh->set_material(materials_[ai_mesh->mMaterialIndex]);
+    for (uint32_t i = 0; i < ai_mesh->mNumFaces; i++) {
+        data.indices[i * 3] = ai_mesh->mFaces[i].mIndices[0];
+        data.indices[i * 3 + 1] = ai_mesh->mFaces[i].mIndices[1];
+        data.indices[i * 3 + 2] = ai_mesh->mFaces[i].mIndices[2];
     }
-    meshes_.push_back(std::move(mesh));
-}
\ No newline at end of file
+    data.Prepare();
+
+    return data;
+}
@@ -11,10 +11,14 @@
 #include "material.hpp"
 #include "mesh.hpp"
 #include "texture.hpp"
+#include "texture_streamer.hpp"
+#include "thread_pool.hpp"
 
 class Model {
   public:
-    static std::unique_ptr<Model> Load(const std::string& filename);
+    // the textures stream through streamer when there is one
+    static std::unique_ptr<Model> Load(const std::string& filename,
+                                       TextureStreamer* streamer = nullptr);
     ~Model();
 
     void Draw(const Program* program) const;
@@ -31,9 +35,10 @@ class Model {
     Model();
     Model(const Model& model);
 
-    bool LoadByAssimp(const std::string& filename);
-    void ProcessMesh(aiMesh* ai_mesh, const aiScene* ai_scene);
-    void ProcessNode(aiNode* ai_node, const aiScene* ai_scene);
+    bool LoadByAssimp(const std::string& filename, TextureStreamer* streamer);
+    static MeshData ProcessMesh(const aiMesh* ai_mesh);
+    void ProcessNode(aiNode* ai_node, const aiScene* ai_scene,
+                     std::vector<const aiMesh*>& ai_meshes);
 
     std::vector<std::shared_ptr<Mesh>> meshes_;
     std::vector<std::shared_ptr<Material>> materials_;
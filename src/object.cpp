@@ -1,3 +1,3 @@
 #include "object.hpp"
 
-size_t Object::kId = 0;
\ No newline at end of file
+std::atomic<size_t> Object::kId{0};
\ No newline at end of file
@@ -4,10 +4,13 @@
 #include "bounding_sphere.hpp"
 #include "common.hpp"
 #include "mesh.hpp"
+#include "object_pool.hpp"
 #include "program.hpp"
 #include "ray.hpp"
 #include "transform.hpp"
 
+#include <atomic>
+
 class DrawableObject {
   public:
     DrawableObject(std::shared_ptr<Mesh> mesh) : mesh_(mesh) {};
@@ -47,6 +50,8 @@ class TouchableObject {
         }
         return bounding_sphere_->Intersect(ray, t);
     }
+    // unscaled, 0 without a bounding sphere
+    float bounding_radius() const { return bounding_sphere_ ? bounding_sphere_->radius() : 0.0f; }
 
   private:
     std::unique_ptr<BoundingSphere> bounding_sphere_{nullptr};
@@ -55,7 +60,7 @@ class TouchableObject {
 class Object : public DrawableObject, public TransformableObject, public TouchableObject {
   public:
     static std::shared_ptr<Object> Create(std::shared_ptr<Mesh> mesh) {
-        auto object = std::shared_ptr<Object>(new Object(mesh));
+        auto object = ObjectPool<Object>::Default().MakeShared(mesh);
 
         return std::move(object);
     }
@@ -68,7 +73,10 @@ class Object : public DrawableObject, public TransformableObject, public Touchab
         : DrawableObject(mesh), TransformableObject(), TouchableObject(), id_(Object::kId++) {}
 
   private:
-    static size_t kId;
+    friend class ObjectPool<Object>;
+
+    // objects of streamed cells are made on the thread pool
+    static std::atomic<size_t> kId;
     const size_t id_;
 };
 
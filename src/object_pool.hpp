@@ -0,0 +1,250 @@
+#ifndef INCLUDED_OBJECT_POOL_HPP
+#define INCLUDED_OBJECT_POOL_HPP
+
+#include "common.hpp"
+
+#include <mutex>
+#include <new>
+
+// Free list of fixed-size blocks carved out of chunks that never move or shrink, so Allocate and
+// Free are O(1) and the pool cannot fragment. Backs the shared_ptr control blocks of pooled
+// objects.
+class BlockPool {
+  public:
+    BlockPool(size_t block_size, size_t alignment, size_t blocks_per_chunk = 256)
+        : block_size_(Padded(std::max(block_size, sizeof(FreeBlock)), alignment)),
+          blocks_per_chunk_(blocks_per_chunk) {
+        // chunks come from new[], aligned for max_align_t
+        assert(alignment <= alignof(std::max_align_t));
+    }
+
+    void* Allocate() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_) {
+            chunks_.push_back(std::make_unique<uint8_t[]>(block_size_ * blocks_per_chunk_));
+            for (size_t i = blocks_per_chunk_; i-- > 0;) {
+                auto block = reinterpret_cast<FreeBlock*>(chunks_.back().get() + i * block_size_);
+                block->next = free_;
+                free_ = block;
+            }
+        }
+        FreeBlock* block = free_;
+        free_ = block->next;
+
+        return block;
+    }
+
+    void Free(void* data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto block = static_cast<FreeBlock*>(data);
+        block->next = free_;
+        free_ = block;
+    }
+
+    inline size_t chunk_count() const { return chunks_.size(); }
+
+  private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static size_t Padded(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    const size_t block_size_;
+    const size_t blocks_per_chunk_;
+    std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+    FreeBlock* free_{nullptr};
+    std::mutex mutex_;
+};
+
+// Allocator of single objects from a process-wide BlockPool per type, what shared_ptr needs for
+// its control block. Arrays go to the heap.
+template <typename T> class PoolAllocator {
+  public:
+    using value_type = T;
+
+    PoolAllocator() {}
+    template <typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        if (count != 1) {
+            return std::allocator<T>().allocate(count);
+        }
+        return static_cast<T*>(Pool().Allocate());
+    }
+    void deallocate(T* data, size_t count) {
+        if (count != 1) {
+            std::allocator<T>().deallocate(data, count);
+            return;
+        }
+        Pool().Free(data);
+    }
+
+    template <typename U> bool operator==(const PoolAllocator<U>&) const { return true; }
+    template <typename U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+
+  private:
+    // never destroyed, a shared_ptr in a static may be released after it would have been
+    static BlockPool& Pool() {
+        static BlockPool* pool = new BlockPool(sizeof(T), alignof(T));
+        return *pool;
+    }
+};
+
+// Typed slots in chunks of kChunkSize that never move, reused through a free list: creating and
+// destroying is O(1), addresses stay stable and freed slots are taken again before the pool
+// grows, so spawning and despawning many objects neither fragments nor calls malloc once the
+// pool is warm.
+//
+// A Handle is a slot index and the generation of the slot when the object was made. Destroying
+// bumps the generation, so Get returns null for handles of destroyed objects instead of a
+// reused slot. Every call locks, so any thread may create, get and destroy; a pointer from Get
+// stays valid only until its object is destroyed.
+template <typename T> class ObjectPool {
+  public:
+    static const uint32_t kChunkSize = 256;
+
+    struct Handle {
+        uint32_t index{UINT32_MAX};
+        uint32_t generation{0};
+
+        inline bool valid() const { return index != UINT32_MAX; }
+        bool operator==(const Handle& other) const {
+            return index == other.index && generation == other.generation;
+        }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    // the pool of every T made through Create / MakeShared of its class. Never destroyed, pooled
+    // objects held by statics may go after it would have been
+    static ObjectPool& Default() {
+        static ObjectPool* pool = new ObjectPool();
+        return *pool;
+    }
+
+    template <typename... Args> Handle Create(Args&&... args) {
+        Slot* slot = Emplace(std::forward<Args>(args)...);
+        return Handle{slot->index, slot->generation};
+    }
+
+    // destroys the object, its handles go stale. false when they already were
+    bool Destroy(Handle handle) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot* slot = Find(handle);
+        if (!slot) {
+            return false;
+        }
+        slot->object()->~T();
+        slot->alive = false;
+        ++slot->generation;
+        slot->next_free = free_;
+        free_ = handle.index;
+        --size_;
+
+        return true;
+    }
+
+    // null for stale or invalid handles
+    T* Get(Handle handle) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot* slot = Find(handle);
+        return slot ? slot->object() : nullptr;
+    }
+
+    // of an object this pool made
+    Handle HandleOf(const T* object) const {
+        // the storage is the first member, the object's address is its slot's
+        auto slot = reinterpret_cast<const Slot*>(object);
+        return Handle{slot->index, slot->generation};
+    }
+
+    // owned by shared pointers instead, the last one destroys it. The control block comes from a
+    // BlockPool, so neither half touches the heap
+    template <typename... Args> std::shared_ptr<T> MakeShared(Args&&... args) {
+        // the slot, not Get: another thread may grow the pool once Emplace unlocked
+        Slot* slot = Emplace(std::forward<Args>(args)...);
+        Handle handle{slot->index, slot->generation};
+        return std::shared_ptr<T>(slot->object(), Deleter{this, handle}, PoolAllocator<T>());
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+    size_t capacity() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Capacity();
+    }
+
+  private:
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t index;
+        uint32_t generation;
+        uint32_t next_free; // while free
+        bool alive;
+
+        T* object() { return reinterpret_cast<T*>(storage); }
+    };
+
+    struct Deleter {
+        ObjectPool* pool;
+        Handle handle;
+
+        void operator()(T*) const { pool->Destroy(handle); }
+    };
+
+    ObjectPool() {}
+
+    template <typename... Args> Slot* Emplace(Args&&... args) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_ == kNone) {
+            Grow();
+        }
+        Slot& slot = At(free_);
+        free_ = slot.next_free;
+        new (slot.storage) T(std::forward<Args>(args)...);
+        slot.alive = true;
+        ++size_;
+
+        return &slot;
+    }
+
+    // the rest of these expect the lock held
+    size_t Capacity() const { return chunks_.size() * kChunkSize; }
+
+    Slot& At(uint32_t index) const { return chunks_[index / kChunkSize][index % kChunkSize]; }
+
+    Slot* Find(Handle handle) const {
+        if (handle.index >= Capacity()) {
+            return nullptr;
+        }
+        Slot& slot = At(handle.index);
+        return slot.alive && slot.generation == handle.generation ? &slot : nullptr;
+    }
+
+    // lowest index on top of the free list, so live objects stay packed at the front
+    void Grow() {
+        uint32_t first = (uint32_t)Capacity();
+        chunks_.push_back(std::make_unique<Slot[]>(kChunkSize));
+        for (uint32_t i = kChunkSize; i-- > 0;) {
+            Slot& slot = chunks_.back()[i];
+            slot.index = first + i;
+            slot.generation = 0;
+            slot.alive = false;
+            slot.next_free = free_;
+            free_ = first + i;
+        }
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    uint32_t free_{kNone};
+    size_t size_{0};
+    mutable std::mutex mutex_;
+};
+
+#endif
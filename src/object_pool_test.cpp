@@ -0,0 +1,140 @@
+#include "object_pool.hpp"
+#include "thread_pool.hpp"
+#include "unit_test.hpp"
+
+#include <atomic>
+
+// Unit tests of ObjectPool: generational handles, slot reuse, and creating, looking up and
+// destroying from several workers at once while the pool grows.
+namespace {
+
+// a type of its own, so the pool starts empty and grows under the workers
+struct Item {
+    Item(uint32_t value) : value(value) {}
+
+    uint32_t value;
+};
+
+using ItemPool = ObjectPool<Item>;
+
+// destroyed handles go stale, freed slots are taken again lowest first, with a new generation
+void TestHandles() {
+    auto& items = ItemPool::Default();
+    auto first = items.Create(1u);
+    auto second = items.Create(2u);
+    CHECK(first.valid() && second.valid());
+    CHECK(items.Get(first) && items.Get(first)->value == 1);
+    CHECK(items.HandleOf(items.Get(second)) == second);
+    CHECK(items.Destroy(first));
+    CHECK(!items.Destroy(first));
+    CHECK(items.Get(first) == nullptr);
+    CHECK(items.Get(ItemPool::Handle{}) == nullptr);
+
+    auto third = items.Create(3u);
+    CHECK(third.index == first.index);
+    CHECK(third.generation != first.generation);
+    CHECK(items.Get(first) == nullptr);
+    CHECK(items.Get(third)->value == 3);
+
+    // the last shared pointer destroys it
+    auto shared = items.MakeShared(4u);
+    auto handle = items.HandleOf(shared.get());
+    auto copy = shared;
+    shared.reset();
+    CHECK(items.Get(handle) == copy.get());
+    copy.reset();
+    CHECK(items.Get(handle) == nullptr);
+
+    items.Destroy(second);
+    items.Destroy(third);
+    CHECK(items.size() == 0);
+}
+
+// workers make shared items and look up handles of the others while the pool grows chunk by
+// chunk, each item must keep its own slot and value
+void TestConcurrentCreate(ThreadPool* pool) {
+    const uint32_t kItemCount = 64 * ItemPool::kChunkSize;
+    auto& items = ItemPool::Default();
+    std::vector<std::shared_ptr<Item>> shared(kItemCount);
+    std::vector<ItemPool::Handle> handles(kItemCount);
+    std::vector<std::atomic<bool>> ready(kItemCount);
+    std::atomic<uint32_t> created{0};
+    std::atomic<int> bad_gets{0};
+    pool->ParallelFor(kItemCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            shared[i] = items.MakeShared((uint32_t)i);
+            handles[i] = items.HandleOf(shared[i].get());
+            ready[i].store(true, std::memory_order_release);
+            // maybe one made by another worker
+            uint32_t other = created.fetch_add(1) / 2;
+            if (ready[other].load(std::memory_order_acquire)) {
+                Item* item = items.Get(handles[other]);
+                if (item && item->value != other) {
+                    bad_gets.fetch_add(1);
+                }
+            }
+        }
+    });
+    CHECK(bad_gets == 0);
+    CHECK(items.size() == kItemCount);
+    CHECK(items.capacity() >= kItemCount);
+
+    int wrong = 0;
+    for (uint32_t i = 0; i < kItemCount; ++i) {
+        Item* item = items.Get(handles[i]);
+        wrong += item != shared[i].get() || shared[i]->value != i;
+    }
+    CHECK(wrong == 0);
+
+    // released on the workers while others are made
+    std::vector<std::shared_ptr<Item>> replacements(kItemCount);
+    pool->ParallelFor(kItemCount, 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            shared[i].reset();
+            replacements[i] = items.MakeShared((uint32_t)(kItemCount + i));
+        }
+    });
+    int stale = 0;
+    for (uint32_t i = 0; i < kItemCount; ++i) {
+        Item* item = items.Get(handles[i]);
+        // a reused slot has a new generation, the old handle must not find its item
+        stale += item != nullptr && item->value != i;
+        wrong += replacements[i]->value != kItemCount + i;
+    }
+    CHECK(stale == 0);
+    CHECK(wrong == 0);
+    CHECK(items.size() == kItemCount);
+    replacements.clear();
+    CHECK(items.size() == 0);
+}
+
+// Create / Destroy by handle from many workers, every handle goes stale exactly once
+void TestConcurrentDestroy(ThreadPool* pool) {
+    const uint32_t kItemCount = 16 * ItemPool::kChunkSize;
+    auto& items = ItemPool::Default();
+    std::vector<ItemPool::Handle> handles(kItemCount);
+    pool->ParallelFor(kItemCount, 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            handles[i] = items.Create((uint32_t)i);
+        }
+    });
+    std::atomic<int> destroyed{0};
+    pool->ParallelFor(2 * kItemCount, 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            destroyed.fetch_add(items.Destroy(handles[i % kItemCount]) ? 1 : 0);
+        }
+    });
+    CHECK(destroyed == (int)kItemCount);
+    CHECK(items.size() == 0);
+}
+
+} // namespace
+
+int main() {
+    TestHandles();
+    auto pool = ThreadPool::Create(4);
+    TestConcurrentCreate(pool.get());
+    TestConcurrentDestroy(pool.get());
+
+    return TestResult();
+}
@@ -0,0 +1,77 @@
+#include "overdraw_counter.hpp"
+
+namespace {
+
+const float kPrepassOnOverdraw = 1.5f;
+const float kPrepassOffOverdraw = 1.2f;
+const int kMeasureInterval = 60;
+
+} // namespace
+
+OverdrawCounter::OverdrawCounter() {}
+
+OverdrawCounter::~OverdrawCounter() {
+    for (auto& frame : frames_) {
+        glDeleteQueries(2, frame.queries);
+    }
+}
+
+std::unique_ptr<OverdrawCounter> OverdrawCounter::Create(int frame_count) {
+    auto counter = std::unique_ptr<OverdrawCounter>(new OverdrawCounter());
+    counter->Init(frame_count);
+
+    return std::move(counter);
+}
+
+void OverdrawCounter::Init(int frame_count) {
+    frames_.resize(frame_count);
+    for (auto& frame : frames_) {
+        glGenQueries(2, frame.queries);
+    }
+}
+
+void OverdrawCounter::BeginFrame() {
+    frame_index_ = (frame_index_ + 1) % (int)frames_.size();
+    ++frames_since_ratio_;
+
+    Frame& frame = frames_[frame_index_];
+    if (frame.issued[kDepthPass] && frame.issued[kShadePass]) {
+        GLuint available[2] = {GL_FALSE, GL_FALSE};
+        glGetQueryObjectuiv(frame.queries[kDepthPass], GL_QUERY_RESULT_AVAILABLE, &available[0]);
+        glGetQueryObjectuiv(frame.queries[kShadePass], GL_QUERY_RESULT_AVAILABLE, &available[1]);
+        if (available[0] && available[1]) {
+            glGetQueryObjectui64v(frame.queries[kDepthPass], GL_QUERY_RESULT,
+                                  &samples_[kDepthPass]);
+            glGetQueryObjectui64v(frame.queries[kShadePass], GL_QUERY_RESULT,
+                                  &samples_[kShadePass]);
+            if (samples_[kShadePass]) {
+                ratio_ = (float)samples_[kDepthPass] / samples_[kShadePass];
+                frames_since_ratio_ = 0;
+            }
+        }
+    }
+    frame.issued[kDepthPass] = false;
+    frame.issued[kShadePass] = false;
+}
+
+void OverdrawCounter::Begin(Pass pass) {
+    glBeginQuery(GL_SAMPLES_PASSED, frames_[frame_index_].queries[pass]);
+    frames_[frame_index_].issued[pass] = true;
+    active_ = pass;
+}
+
+void OverdrawCounter::End() {
+    if (active_ >= 0) {
+        glEndQuery(GL_SAMPLES_PASSED);
+        active_ = -1;
+    }
+}
+
+bool OverdrawCounter::ShouldPrepass() {
+    if (ratio_ == 0.0f || frames_since_ratio_ > kMeasureInterval) {
+        return true;
+    }
+    prepass_ = ratio_ >= (prepass_ ? kPrepassOffOverdraw : kPrepassOnOverdraw);
+
+    return prepass_;
+}
@@ -0,0 +1,51 @@
+#ifndef INCLUDED_OVERDRAW_COUNTER_HPP
+#define INCLUDED_OVERDRAW_COUNTER_HPP
+
+#include "common.hpp"
+
+// GL_SAMPLES_PASSED counts of the pass that lays down the scene depth and of the lighting pass.
+// After a depth prepass the GL_EQUAL lighting pass shades every covered pixel exactly once, so
+// depth samples / shaded samples is the overdraw lighting would have without the prepass.
+// Queries are read back frame_count frames later and dropped if still pending, never stalling.
+class OverdrawCounter {
+  public:
+    enum Pass {
+        kDepthPass,
+        kShadePass,
+    };
+
+    static std::unique_ptr<OverdrawCounter> Create(int frame_count = 3);
+    ~OverdrawCounter();
+
+    void BeginFrame();
+    void Begin(Pass pass);
+    void End();
+
+    // prepass when the measured overdraw is high, with some hysteresis. The ratio is only
+    // measured on frames with a prepass, so a stale one asks for a prepass to re-measure
+    bool ShouldPrepass();
+
+    // depth / shaded samples of the last measured frame, 0 before the first one
+    inline float ratio() const { return ratio_; }
+    inline uint64_t depth_samples() const { return samples_[kDepthPass]; }
+    inline uint64_t shaded_samples() const { return samples_[kShadePass]; }
+
+  private:
+    struct Frame {
+        uint32_t queries[2]{0, 0};
+        bool issued[2]{false, false};
+    };
+
+    OverdrawCounter();
+    void Init(int frame_count);
+
+    std::vector<Frame> frames_;
+    int frame_index_{0};
+    int active_{-1};
+    uint64_t samples_[2]{0, 0};
+    float ratio_{0.0f};
+    int frames_since_ratio_{0};
+    bool prepass_{true};
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+
+std::unique_ptr<Profiler> Profiler::Create(int frame_count) {
+    auto profiler = std::unique_ptr<Profiler>(new Profiler());
+    profiler->Init(frame_count);
+
+    return std::move(profiler);
+}
+
+Profiler::~Profiler() {
+    for (auto& frame : frames_) {
+        if (!frame.queries.empty()) {
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+        }
+    }
+}
+
+void Profiler::Init(int frame_count) {
+    start_ = Clock::now();
+    frames_.resize(std::max(frame_count, 2));
+}
+
+double Profiler::Now() const {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start_).count();
+}
+
+void Profiler::BeginFrame() {
+    double now = Now();
+    if (frame_index_ >= 0) {
+        auto& last = frames_[frame_index_];
+        while (!open_.empty()) {
+            SPDLOG_ERROR("profiler scope \"{}\" is not ended", last.events[open_.back()].name);
+            End();
+        }
+        AddSample(frame_history_, (float)((now - last.cpu_begin_us) / 1000.0), 0.0f);
+        last.pending = true;
+    }
+
+    frame_index_ = (frame_index_ + 1) % (int)frames_.size();
+    auto& frame = frames_[frame_index_];
+    // the oldest frame is due: take its timings or, if the GPU is behind, drop them
+    if (frame.pending && Resolve(frame)) {
+        last_frame_.clear();
+        for (auto& event : frame.events) {
+            float cpu_ms = (float)((event.cpu_end_us - event.cpu_begin_us) / 1000.0);
+            float gpu_ms = (float)((event.gpu_ns[1] - event.gpu_ns[0]) / 1e6);
+            last_frame_.push_back(Timing{event.name, event.depth, cpu_ms, gpu_ms});
+            AddSample(histories_[event.name], cpu_ms, gpu_ms);
+        }
+        ++resolved_frame_count_;
+        // copied over the oldest one, which reuses its memory
+        if (trace_.size() < kTraceFrames) {
+            trace_.push_back(frame);
+        } else {
+            trace_[trace_next_] = frame;
+            trace_next_ = (trace_next_ + 1) % kTraceFrames;
+        }
+    }
+
+    frame.events.clear();
+    frame.used_queries = 0;
+    frame.pending = false;
+    frame.cpu_begin_us = now;
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    frame.gpu_offset_ns = (int64_t)(now * 1000.0) - gpu_now;
+}
+
+uint32_t Profiler::NextQuery(Frame& frame) {
+    if (frame.used_queries == frame.queries.size()) {
+        uint32_t query = 0;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+
+    return frame.queries[frame.used_queries++];
+}
+
+void Profiler::Begin(const std::string& name) {
+    if (frame_index_ < 0) {
+        return;
+    }
+    auto& frame = frames_[frame_index_];
+    Event event;
+    event.name = name;
+    event.depth = (int)open_.size();
+    event.cpu_begin_us = Now();
+    event.cpu_end_us = event.cpu_begin_us;
+    event.queries[0] = NextQuery(frame);
+    event.queries[1] = NextQuery(frame);
+    event.gpu_ns[0] = event.gpu_ns[1] = 0;
+    glQueryCounter(event.queries[0], GL_TIMESTAMP);
+    open_.push_back(frame.events.size());
+    frame.events.push_back(event);
+}
+
+void Profiler::End() {
+    if (frame_index_ < 0 || open_.empty()) {
+        return;
+    }
+    auto& event = frames_[frame_index_].events[open_.back()];
+    open_.pop_back();
+    glQueryCounter(event.queries[1], GL_TIMESTAMP);
+    event.cpu_end_us = Now();
+}
+
+bool Profiler::Resolve(Frame& frame) {
+    if (frame.events.empty()) {
+        return true;
+    }
+    // queries finish in order, the last one covers the frame
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(frame.queries[frame.used_queries - 1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+        return false;
+    }
+    for (auto& event : frame.events) {
+        for (int i = 0; i < 2; ++i) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(event.queries[i], GL_QUERY_RESULT, &ns);
+            event.gpu_ns[i] = ns;
+        }
+    }
+
+    return true;
+}
+
+void Profiler::AddSample(History& history, float cpu_ms, float gpu_ms) {
+    if (history.cpu_ms.size() < kHistorySize) {
+        history.cpu_ms.push_back(cpu_ms);
+        history.gpu_ms.push_back(gpu_ms);
+        return;
+    }
+    history.cpu_ms[history.next] = cpu_ms;
+    history.gpu_ms[history.next] = gpu_ms;
+    history.next = (history.next + 1) % kHistorySize;
+}
+
+Profiler::Summary Profiler::Summarize(const std::vector<float>& samples, FrameArena* scratch) {
+    Summary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::vector<float> copy;
+    float* sorted = nullptr;
+    if (scratch) {
+        sorted = scratch->Allocate<float>(samples.size());
+        std::copy(samples.begin(), samples.end(), sorted);
+    } else {
+        copy = samples;
+        sorted = copy.data();
+    }
+    size_t count = samples.size();
+    std::sort(sorted, sorted + count);
+    summary.min = sorted[0];
+    for (size_t i = 0; i < count; ++i) {
+        summary.avg += sorted[i];
+    }
+    summary.avg /= count;
+    summary.p99 = sorted[std::min(count - 1, (count * 99 + 99) / 100 - 1)];
+
+    return summary;
+}
+
+const Profiler::History* Profiler::history(const std::string& name) const {
+    auto it = histories_.find(name);
+
+    return it == histories_.end() ? nullptr : &it->second;
+}
+
+// chrome://tracing / Perfetto: CPU scopes on thread 0, GPU scopes on thread 1
+bool Profiler::ExportChromeTrace(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,"
+           "\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,"
+           "\"args\":{\"name\":\"GPU\"}}";
+    char line[512];
+    for (size_t i = 0; i < trace_.size(); ++i) {
+        const Frame& frame = trace_[(trace_next_ + i) % trace_.size()];
+        for (const auto& event : frame.events) {
+            double gpu_begin_us = ((int64_t)event.gpu_ns[0] + frame.gpu_offset_ns) / 1000.0;
+            double gpu_us = (event.gpu_ns[1] - event.gpu_ns[0]) / 1000.0;
+            snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,"
+                     "\"dur\":%.3f}"
+                     ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":%.3f,"
+                     "\"dur\":%.3f}",
+                     event.name.c_str(), event.cpu_begin_us,
+                     event.cpu_end_us - event.cpu_begin_us, event.name.c_str(), gpu_begin_us,
+                     gpu_us);
+            out << line;
+        }
+    }
+    out << "\n]}\n";
+
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef INCLUDED_PROFILER_HPP
+#define INCLUDED_PROFILER_HPP
+
+#include "common.hpp"
+#include "frame_arena.hpp"
+#include <chrono>
+#include <map>
+
+// CPU and GPU time of named, nestable scopes. Every scope brackets its commands with two
+// GL_TIMESTAMP queries; they are read back frame_count frames later and the frame is dropped
+// when they are still pending, so profiling never stalls the pipeline. Resolved frames feed a
+// rolling history per scope name and a short trace that exports as Chrome trace JSON.
+class Profiler {
+  public:
+    static const int kHistorySize = 240;
+    static const int kTraceFrames = 120;
+
+    struct Summary {
+        float min{0.0f};
+        float avg{0.0f};
+        float p99{0.0f};
+    };
+
+    struct History {
+        std::vector<float> cpu_ms;
+        std::vector<float> gpu_ms;
+        size_t next{0}; // oldest sample once full
+
+        Summary cpu(FrameArena* scratch = nullptr) const { return Summarize(cpu_ms, scratch); }
+        Summary gpu(FrameArena* scratch = nullptr) const { return Summarize(gpu_ms, scratch); }
+    };
+
+    // one scope of a resolved frame
+    struct Timing {
+        std::string name;
+        int depth;
+        float cpu_ms;
+        float gpu_ms;
+    };
+
+    class Scope {
+      public:
+        Scope(Profiler* profiler, const std::string& name) : profiler_(profiler) {
+            profiler_->Begin(name);
+        }
+        ~Scope() { profiler_->End(); }
+
+      private:
+        Profiler* profiler_;
+    };
+
+    static std::unique_ptr<Profiler> Create(int frame_count = 4);
+    // sorts a copy of the samples, in the scratch arena when there is one
+    static Summary Summarize(const std::vector<float>& samples, FrameArena* scratch = nullptr);
+    ~Profiler();
+
+    // closes the frame before it, everything until the next BeginFrame is one frame
+    void BeginFrame();
+    void Begin(const std::string& name);
+    void End();
+
+    // scopes of the last resolved frame, in the order they began
+    inline const std::vector<Timing>& last_frame() const { return last_frame_; }
+    // grows whenever last_frame changes
+    inline uint64_t resolved_frame_count() const { return resolved_frame_count_; }
+    const History* history(const std::string& name) const;
+    // BeginFrame to BeginFrame, resolved right away
+    inline const History& frame_history() const { return frame_history_; }
+    bool ExportChromeTrace(const std::string& filename) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::string name;
+        int depth;
+        double cpu_begin_us;
+        double cpu_end_us;
+        uint32_t queries[2];
+        uint64_t gpu_ns[2];
+    };
+
+    struct Frame {
+        std::vector<Event> events;
+        std::vector<uint32_t> queries; // pool, grows to the most scopes a frame had
+        size_t used_queries{0};
+        double cpu_begin_us{0.0};
+        int64_t gpu_offset_ns{0}; // cpu time - gpu time, to place GPU events on the CPU clock
+        bool pending{false};
+    };
+
+    Profiler() {}
+    void Init(int frame_count);
+    double Now() const;
+    uint32_t NextQuery(Frame& frame);
+    // false when the queries of the frame are not available yet
+    bool Resolve(Frame& frame);
+    static void AddSample(History& history, float cpu_ms, float gpu_ms);
+
+    Clock::time_point start_;
+    std::vector<Frame> frames_;
+    int frame_index_{-1};
+    std::vector<size_t> open_;
+    std::map<std::string, History> histories_;
+    History frame_history_;
+    std::vector<Timing> last_frame_;
+    uint64_t resolved_frame_count_{0};
+    std::vector<Frame> trace_; // ring of kTraceFrames
+    size_t trace_next_{0};     // oldest frame once full
+};
+
+#endif
@@ -4,6 +4,7 @@ Program::Program() {}
 
 Program::~Program() {
     if (id_) {
+        GlState::Get().ForgetProgram(id_);
         glDeleteProgram(id_);
     }
 }
@@ -34,6 +35,43 @@ std::unique_ptr<Program> Program::Create(const std::string& vs_filename,
     return Create(shaders);
 }
 
+std::unique_ptr<Program> Program::CreateCompute(const std::string& cs_filename) {
+    std::shared_ptr<Shader> cs = Shader::CreateFromFile(cs_filename, GL_COMPUTE_SHADER);
+    if (!cs) {
+        return nullptr;
+    }
+
+    return Create({cs});
+}
+
+std::unique_ptr<Program> Program::CreateFromFiles(const std::vector<std::string>& filenames) {
+    std::vector<std::shared_ptr<Shader>> shaders;
+    for (const auto& filename : filenames) {
+        std::string extension =
+            filename.size() > 3 ? filename.substr(filename.size() - 3) : std::string();
+        GLenum shader_type = GL_NONE;
+        if (extension == ".vs") {
+            shader_type = GL_VERTEX_SHADER;
+        } else if (extension == ".gs") {
+            shader_type = GL_GEOMETRY_SHADER;
+        } else if (extension == ".fs") {
+            shader_type = GL_FRAGMENT_SHADER;
+        } else if (extension == ".cs") {
+            shader_type = GL_COMPUTE_SHADER;
+        } else {
+            SPDLOG_ERROR("unknown shader stage of {}", filename);
+            return nullptr;
+        }
+        auto shader = Shader::CreateFromFile(filename, shader_type);
+        if (!shader) {
+            return nullptr;
+        }
+        shaders.push_back(shader);
+    }
+
+    return Create(shaders);
+}
+
 bool Program::Link(const std::vector<std::shared_ptr<Shader>>& shaders) {
     id_ = glCreateProgram();
     for (auto& shader : shaders) {
@@ -53,41 +91,54 @@ bool Program::Link(const std::vector<std::shared_ptr<Shader>>& shaders) {
     return success;
 }
 
-uint32_t Program::GetUniformLocation(const std::string& name) const {
-    return glGetUniformLocation(id_, name.c_str());
+uint32_t Program::GetUniformLocation(const char* name) const {
+    return glGetUniformLocation(id_, name);
 }
 
-void Program::SetUniform(const std::string& name, int value) const {
+void Program::SetUniform(const char* name, int value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniform1i(loc, value);
 }
 
-void Program::SetUniform(const std::string& name, float value) const {
+void Program::SetUniform(const char* name, float value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniform1f(loc, value);
 }
 
-void Program::SetUniform(const std::string& name, const glm::vec2& value) const {
+void Program::SetUniform(const char* name, const glm::vec2& value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniform2fv(loc, 1, glm::value_ptr(value));
 }
 
-void Program::SetUniform(const std::string& name, const glm::vec3& value) const {
+void Program::SetUniform(const char* name, const glm::vec3& value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniform3fv(loc, 1, glm::value_ptr(value));
 }
 
-void Program::SetUniform(const std::string& name, const glm::vec4& value) const {
+void Program::SetUniform(const char* name, const glm::vec4& value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniform4fv(loc, 1, glm::value_ptr(value));
 }
 
-void Program::SetUniform(const std::string& name, const glm::mat4& value) const {
+void Program::SetUniform(const char* name, const glm::mat4& value) const {
     uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
     glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-void Program::SetUniform(const std::string& name, const std::vector<glm::mat4>& value) const {
+void Program::SetUniform(const char* name, const glm::mat4* value, size_t count) const {
+    uint32_t loc = GetUniformLocation(name);
+    GlState::Get().CountUniform();
+    glUniformMatrix4fv(loc, (GLsizei)count, GL_FALSE, glm::value_ptr(*value));
+}
+
+void Program::SetUniform(const char* name, const glm::vec4* value, size_t count) const {
     uint32_t loc = GetUniformLocation(name);
-    glUniformMatrix4fv(loc, value.size(), GL_FALSE, glm::value_ptr(*(value.data())));
+    GlState::Get().CountUniform();
+    glUniform4fv(loc, (GLsizei)count, glm::value_ptr(*value));
 }
@@ -2,6 +2,7 @@
 #define INCLUDED_PROGRAM_HPP
 
 #include "common.hpp"
+#include "gl_state.hpp"
 #include "shader.hpp"
 
 class Program {
@@ -10,20 +11,25 @@ class Program {
     static std::unique_ptr<Program> Create(const std::string& vs_filename,
                                            const std::string& fs_filename,
                                            const std::string& gs_filename = "");
+    static std::unique_ptr<Program> CreateCompute(const std::string& cs_filename);
+    // stage by extension (.vs, .gs, .fs, .cs), several files of a stage link into one, e.g. a
+    // fragment shader and the one defining the functions it declares
+    static std::unique_ptr<Program> CreateFromFiles(const std::vector<std::string>& filenames);
     ~Program();
 
-    inline void Use() const { glUseProgram(id_); }
+    inline void Use() const { GlState::Get().UseProgram(id_); }
 
     inline const uint32_t id() const { return id_; }
 
-    uint32_t GetUniformLocation(const std::string& name) const;
-    void SetUniform(const std::string& name, int value) const;
-    void SetUniform(const std::string& name, float value) const;
-    void SetUniform(const std::string& name, const glm::vec2& value) const;
-    void SetUniform(const std::string& name, const glm::vec3& value) const;
-    void SetUniform(const std::string& name, const glm::vec4& value) const;
-    void SetUniform(const std::string& name, const glm::mat4& value) const;
-    void SetUniform(const std::string& name, const std::vector<glm::mat4>& value) const;
+    uint32_t GetUniformLocation(const char* name) const;
+    void SetUniform(const char* name, int value) const;
+    void SetUniform(const char* name, float value) const;
+    void SetUniform(const char* name, const glm::vec2& value) const;
+    void SetUniform(const char* name, const glm::vec3& value) const;
+    void SetUniform(const char* name, const glm::vec4& value) const;
+    void SetUniform(const char* name, const glm::mat4& value) const;
+    void SetUniform(const char* name, const glm::mat4* value, size_t count) const;
+    void SetUniform(const char* name, const glm::vec4* value, size_t count) const;
 
   private:
     Program();
@@ -0,0 +1,97 @@
+#ifndef INCLUDED_RANGE_ALLOCATOR_HPP
+#define INCLUDED_RANGE_ALLOCATOR_HPP
+
+#include "common.hpp"
+
+#include <map>
+
+// Best-fit allocator over [0, capacity) in abstract units (vertices, indices, texels...). Only
+// the bookkeeping lives here; the caller owns the memory. Free ranges are coalesced with their
+// neighbours, so the pool does not fragment under matched Allocate/Free pairs.
+class RangeAllocator {
+  public:
+    static const size_t kInvalid = (size_t)-1;
+
+    RangeAllocator(size_t capacity = 0) { Grow(capacity); }
+
+    size_t Allocate(size_t size) {
+        if (size == 0) {
+            return kInvalid;
+        }
+        auto it = by_size_.lower_bound(size);
+        if (it == by_size_.end()) {
+            return kInvalid;
+        }
+        size_t offset = it->second;
+        size_t free_size = it->first;
+        by_size_.erase(it);
+        by_offset_.erase(offset);
+        if (free_size > size) {
+            Insert(offset + size, free_size - size);
+        }
+        used_ += size;
+
+        return offset;
+    }
+
+    void Free(size_t offset, size_t size) {
+        if (offset == kInvalid || size == 0) {
+            return;
+        }
+        used_ -= size;
+        auto next = by_offset_.lower_bound(offset);
+        if (next != by_offset_.end() && offset + size == next->first) {
+            size += next->second;
+            Erase(next);
+        }
+        auto prev = by_offset_.lower_bound(offset);
+        if (prev != by_offset_.begin()) {
+            --prev;
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                Erase(prev);
+            }
+        }
+        Insert(offset, size);
+    }
+
+    // appends [capacity, new_capacity) to the free space
+    void Grow(size_t new_capacity) {
+        if (new_capacity <= capacity_) {
+            return;
+        }
+        size_t old_capacity = capacity_;
+        capacity_ = new_capacity;
+        used_ += new_capacity - old_capacity;
+        Free(old_capacity, new_capacity - old_capacity);
+    }
+
+    inline size_t capacity() const { return capacity_; }
+    inline size_t used() const { return used_; }
+    inline size_t free_range_count() const { return by_offset_.size(); }
+
+  private:
+    void Insert(size_t offset, size_t size) {
+        by_offset_[offset] = size;
+        by_size_.emplace(size, offset);
+    }
+
+    void Erase(std::map<size_t, size_t>::iterator it) {
+        auto range = by_size_.equal_range(it->second);
+        for (auto s = range.first; s != range.second; ++s) {
+            if (s->second == it->first) {
+                by_size_.erase(s);
+                break;
+            }
+        }
+        by_offset_.erase(it);
+    }
+
+    size_t capacity_{0};
+    size_t used_{0};
+    std::map<size_t, size_t> by_offset_;
+    std::multimap<size_t, size_t> by_size_;
+};
+
+#endif
@@ -0,0 +1,291 @@
+#include "scene_file.hpp"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[4] = {'L', 'G', 'S', 'C'};
+// reads back as this only where the file and the host agree on the byte order
+const uint32_t kByteOrder = 0x01020304;
+const size_t kAlignment = 16;
+
+enum SectionIndex {
+    kStrings,
+    kMaterials,
+    kMeshes,
+    kObjects,
+    kLights,
+    kPointLights,
+    kSectionCount,
+};
+
+struct Section {
+    uint64_t offset;
+    uint64_t size;   // bytes
+    uint32_t count;  // records
+    uint32_t stride; // record size, 1 for the strings
+};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t section_count;
+    Section sections[kSectionCount];
+};
+
+// the records are the file, they must not depend on the compiler
+static_assert(sizeof(Section) == 24, "scene file layout");
+static_assert(sizeof(Header) == 16 + 24 * kSectionCount, "scene file layout");
+static_assert(sizeof(SceneFile::Material) == 8, "scene file layout");
+static_assert(sizeof(SceneFile::Mesh) == 8, "scene file layout");
+static_assert(sizeof(SceneFile::Object) == 48, "scene file layout");
+static_assert(sizeof(SceneFile::Light) == 52, "scene file layout");
+static_assert(sizeof(SceneFile::PointLight) == 32, "scene file layout");
+
+size_t Padded(size_t size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+
+std::string JsonFloats(const float* values, size_t count) {
+    std::string text = "[";
+    char number[32];
+    for (size_t i = 0; i < count; ++i) {
+        snprintf(number, sizeof(number), "%s%g", i ? ", " : "", values[i]);
+        text += number;
+    }
+
+    return text + "]";
+}
+
+} // namespace
+
+uint32_t SceneFile::Contents::AddString(const std::string& name) {
+    auto offset = (uint32_t)strings.size();
+    strings.append(name.c_str(), name.size() + 1);
+
+    return offset;
+}
+
+std::unique_ptr<SceneFile> SceneFile::Load(const std::string& filename) {
+    auto file = std::unique_ptr<SceneFile>(new SceneFile());
+    if (!file->Init(filename)) {
+        return nullptr;
+    }
+
+    return std::move(file);
+}
+
+SceneFile::~SceneFile() {
+#ifndef _WIN32
+    if (mapped_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+}
+
+bool SceneFile::Map(const std::string& filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        SPDLOG_ERROR("failed to read {}", filename);
+        close(fd);
+        return false;
+    }
+    size_ = (size_t)info.st_size;
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        SPDLOG_ERROR("failed to map {}", filename);
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(data);
+    mapped_ = true;
+#else
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+    size_ = (size_t)in.tellg();
+    buffer_ = std::make_unique<uint8_t[]>(size_);
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(buffer_.get()), size_)) {
+        SPDLOG_ERROR("failed to read {}", filename);
+        return false;
+    }
+    data_ = buffer_.get();
+#endif
+
+    return true;
+}
+
+bool SceneFile::Init(const std::string& filename) {
+    if (!Map(filename)) {
+        return false;
+    }
+    if (size_ < sizeof(Header)) {
+        SPDLOG_ERROR("{} is no scene file", filename);
+        return false;
+    }
+    auto header = reinterpret_cast<const Header*>(data_);
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+        SPDLOG_ERROR("{} is no scene file", filename);
+        return false;
+    }
+    if (header->byte_order != kByteOrder) {
+        SPDLOG_ERROR("{}: scene files are little-endian, this host is not", filename);
+        return false;
+    }
+    if (header->version != kVersion || header->section_count != kSectionCount) {
+        SPDLOG_ERROR("{}: scene file version {} with {} sections, expected {} with {}", filename,
+                     header->version, header->section_count, (uint32_t)kVersion,
+                     (int)kSectionCount);
+        return false;
+    }
+    const char* strings = nullptr;
+    if (!ReadSection("strings", kStrings, &strings, &strings_size_) ||
+        !ReadSection("materials", kMaterials, &materials_, &material_count_) ||
+        !ReadSection("meshes", kMeshes, &meshes_, &mesh_count_) ||
+        !ReadSection("objects", kObjects, &objects_, &object_count_) ||
+        !ReadSection("lights", kLights, &lights_, &light_count_) ||
+        !ReadSection("point lights", kPointLights, &point_lights_, &point_light_count_)) {
+        return false;
+    }
+    strings_ = strings;
+    if (strings_size_ > 0 && strings_[strings_size_ - 1] != '\0') {
+        SPDLOG_ERROR("{}: unterminated strings", filename);
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+bool SceneFile::ReadSection(const char* name, uint32_t section, const T** records,
+                            size_t* count) {
+    const auto& entry = reinterpret_cast<const Header*>(data_)->sections[section];
+    if (entry.stride != sizeof(T) || entry.size != (uint64_t)entry.count * sizeof(T) ||
+        entry.offset % kAlignment != 0 || entry.offset > size_ ||
+        entry.size > size_ - entry.offset) {
+        SPDLOG_ERROR("scene file section {} is broken", name);
+        return false;
+    }
+    *records = reinterpret_cast<const T*>(data_ + entry.offset);
+    *count = entry.count;
+
+    return true;
+}
+
+const char* SceneFile::string(uint32_t offset) const {
+    return offset < strings_size_ ? strings_ + offset : "";
+}
+
+bool SceneFile::Save(const std::string& filename, const Contents& contents) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+
+    Header header{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.section_count = kSectionCount;
+    const void* data[kSectionCount];
+    uint64_t offset = Padded(sizeof(Header));
+    auto add = [&](SectionIndex index, const void* records, size_t count, size_t stride) {
+        header.sections[index] = Section{offset, count * stride, (uint32_t)count, (uint32_t)stride};
+        data[index] = records;
+        offset = Padded(offset + count * stride);
+    };
+    add(kStrings, contents.strings.data(), contents.strings.size(), 1);
+    add(kMaterials, contents.materials.data(), contents.materials.size(), sizeof(Material));
+    add(kMeshes, contents.meshes.data(), contents.meshes.size(), sizeof(Mesh));
+    add(kObjects, contents.objects.data(), contents.objects.size(), sizeof(Object));
+    add(kLights, contents.lights.data(), contents.lights.size(), sizeof(Light));
+    add(kPointLights, contents.point_lights.data(), contents.point_lights.size(),
+        sizeof(PointLight));
+
+    // written as they are in memory, the hosts that can load the file are little-endian too
+    const char zeros[kAlignment] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(zeros, Padded(sizeof(Header)) - sizeof(Header));
+    for (int i = 0; i < kSectionCount; ++i) {
+        const auto& section = header.sections[i];
+        out.write(static_cast<const char*>(data[i]), (std::streamsize)section.size);
+        out.write(zeros, (std::streamsize)(Padded(section.size) - section.size));
+    }
+    if (!out) {
+        SPDLOG_ERROR("failed to write {}", filename);
+        return false;
+    }
+
+    return true;
+}
+
+bool SceneFile::SaveJson(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", filename);
+        return false;
+    }
+
+    out << "{\n  \"version\": " << kVersion << ",\n  \"materials\": [";
+    for (size_t i = 0; i < material_count_; ++i) {
+        const auto& material = materials_[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << JsonString(string(material.name))
+            << ", \"shininess\": " << material.shininess << "}";
+    }
+    out << "\n  ],\n  \"meshes\": [";
+    for (size_t i = 0; i < mesh_count_; ++i) {
+        const auto& mesh = meshes_[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": " << JsonString(string(mesh.name))
+            << ", \"material\": ";
+        if (mesh.material < material_count_) {
+            out << JsonString(string(materials_[mesh.material].name)) << "}";
+        } else {
+            out << "null}";
+        }
+    }
+    out << "\n  ],\n  \"objects\": [";
+    for (size_t i = 0; i < object_count_; ++i) {
+        const auto& object = objects_[i];
+        out << (i ? ",\n" : "\n") << "    {\"mesh\": "
+            << JsonString(object.mesh < mesh_count_ ? string(meshes_[object.mesh].name) : "")
+            << ", \"translate\": " << JsonFloats(object.translate, 3)
+            << ", \"rotate\": " << JsonFloats(object.rotate, 4)
+            << ", \"scale\": " << JsonFloats(object.scale, 3)
+            << ", \"bounding_radius\": " << object.bounding_radius << "}";
+    }
+    out << "\n  ],\n  \"lights\": [";
+    for (size_t i = 0; i < light_count_; ++i) {
+        const auto& light = lights_[i];
+        out << (i ? ",\n" : "\n") << "    {\"object\": " << light.object
+            << ", \"type\": " << light.type << ", \"ambient\": " << JsonFloats(light.ambient, 3)
+            << ", \"diffuse\": " << JsonFloats(light.diffuse, 3)
+            << ", \"specular\": " << JsonFloats(light.specular, 3)
+            << ", \"cutoff\": " << JsonFloats(light.cutoff, 2) << "}";
+    }
+    out << "\n  ],\n  \"point_lights\": [";
+    for (size_t i = 0; i < point_light_count_; ++i) {
+        const auto& light = point_lights_[i];
+        out << (i ? ",\n" : "\n") << "    {\"position_radius\": "
+            << JsonFloats(light.position_radius, 4)
+            << ", \"color\": " << JsonFloats(light.color, 4) << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    return true;
+}
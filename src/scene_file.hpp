@@ -0,0 +1,111 @@
+#ifndef INCLUDED_SCENE_FILE_HPP
+#define INCLUDED_SCENE_FILE_HPP
+
+#include "common.hpp"
+
+// Binary scene: a header, then one array of fixed-size little-endian records per section, each
+// 16-byte aligned in the file. Load maps the file and only checks the header and the section
+// bounds, the records are used where they lie, so loading costs what reading the pages does.
+//
+// Meshes and materials are referenced by name, the strings section holds the names back to back,
+// terminated. Whoever instantiates the scene resolves them to its own meshes and materials.
+class SceneFile {
+  public:
+    static const uint32_t kVersion = 1;
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Material {
+        uint32_t name; // offset into the strings
+        float shininess;
+    };
+
+    struct Mesh {
+        uint32_t name;
+        uint32_t material; // index, kNone: the mesh's own
+    };
+
+    struct Object {
+        float translate[3];
+        float rotate[4]; // quaternion x, y, z, w
+        float scale[3];
+        float bounding_radius; // 0: not pickable
+        uint32_t mesh;         // index
+    };
+
+    struct Light {
+        uint32_t object; // index of the object the light is drawn as
+        uint32_t type;   // LightType
+        float ambient[3];
+        float diffuse[3];
+        float specular[3];
+        float cutoff[2];
+    };
+
+    // deferred point light, the std140 layout of the LightVolumes block
+    struct PointLight {
+        float position_radius[4];
+        float color[4];
+    };
+
+    // what Save writes
+    struct Contents {
+        std::string strings;
+        std::vector<Material> materials;
+        std::vector<Mesh> meshes;
+        std::vector<Object> objects;
+        std::vector<Light> lights;
+        std::vector<PointLight> point_lights;
+
+        // appends name to the strings, the offset for a record
+        uint32_t AddString(const std::string& name);
+    };
+
+    static std::unique_ptr<SceneFile> Load(const std::string& filename);
+    static bool Save(const std::string& filename, const Contents& contents);
+    ~SceneFile();
+
+    // every record spelled out, for diffs and debugging. Never read back
+    bool SaveJson(const std::string& filename) const;
+
+    inline const Material* materials() const { return materials_; }
+    inline size_t material_count() const { return material_count_; }
+    inline const Mesh* meshes() const { return meshes_; }
+    inline size_t mesh_count() const { return mesh_count_; }
+    inline const Object* objects() const { return objects_; }
+    inline size_t object_count() const { return object_count_; }
+    inline const Light* lights() const { return lights_; }
+    inline size_t light_count() const { return light_count_; }
+    inline const PointLight* point_lights() const { return point_lights_; }
+    inline size_t point_light_count() const { return point_light_count_; }
+    // empty for an offset out of the strings
+    const char* string(uint32_t offset) const;
+    inline size_t size() const { return size_; }
+
+  private:
+    SceneFile() {}
+    bool Init(const std::string& filename);
+    bool Map(const std::string& filename);
+
+    template <typename T>
+    bool ReadSection(const char* name, uint32_t section, const T** records, size_t* count);
+
+    const uint8_t* data_{nullptr};
+    size_t size_{0};
+    bool mapped_{false};
+    std::unique_ptr<uint8_t[]> buffer_{nullptr}; // where mmap is missing
+
+    const char* strings_{nullptr};
+    size_t strings_size_{0};
+    const Material* materials_{nullptr};
+    size_t material_count_{0};
+    const Mesh* meshes_{nullptr};
+    size_t mesh_count_{0};
+    const Object* objects_{nullptr};
+    size_t object_count_{0};
+    const Light* lights_{nullptr};
+    size_t light_count_{0};
+    const PointLight* point_lights_{nullptr};
+    size_t point_light_count_{0};
+};
+
+#endif
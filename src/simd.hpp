@@ -0,0 +1,117 @@
+#ifndef INCLUDED_SIMD_HPP
+#define INCLUDED_SIMD_HPP
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// four floats processed in lock step. masks returned by comparisons are only meant for Select()
+// and Any(); on SSE2 they are bit masks, on the scalar fallback they are 0.0f / 1.0f.
+struct Float4 {
+#ifdef SIMD_SSE2
+    __m128 v;
+
+    Float4() : v(_mm_setzero_ps()) {}
+    Float4(__m128 value) : v(value) {}
+    explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+    static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+#else
+    float v[4];
+
+    Float4() : v{0.0f, 0.0f, 0.0f, 0.0f} {}
+    explicit Float4(float s) : v{s, s, s, s} {}
+    static Float4 Load(const float* p) {
+        Float4 r;
+        for (int i = 0; i < 4; ++i) {
+            r.v[i] = p[i];
+        }
+        return r;
+    }
+    void Store(float* p) const {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = v[i];
+        }
+    }
+#endif
+};
+
+#ifdef SIMD_SSE2
+inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+inline Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+inline Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+inline Float4 Greater(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 Select(Float4 mask, Float4 a, Float4 b) {
+    return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+inline bool Any(Float4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+#else
+#define SIMD_SCALAR_OP(expr)                                                                       \
+    Float4 r;                                                                                      \
+    for (int i = 0; i < 4; ++i) {                                                                  \
+        r.v[i] = (expr);                                                                           \
+    }                                                                                              \
+    return r;
+inline Float4 operator+(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] + b.v[i]) }
+inline Float4 operator-(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] - b.v[i]) }
+inline Float4 operator*(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] * b.v[i]) }
+inline Float4 operator/(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] / b.v[i]) }
+inline Float4 Sqrt(Float4 a) { SIMD_SCALAR_OP(sqrtf(a.v[i])) }
+inline Float4 Min(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline Float4 Max(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+inline Float4 Greater(Float4 a, Float4 b) { SIMD_SCALAR_OP(a.v[i] > b.v[i] ? 1.0f : 0.0f) }
+inline Float4 Select(Float4 mask, Float4 a, Float4 b) {
+    SIMD_SCALAR_OP(mask.v[i] != 0.0f ? a.v[i] : b.v[i])
+}
+inline bool Any(Float4 mask) {
+    return mask.v[0] != 0.0f || mask.v[1] != 0.0f || mask.v[2] != 0.0f || mask.v[3] != 0.0f;
+}
+#undef SIMD_SCALAR_OP
+#endif
+
+inline Float4 Abs(Float4 a) { return Max(a, Float4(0.0f) - a); }
+
+// acos with ~7e-5 rad max error (Abramowitz & Stegun 4.4.45)
+inline Float4 Acos(Float4 x) {
+    Float4 ax = Min(Abs(x), Float4(1.0f));
+    Float4 poly = Float4(-0.0187293f);
+    poly = poly * ax + Float4(0.0742610f);
+    poly = poly * ax - Float4(0.2121144f);
+    poly = poly * ax + Float4(1.5707288f);
+    Float4 r = Sqrt(Float4(1.0f) - ax) * poly;
+    return Select(Greater(Float4(0.0f), x), Float4(3.14159265f) - r, r);
+}
+
+struct Float4x3 {
+    Float4 x;
+    Float4 y;
+    Float4 z;
+};
+
+inline Float4x3 operator+(const Float4x3& a, const Float4x3& b) {
+    return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+inline Float4x3 operator-(const Float4x3& a, const Float4x3& b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+inline Float4x3 operator*(const Float4x3& a, Float4 s) { return {a.x * s, a.y * s, a.z * s}; }
+inline Float4 Dot(const Float4x3& a, const Float4x3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// zero-length inputs normalize to zero instead of producing NaN
+inline Float4x3 NormalizeOrZero(const Float4x3& a) {
+    Float4 len2 = Dot(a, a);
+    Float4 valid = Greater(len2, Float4(1e-20f));
+    Float4 len = Sqrt(Select(valid, len2, Float4(1.0f)));
+    return a * Select(valid, Float4(1.0f) / len, Float4(0.0f));
+}
+
+#endif
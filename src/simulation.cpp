@@ -0,0 +1,99 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+
+Simulation::Simulation() {}
+
+Simulation::~Simulation() {
+    quit_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::unique_ptr<Simulation> Simulation::Create(const SimulationState& state, float step_seconds) {
+    auto simulation = std::unique_ptr<Simulation>(new Simulation());
+    simulation->Init(state, step_seconds);
+
+    return std::move(simulation);
+}
+
+void Simulation::Init(const SimulationState& state, float step_seconds) {
+    step_seconds_ = step_seconds;
+    initial_ = state;
+    // the thread owns the writer side from here
+    thread_ = std::thread(&Simulation::Loop, this);
+}
+
+void Simulation::SetInput(const SimulationInput& input) {
+    inputs_.back() = input;
+    inputs_.Publish();
+}
+
+SimulationState Simulation::Sample(Clock::time_point now) {
+    snapshots_.Acquire();
+    const Snapshot& snapshot = snapshots_.front();
+    if (snapshot.time == Clock::time_point()) {
+        return initial_;
+    }
+    float t = std::chrono::duration<float>(now - snapshot.time).count() / step_seconds_;
+
+    return Lerp(snapshot.previous, snapshot.current, std::clamp(t, 0.0f, 1.0f));
+}
+
+SimulationState Simulation::Step(const SimulationState& state, const SimulationInput& input,
+                                 float seconds) {
+    Camera camera = input.camera;
+    camera.position_ = state.camera_position;
+    // refreshes front_ from yaw and pitch
+    camera.GetViewMatrix();
+    camera.Move(seconds);
+
+    SimulationState next = state;
+    next.camera_position = camera.position_;
+
+    return next;
+}
+
+SimulationState Simulation::Lerp(const SimulationState& a, const SimulationState& b, float t) {
+    SimulationState state = b;
+    state.camera_position = glm::mix(a.camera_position, b.camera_position, t);
+
+    return state;
+}
+
+void Simulation::Loop() {
+    const auto step = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float>(step_seconds_));
+    // after a stall (a debugger, a hitch of the OS) skip ahead instead of replaying every step
+    const auto max_lag = step * 8;
+
+    SimulationInput input;
+    uint32_t teleport_revision = initial_.teleport_revision;
+    SimulationState previous = initial_;
+    SimulationState current = initial_;
+    auto next = Clock::now();
+    while (!quit_) {
+        if (inputs_.Acquire()) {
+            input = inputs_.front();
+        }
+        if (input.teleport_revision != teleport_revision) {
+            teleport_revision = input.teleport_revision;
+            current.camera_position = input.teleport_position;
+            current.teleport_revision = teleport_revision;
+        }
+        previous = current;
+        current = Step(current, input, step_seconds_);
+        tick_count_.fetch_add(1, std::memory_order_relaxed);
+
+        snapshots_.back() = Snapshot{previous, current, next};
+        snapshots_.Publish();
+
+        next += step;
+        auto now = Clock::now();
+        if (now - next > max_lag) {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
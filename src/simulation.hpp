@@ -0,0 +1,71 @@
+#ifndef INCLUDED_SIMULATION_HPP
+#define INCLUDED_SIMULATION_HPP
+
+#include "camera.hpp"
+#include "common.hpp"
+#include "triple_buffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// what the render thread tells the simulation every frame
+struct SimulationInput {
+    // orientation, speed and move keys; the position is the simulation's
+    Camera camera;
+    // bumped when the render thread placed the camera itself, e.g. from the settings panel
+    uint32_t teleport_revision{0};
+    glm::vec3 teleport_position{0.0f};
+};
+
+struct SimulationState {
+    glm::vec3 camera_position{0.0f};
+    // of the last teleport applied, until it matches the input the state is from before it
+    uint32_t teleport_revision{0};
+};
+
+// Steps the scene at a fixed rate on its own thread, so movement no longer depends on the frame
+// rate and a slow frame does not hold the simulation back. Every step is published through a
+// triple buffer together with the step before it, and Sample blends the two by the time that
+// passed since, which keeps motion smooth at any frame rate one step behind the simulation.
+class Simulation {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static std::unique_ptr<Simulation> Create(const SimulationState& state,
+                                              float step_seconds = 1.0f / 60.0f);
+    ~Simulation();
+
+    // render thread only
+    void SetInput(const SimulationInput& input);
+    SimulationState Sample(Clock::time_point now);
+
+    inline float step_seconds() const { return step_seconds_; }
+    inline uint64_t tick_count() const { return tick_count_.load(std::memory_order_relaxed); }
+
+    static SimulationState Step(const SimulationState& state, const SimulationInput& input,
+                                float seconds);
+    static SimulationState Lerp(const SimulationState& a, const SimulationState& b, float t);
+
+  private:
+    struct Snapshot {
+        SimulationState previous;
+        SimulationState current;
+        // when `current` is due, Sample reaches it one step later
+        Clock::time_point time;
+    };
+
+    Simulation();
+    void Init(const SimulationState& state, float step_seconds);
+    void Loop();
+
+    float step_seconds_{1.0f / 60.0f};
+    TripleBuffer<SimulationInput> inputs_;
+    TripleBuffer<Snapshot> snapshots_;
+    SimulationState initial_;
+    std::atomic<uint64_t> tick_count_{0};
+    std::atomic<bool> quit_{false};
+    std::thread thread_;
+};
+
+#endif
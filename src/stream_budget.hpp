@@ -0,0 +1,90 @@
+#ifndef INCLUDED_STREAM_BUDGET_HPP
+#define INCLUDED_STREAM_BUDGET_HPP
+
+#include "common.hpp"
+#include "thread_pool.hpp"
+
+// The loads in flight of a streaming cache and the memory budget of what it holds resident. Loads
+// run on the thread pool, at most max_loads at a time, and are taken in at most max_takes per
+// update, so streaming costs a frame about the same however much is missing. Room is made by
+// evicting what the owner calls evictable, least recently used first.
+//
+// T is what streams, its load job signals T::loaded. Belongs to the thread that updates the owner.
+template <typename T> class StreamBudget {
+  public:
+    StreamBudget() {}
+    StreamBudget(size_t budget_bytes, int max_loads, int max_takes)
+        : budget_bytes_(budget_bytes), max_loads_(max_loads), max_takes_(max_takes) {}
+
+    // the owner calls it before what the jobs write into goes away
+    void WaitLoads() {
+        for (T* item : loading_) {
+            ThreadPool::Default()->Wait(&item->loaded);
+        }
+    }
+
+    inline bool can_load() const { return (int)loading_.size() < max_loads_; }
+    // item->loaded counts the load job just submitted
+    void Loading(T* item) {
+        loading_.push_back(item);
+        ++loads_;
+    }
+    // take(item) for up to max_takes finished loads
+    template <typename F> void TakeFinished(F&& take) {
+        int taken = 0;
+        for (size_t i = 0; i < loading_.size() && taken < max_takes_;) {
+            T* item = loading_[i];
+            if (!item->loaded.done()) {
+                ++i;
+                continue;
+            }
+            ThreadPool::Default()->Wait(&item->loaded);
+            loading_[i] = loading_.back();
+            loading_.pop_back();
+            take(item);
+            ++taken;
+        }
+    }
+
+    // evicts candidates, smallest last_used(item) of the evictable(item) first, until bytes more
+    // fit into the budget. evict(item) returns the bytes it freed. false when they do not fit
+    template <typename Candidates, typename Evictable, typename LastUsed, typename Evict>
+    bool MakeRoom(size_t bytes, const Candidates& candidates, Evictable&& evictable,
+                  LastUsed&& last_used, Evict&& evict) {
+        while (resident_bytes_ + bytes > budget_bytes_) {
+            T* oldest = nullptr;
+            for (const auto& candidate : candidates) {
+                T* item = &*candidate;
+                if (evictable(*item) && (!oldest || last_used(*item) < last_used(*oldest))) {
+                    oldest = item;
+                }
+            }
+            if (!oldest) {
+                return false;
+            }
+            resident_bytes_ -= evict(oldest);
+            ++evictions_;
+        }
+
+        return true;
+    }
+
+    inline void Add(size_t bytes) { resident_bytes_ += bytes; }
+    inline void Remove(size_t bytes) { resident_bytes_ -= bytes; }
+
+    inline size_t resident_bytes() const { return resident_bytes_; }
+    inline size_t loading() const { return loading_.size(); }
+    inline size_t loads() const { return loads_; }         // in total
+    inline size_t evictions() const { return evictions_; } // in total
+
+  private:
+    size_t budget_bytes_{0};
+    int max_loads_{0};
+    int max_takes_{0};
+    std::vector<T*> loading_;
+    size_t resident_bytes_{0};
+    size_t loads_{0};
+    size_t evictions_{0};
+};
+
+#endif
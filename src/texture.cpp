@@ -43,10 +43,28 @@ std::unique_ptr<Texture2d> Texture2d::Create(int width, int height, uint32_t inn
     return std::move(texture);
 }
 
+std::unique_ptr<Texture2d> Texture2d::CreateStorage(int width, int height, int level_count,
+                                                    uint32_t inner_format) {
+    auto texture = std::unique_ptr<Texture2d>(new Texture2d());
+    texture->width_ = width;
+    texture->height_ = height;
+    texture->inner_format_ = inner_format;
+    texture->level_count_ = level_count;
+    texture->immutable_ = true;
+    texture->Bind();
+    texture->SetFilter(level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+    texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    glTexStorage2D(GL_TEXTURE_2D, level_count, inner_format, width, height);
+
+    return std::move(texture);
+}
+
 void Texture2d::SetTextureFromImage(const Image* image) {
     width_ = image->width();
     height_ = image->height();
     format_ = ChannelCountToRGBAFormat(image->channel_count());
+    // sized, glCopyImageSubData into the texture arrays of the material table rejects GL_RGBA
+    inner_format_ = GL_RGBA8;
 
     glTexImage2D(GL_TEXTURE_2D, 0, inner_format_, width_, height_, 0, format_, type_,
                  image->data());
@@ -109,6 +127,19 @@ std::array<uint8_t, 4> Texture2d::GetTexPixel(int x, int y) const {
     return {pixel[0], pixel[1], pixel[2], pixel[3]};
 }
 
+void Texture2d::Swap(Texture2d* other) {
+    std::swap(id_, other->id_);
+    std::swap(width_, other->width_);
+    std::swap(height_, other->height_);
+    std::swap(inner_format_, other->inner_format_);
+    std::swap(format_, other->format_);
+    std::swap(type_, other->type_);
+    std::swap(level_count_, other->level_count_);
+    std::swap(immutable_, other->immutable_);
+    ++revision_;
+    ++other->revision_;
+}
+
 /*
  * CubeTexture
  */
@@ -174,4 +205,49 @@ void Texture3d::SetCubeMapFormat(int width, int height, int length, uint32_t for
                  NULL);
     glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, format_, length_, width_, 0, format_, type_,
                  NULL);
+}
+
+/*
+ * Texture2dArray
+ */
+
+Texture2dArray::Texture2dArray() : BaseTexture(GL_TEXTURE_2D_ARRAY) {}
+
+Texture2dArray::~Texture2dArray() {}
+
+std::unique_ptr<Texture2dArray> Texture2dArray::Create(int width, int height, int layer_count,
+                                                       int level_count, uint32_t inner_format) {
+    auto texture = std::unique_ptr<Texture2dArray>(new Texture2dArray());
+    texture->width_ = width;
+    texture->height_ = height;
+    texture->layer_count_ = layer_count;
+    texture->level_count_ = level_count;
+    texture->inner_format_ = inner_format;
+    texture->Bind();
+    texture->SetFilter(level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+    texture->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, level_count, inner_format, width, height, layer_count);
+
+    return std::move(texture);
+}
+
+std::unique_ptr<Texture2dArray> Texture2dArray::CreateView(const Texture2d* texture) {
+    if (!texture->immutable()) {
+        SPDLOG_ERROR("texture views need immutable storage");
+        return nullptr;
+    }
+    auto view = std::unique_ptr<Texture2dArray>(new Texture2dArray());
+    view->width_ = texture->width();
+    view->height_ = texture->height();
+    view->layer_count_ = 1;
+    view->level_count_ = texture->level_count();
+    view->inner_format_ = texture->inner_format();
+    // before the first bind, a bound name cannot become a view
+    glTextureView(view->id(), GL_TEXTURE_2D_ARRAY, texture->id(), view->inner_format_, 0,
+                  view->level_count_, 0, 1);
+    view->Bind();
+    view->SetFilter(view->level_count_ > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR, GL_LINEAR);
+    view->SetWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+
+    return std::move(view);
 }
\ No newline at end of file
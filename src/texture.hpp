@@ -1,17 +1,20 @@
 #ifndef INCLUDED_TEXTURE_HPP
 #define INCLUDED_TEXTURE_HPP
 
+#include "gl_state.hpp"
 #include "image.hpp"
+
 class BaseTexture {
   public:
     BaseTexture(uint32_t texture_type) : texture_type_(texture_type) { glGenTextures(1, &id_); }
     virtual ~BaseTexture() {
         if (id_) {
+            GlState::Get().ForgetTexture(id_);
             glDeleteTextures(1, &id_);
         }
     }
 
-    virtual inline void Bind() const final { glBindTexture(texture_type_, id_); };
+    virtual inline void Bind() const final { GlState::Get().BindTexture(texture_type_, id_); };
 
     virtual void SetFilter(uint32_t min_filter, uint32_t mag_filter) const final {
         glTexParameteri(texture_type_, GL_TEXTURE_MIN_FILTER, min_filter);
@@ -82,6 +85,9 @@ class Texture2d : public BaseTexture {
     static std::unique_ptr<Texture2d> Create(int width, int height, uint32_t inner_format = GL_RGBA,
                                              uint32_t format = GL_RGBA,
                                              uint32_t type = GL_UNSIGNED_BYTE);
+    // immutable storage of level_count levels, which texture views need
+    static std::unique_ptr<Texture2d> CreateStorage(int width, int height, int level_count,
+                                                    uint32_t inner_format = GL_RGBA8);
     ~Texture2d();
 
     bool SaveAsPng(const std::string& filename) const;
@@ -91,12 +97,19 @@ class Texture2d : public BaseTexture {
     void SetBorderColor(const glm::vec4& color) const;
     unsigned char* GetTexImage() const;
     std::array<uint8_t, 4> GetTexPixel(int x, int y) const;
+    // trades storage with other, e.g. for a copy of another size, and bumps both revisions
+    void Swap(Texture2d* other);
 
     inline int width() const { return width_; }
     inline int height() const { return height_; }
     inline uint32_t inner_format() const { return inner_format_; }
     inline uint32_t format() const { return format_; }
     inline uint32_t type() const { return type_; }
+    // of immutable storage, 1 otherwise
+    inline int level_count() const { return level_count_; }
+    inline bool immutable() const { return immutable_; }
+    // bumped by Swap, so copies of the texture know when to copy again
+    inline uint32_t revision() const { return revision_; }
 
   private:
     Texture2d();
@@ -108,6 +121,9 @@ class Texture2d : public BaseTexture {
     uint32_t inner_format_{GL_RGBA};
     uint32_t format_{GL_RGBA};
     uint32_t type_{GL_UNSIGNED_BYTE};
+    int level_count_{1};
+    bool immutable_{false};
+    uint32_t revision_{0};
 };
 
 class Texture3d : public BaseTexture {
@@ -136,4 +152,29 @@ class Texture3d : public BaseTexture {
     uint32_t format_{0};
 };
 
+// immutable storage, needs GL 4.2
+class Texture2dArray : public BaseTexture {
+  public:
+    static std::unique_ptr<Texture2dArray> Create(int width, int height, int layer_count,
+                                                  int level_count, uint32_t inner_format);
+    // one layer sharing the storage of texture, every level of it. null unless it is immutable
+    static std::unique_ptr<Texture2dArray> CreateView(const Texture2d* texture);
+    ~Texture2dArray();
+
+    inline int width() const { return width_; }
+    inline int height() const { return height_; }
+    inline int layer_count() const { return layer_count_; }
+    inline int level_count() const { return level_count_; }
+    inline uint32_t inner_format() const { return inner_format_; }
+
+  private:
+    Texture2dArray();
+
+    int width_{0};
+    int height_{0};
+    int layer_count_{0};
+    int level_count_{1};
+    uint32_t inner_format_{GL_RGBA8};
+};
+
 #endif
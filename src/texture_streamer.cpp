@@ -0,0 +1,458 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+
+namespace {
+
+const char kMagic[4] = {'L', 'G', 'M', 'P'};
+const uint32_t kVersion = 1;
+// the levels are raw RGBA8 but the header is not, a file baked on a host of the other byte order
+// fails ReadHeader and is baked again
+const uint32_t kByteOrder = 0x01020304;
+
+struct MipHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint32_t reserved[2];
+};
+
+static_assert(sizeof(MipHeader) == 32, "mip file layout");
+
+int LevelCount(int width, int height) {
+    int level_count = 1;
+    while ((std::max(width, height) >> level_count) > 0) {
+        ++level_count;
+    }
+
+    return level_count;
+}
+
+size_t LevelSize(int width, int height, int level) {
+    return (size_t)std::max(width >> level, 1) * std::max(height >> level, 1) * 4;
+}
+
+// a mip file of this version with every level in it
+bool ReadHeader(const std::string& filename, MipHeader* header) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(*header)) ||
+        memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion ||
+        header->byte_order != kByteOrder || header->width == 0 || header->height == 0 ||
+        header->level_count != (uint32_t)LevelCount(header->width, header->height)) {
+        return false;
+    }
+    size_t size = sizeof(MipHeader);
+    for (uint32_t level = 0; level < header->level_count; ++level) {
+        size += LevelSize(header->width, header->height, level);
+    }
+    std::error_code error;
+    return std::filesystem::file_size(filename, error) == size && !error;
+}
+
+// 2x2 box filter like glGenerateMipmap, the last row / column of odd sizes is taken twice
+std::vector<uint8_t> Downsample(const std::vector<uint8_t>& pixels, int width, int height) {
+    int half_width = std::max(width / 2, 1);
+    int half_height = std::max(height / 2, 1);
+    std::vector<uint8_t> half((size_t)half_width * half_height * 4);
+    for (int y = 0; y < half_height; ++y) {
+        const uint8_t* row0 = &pixels[(size_t)std::min(y * 2, height - 1) * width * 4];
+        const uint8_t* row1 = &pixels[(size_t)std::min(y * 2 + 1, height - 1) * width * 4];
+        for (int x = 0; x < half_width; ++x) {
+            size_t x0 = (size_t)std::min(x * 2, width - 1) * 4;
+            size_t x1 = (size_t)std::min(x * 2 + 1, width - 1) * 4;
+            uint8_t* out = &half[((size_t)y * half_width + x) * 4];
+            for (size_t c = 0; c < 4; ++c) {
+                int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                out[c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+
+    return half;
+}
+
+} // namespace
+
+bool TextureStreamer::Bake(const std::string& filename) {
+    std::string mips = filename + ".mips";
+    std::error_code image_error;
+    std::error_code mips_error;
+    auto image_time = std::filesystem::last_write_time(filename, image_error);
+    auto mips_time = std::filesystem::last_write_time(mips, mips_error);
+    MipHeader header;
+    if (!mips_error && (image_error || mips_time >= image_time) && ReadHeader(mips, &header)) {
+        return true;
+    }
+
+    auto image = Image::Load(filename);
+    if (!image) {
+        return false;
+    }
+    // what a Texture2d of the image samples, missing channels are 0 and alpha is 1
+    int width = image->width();
+    int height = image->height();
+    int channel_count = image->channel_count();
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            pixels[i * 4 + c] = c < channel_count ? image->data()[i * channel_count + c]
+                                                  : (c == 3 ? 255 : 0);
+        }
+    }
+    image.reset();
+
+    // written aside and renamed, a mip file is either complete or missing
+    std::string temporary = mips + ".tmp";
+    std::ofstream out(temporary, std::ios::binary);
+    if (!out) {
+        SPDLOG_ERROR("failed to open {}", temporary);
+        return false;
+    }
+    header = MipHeader{};
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.width = width;
+    header.height = height;
+    header.level_count = LevelCount(width, height);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (uint32_t level = 0; level < header.level_count; ++level) {
+        if (level > 0) {
+            pixels = Downsample(pixels, std::max(width >> (level - 1), 1),
+                                std::max(height >> (level - 1), 1));
+        }
+        out.write(reinterpret_cast<const char*>(pixels.data()), (std::streamsize)pixels.size());
+    }
+    out.close();
+    if (!out) {
+        SPDLOG_ERROR("failed to write {}", temporary);
+        return false;
+    }
+    std::filesystem::rename(temporary, mips, mips_error);
+    if (mips_error) {
+        SPDLOG_ERROR("failed to write {}", mips);
+        return false;
+    }
+    SPDLOG_INFO("baked {}: {}x{}, {} levels", mips, width, height, header.level_count);
+
+    return true;
+}
+
+std::unique_ptr<TextureStreamer> TextureStreamer::Create(int width, int height, const Desc& desc) {
+    auto streamer = std::unique_ptr<TextureStreamer>(new TextureStreamer());
+    if (!streamer->Init(width, height, desc)) {
+        return nullptr;
+    }
+
+    return std::move(streamer);
+}
+
+TextureStreamer::~TextureStreamer() {
+    budget_.WaitLoads();
+    for (auto& readback : readbacks_) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+    }
+}
+
+bool TextureStreamer::IsSupported() {
+    return GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_texture_storage && GLAD_GL_ARB_copy_image);
+}
+
+bool TextureStreamer::Init(int width, int height, const Desc& desc) {
+    if (!IsSupported()) {
+        SPDLOG_ERROR("texture streaming needs GL 4.3 or ARB_texture_storage and ARB_copy_image");
+        return false;
+    }
+    desc_ = desc;
+    budget_ = StreamBudget<Record>(desc.budget_bytes, desc.max_loads, desc.max_takes);
+    desc_.feedback_divisor = std::max(desc_.feedback_divisor, 1);
+    desc_.feedback_interval = std::max(desc_.feedback_interval, 1);
+
+    return Resize(width, height);
+}
+
+bool TextureStreamer::Resize(int width, int height) {
+    width_ = width;
+    height_ = height;
+    int feedback_width = std::max(width / desc_.feedback_divisor, 1);
+    int feedback_height = std::max(height / desc_.feedback_divisor, 1);
+    feedback_framebuffer_ = Framebuffer::Create({Texture2d::Create(
+        feedback_width, feedback_height, GL_RGBA16UI, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT)});
+    if (!feedback_framebuffer_) {
+        return false;
+    }
+    // the feedback in flight is of the old size
+    for (auto& readback : readbacks_) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+            readback.fence = nullptr;
+        }
+        readback.buffer = Buffer::Create(GL_PIXEL_PACK_BUFFER, GL_STREAM_READ, nullptr,
+                                         4 * sizeof(uint16_t),
+                                         (size_t)feedback_width * feedback_height);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return true;
+}
+
+std::shared_ptr<Texture2d> TextureStreamer::Add(const std::string& filename) {
+    std::string mips = filename + ".mips";
+    for (const auto& record : records_) {
+        if (record->filename == mips) {
+            return record->texture;
+        }
+    }
+    MipHeader header;
+    if (records_.size() >= kMaxTextures || !Bake(filename) || !ReadHeader(mips, &header)) {
+        SPDLOG_WARN("{} is not streamed", filename);
+        return Texture2d::Create(filename);
+    }
+
+    auto record = std::make_unique<Record>();
+    record->filename = mips;
+    record->width = (int)header.width;
+    record->height = (int)header.height;
+    record->level_count = (int)header.level_count;
+    while (record->tail_level + 1 < record->level_count &&
+           std::max(record->width, record->height) >> record->tail_level > desc_.tail_size) {
+        ++record->tail_level;
+    }
+    record->resident_level = record->level_count;
+    record->wanted_level = record->tail_level;
+    record->log2_size = std::log2((float)std::max(record->width, record->height));
+
+    std::vector<uint8_t> pixels(LevelBytes(*record, record->tail_level, record->level_count));
+    std::ifstream in(mips, std::ios::binary);
+    in.seekg((std::streamoff)(sizeof(MipHeader) + LevelBytes(*record, 0, record->tail_level)));
+    if (!in.read(reinterpret_cast<char*>(pixels.data()), (std::streamsize)pixels.size())) {
+        SPDLOG_ERROR("failed to read {}", mips);
+        return nullptr;
+    }
+    SetResidentLevel(record.get(), record->tail_level, pixels.data());
+    record->bytes = pixels.size();
+    budget_.Add(record->bytes);
+    full_bytes_ += LevelBytes(*record, 0, record->level_count);
+
+    auto texture = record->texture;
+    feedback_ids_[texture.get()] = (uint16_t)(records_.size() + 1);
+    records_.push_back(std::move(record));
+
+    return texture;
+}
+
+glm::vec4 TextureStreamer::FeedbackColor(const Material* material) const {
+    if (!material || feedback_ids_.empty()) {
+        return glm::vec4(0.0f);
+    }
+    auto id = [this](const Texture2d* texture) {
+        auto found = feedback_ids_.find(texture);
+        return found != feedback_ids_.end() ? (float)found->second : 0.0f;
+    };
+
+    return glm::vec4(id(material->diffuse_.get()), id(material->specular_.get()), 0.0f, 0.0f);
+}
+
+bool TextureStreamer::feedback_due() const {
+    // the pixel buffer to read into may still be on its way
+    return !records_.empty() && frame_ % desc_.feedback_interval == 0 &&
+           !readbacks_[next_readback_].fence;
+}
+
+float TextureStreamer::feedback_lod_bias() const {
+    return std::log2((float)feedback_texture()->height() / (float)height_);
+}
+
+void TextureStreamer::BeginFeedback() {
+    feedback_framebuffer_->Bind();
+    glViewport(0, 0, feedback_texture()->width(), feedback_texture()->height());
+    const GLuint zero[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 0, zero);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void TextureStreamer::EndFeedback() {
+    Readback& readback = readbacks_[next_readback_];
+    next_readback_ = (next_readback_ + 1) % 2;
+    readback.buffer->Bind();
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, feedback_texture()->width(), feedback_texture()->height(),
+                 GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t TextureStreamer::LevelBytes(const Record& record, int first, int last) {
+    size_t bytes = 0;
+    for (int level = first; level < last; ++level) {
+        bytes += LevelSize(record.width, record.height, level);
+    }
+
+    return bytes;
+}
+
+void TextureStreamer::ReadFeedback(const uint16_t* pixels, size_t count) {
+    ++feedback_count_;
+    std::vector<uint16_t> finest(records_.size(), UINT16_MAX);
+    for (size_t i = 0; i < count; ++i) {
+        const uint16_t* pixel = pixels + i * 4;
+        for (int j = 0; j < 2; ++j) {
+            if (pixel[j] > 0 && pixel[j] <= records_.size()) {
+                finest[pixel[j] - 1] = std::min(finest[pixel[j] - 1], pixel[2]);
+            }
+        }
+    }
+    for (size_t i = 0; i < records_.size(); ++i) {
+        Record& record = *records_[i];
+        if (finest[i] == UINT16_MAX) {
+            // off screen, the tail is enough
+            record.wanted_level = record.tail_level;
+            continue;
+        }
+        float lod = finest[i] / 16.0f - 32.0f + record.log2_size;
+        record.wanted_level = std::clamp((int)std::floor(lod), 0, record.tail_level);
+        record.last_seen = feedback_count_;
+    }
+}
+
+void TextureStreamer::Update() {
+    ++frame_;
+
+    // feedback that arrived, the older one first
+    for (int i = 0; i < 2; ++i) {
+        Readback& readback = readbacks_[(next_readback_ + i) % 2];
+        if (!readback.fence) {
+            continue;
+        }
+        GLenum result = glClientWaitSync(readback.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        auto pixels = static_cast<const uint16_t*>(
+            readback.buffer->Map(0, readback.buffer->size(), GL_MAP_READ_BIT));
+        if (pixels) {
+            ReadFeedback(pixels, readback.buffer->count());
+        }
+        readback.buffer->Unmap();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // read levels go up to the GPU, each one a new storage and a copy of the old levels
+    budget_.TakeFinished([this](Record* record) {
+        if (record->load_failed) {
+            SPDLOG_ERROR("failed to read {}", record->filename);
+            size_t reserved = LevelBytes(*record, record->load_level, record->resident_level);
+            record->bytes -= reserved;
+            budget_.Remove(reserved);
+            record->failed = true;
+        } else {
+            SetResidentLevel(record, record->load_level, record->pixels.data());
+        }
+        record->pixels = std::vector<uint8_t>();
+        record->loading = false;
+    });
+
+    // the textures missing most levels first
+    using Request = std::pair<int, size_t>;
+    std::priority_queue<Request> requests;
+    for (size_t i = 0; i < records_.size(); ++i) {
+        const Record& record = *records_[i];
+        if (!record.loading && !record.failed && record.wanted_level < record.resident_level) {
+            requests.emplace(record.resident_level - record.wanted_level, i);
+        }
+    }
+    while (!requests.empty() && budget_.can_load()) {
+        Record* record = records_[requests.top().second].get();
+        requests.pop();
+        // the finest wanted level that fits, a coarser one when the budget is short
+        for (int level = record->wanted_level; level < record->resident_level; ++level) {
+            size_t bytes = LevelBytes(*record, level, record->resident_level);
+            if (MakeRoom(bytes)) {
+                record->bytes += bytes;
+                budget_.Add(bytes);
+                Load(record, level);
+                break;
+            }
+        }
+    }
+}
+
+void TextureStreamer::Load(Record* record, int level) {
+    record->loading = true;
+    record->load_level = level;
+    int last = record->resident_level;
+    ThreadPool::Default()->Submit(
+        [record, level, last] {
+            record->pixels.resize(LevelBytes(*record, level, last));
+            std::ifstream in(record->filename, std::ios::binary);
+            in.seekg((std::streamoff)(sizeof(MipHeader) + LevelBytes(*record, 0, level)));
+            record->load_failed = !in.read(reinterpret_cast<char*>(record->pixels.data()),
+                                           (std::streamsize)record->pixels.size());
+        },
+        &record->loaded);
+    budget_.Loading(record);
+}
+
+void TextureStreamer::SetResidentLevel(Record* record, int level, const uint8_t* pixels) {
+    int old_level = record->resident_level;
+    // immutable, so the material table can view it instead of copying it
+    auto texture = Texture2d::CreateStorage(std::max(record->width >> level, 1),
+                                            std::max(record->height >> level, 1),
+                                            record->level_count - level, GL_RGBA8);
+    for (int i = level; i < old_level; ++i) {
+        glTexSubImage2D(GL_TEXTURE_2D, i - level, 0, 0, std::max(record->width >> i, 1),
+                        std::max(record->height >> i, 1), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        pixels += LevelSize(record->width, record->height, i);
+    }
+    for (int i = std::max(level, old_level); i < record->level_count; ++i) {
+        glCopyImageSubData(record->texture->id(), GL_TEXTURE_2D, i - old_level, 0, 0, 0,
+                           texture->id(), GL_TEXTURE_2D, i - level, 0, 0, 0,
+                           std::max(record->width >> i, 1), std::max(record->height >> i, 1), 1);
+    }
+
+    if (record->texture) {
+        // the old storage goes with texture
+        record->texture->Swap(texture.get());
+    } else {
+        record->texture = std::move(texture);
+    }
+    record->resident_level = level;
+}
+
+bool TextureStreamer::MakeRoom(size_t bytes) {
+    return budget_.MakeRoom(
+        bytes, records_,
+        [](const Record& record) {
+            return !record.loading && record.resident_level < record.wanted_level;
+        },
+        [](const Record& record) { return record.last_seen; },
+        [this](Record* record) {
+            // the coarser levels are copied over, nothing is read
+            size_t freed = LevelBytes(*record, record->resident_level, record->wanted_level);
+            record->bytes -= freed;
+            SetResidentLevel(record, record->wanted_level, nullptr);
+            return freed;
+        });
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const {
+    Stats stats;
+    stats.textures = records_.size();
+    stats.resident_bytes = budget_.resident_bytes();
+    stats.full_bytes = full_bytes_;
+    stats.loading = budget_.loading();
+    stats.loads = budget_.loads();
+    stats.evictions = budget_.evictions();
+
+    return stats;
+}
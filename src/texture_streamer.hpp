@@ -0,0 +1,145 @@
+#ifndef INCLUDED_TEXTURE_STREAMER_HPP
+#define INCLUDED_TEXTURE_STREAMER_HPP
+
+#include "buffer.hpp"
+#include "common.hpp"
+#include "framebuffer.hpp"
+#include "material.hpp"
+#include "stream_budget.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+#include <unordered_map>
+
+// Textures that keep only the mip levels the screen needs in video memory. Every image is baked
+// once into a mip file next to it, all levels as RGBA8 from the largest down, and Add reads only
+// the small tail levels of it. The larger ones are read on the thread pool when the feedback asks
+// for them, the textures missing the most levels first. The resident levels of all textures share
+// one budget; a level no longer wanted stays until a finer one of another texture needs its
+// room, the textures off screen the longest give theirs up first.
+//
+// The feedback pass draws the objects with streamed textures into a target a fraction of the
+// screen size, writing the feedback ids of their textures and the mip level a 1x1 texture would
+// need there; the level a texture needs is that plus log2 of its size. The target is read back
+// through pixel buffers, Update looks at it once it arrived, a few frames later.
+//
+// A streamed texture is a Texture2d of immutable storage whose level 0 is its finest resident
+// level. When that moves, the texture swaps its storage with a copy of the new size and its
+// revision goes up. The material table views that storage instead of copying it, so the budget
+// holds for all the video memory the textures take.
+class TextureStreamer {
+  public:
+    struct Desc {
+        size_t budget_bytes{64 * 1024 * 1024};
+        int feedback_divisor{8};  // of the screen size
+        int feedback_interval{4}; // frames between feedback passes
+        int tail_size{64};        // levels this large and smaller are always resident
+        int max_loads{4};         // mip file reads in flight
+        int max_takes{2};         // textures that get new levels per Update
+    };
+
+    struct Stats {
+        size_t textures{0};
+        size_t resident_bytes{0};
+        size_t full_bytes{0}; // of every level of every texture
+        size_t loading{0};
+        size_t loads{0};     // in total
+        size_t evictions{0}; // in total
+    };
+
+    // writes filename.mips unless it is newer than the image. Needs no GL, safe on any thread
+    static bool Bake(const std::string& filename);
+    // resident levels move between immutable textures by image copies: GL 4.3, or
+    // ARB_texture_storage and ARB_copy_image
+    static bool IsSupported();
+    static std::unique_ptr<TextureStreamer> Create(int width, int height, const Desc& desc);
+    // waits for the mip file reads in flight
+    ~TextureStreamer();
+
+    // bakes the image if needed and makes a texture of its tail levels, the same one for the same
+    // file. When it cannot be baked the image is loaded as a whole, not streamed. null when that
+    // fails too
+    std::shared_ptr<Texture2d> Add(const std::string& filename);
+    // feedback ids of the diffuse and specular texture of the material in x and y, 0 for one that
+    // is not streamed. The draw color of the feedback pass
+    glm::vec4 FeedbackColor(const Material* material) const;
+
+    // whether this frame renders the feedback pass
+    bool feedback_due() const;
+    // binds the feedback target, clears it and sets its viewport
+    void BeginFeedback();
+    // starts reading the target back
+    void EndFeedback();
+    // log2 of the feedback to the screen size, the lodBias of feedback.fs
+    float feedback_lod_bias() const;
+    inline const std::shared_ptr<Texture2d> feedback_texture() const {
+        return feedback_framebuffer_->color_attachment(0);
+    }
+
+    // once a frame before the draws: reads the feedback that arrived, takes loads in, requests
+    // the levels wanted and makes room for them
+    void Update();
+    // the feedback target follows the screen size
+    bool Resize(int width, int height);
+
+    Stats stats() const;
+
+  private:
+    // feedback ids are 16 bits, 0 is none
+    static const size_t kMaxTextures = 0xffff;
+
+    struct Record {
+        std::string filename; // of the mip file
+        std::shared_ptr<Texture2d> texture;
+        int width{0};
+        int height{0};
+        int level_count{0};
+        int tail_level{0};     // the finest always resident one
+        int resident_level{0}; // the finest resident one, level 0 of the texture
+        int wanted_level{0};   // by the last feedback
+        float log2_size{0.0f};
+        uint64_t last_seen{0}; // feedback
+        size_t bytes{0};       // resident, the load in flight included
+        bool loading{false};
+        bool failed{false}; // never tried again
+        ThreadPool::Counter loaded;
+        // written by the load job, the levels from load_level to resident_level
+        int load_level{0};
+        std::vector<uint8_t> pixels;
+        bool load_failed{false};
+    };
+
+    struct Readback {
+        std::unique_ptr<Buffer> buffer;
+        GLsync fence{nullptr};
+    };
+
+    TextureStreamer() {}
+    bool Init(int width, int height, const Desc& desc);
+
+    // bytes of the levels from first up to last
+    static size_t LevelBytes(const Record& record, int first, int last);
+    void ReadFeedback(const uint16_t* pixels, size_t count);
+    void Load(Record* record, int level);
+    // makes level the finest resident one, the levels up to the old one come from pixels
+    void SetResidentLevel(Record* record, int level, const uint8_t* pixels);
+    // drops the levels finer than wanted of textures not loading, of the ones seen least recently
+    // first, until bytes more fit. false when they do not
+    bool MakeRoom(size_t bytes);
+
+    Desc desc_;
+    int width_{0};
+    int height_{0};
+    std::vector<std::unique_ptr<Record>> records_;
+    // of the textures to their feedback id, the record index + 1
+    std::unordered_map<const Texture2d*, uint16_t> feedback_ids_;
+    StreamBudget<Record> budget_;
+    std::unique_ptr<Framebuffer> feedback_framebuffer_{nullptr};
+    Readback readbacks_[2];
+    int next_readback_{0};
+    uint64_t frame_{0};
+    uint64_t feedback_count_{0};
+    size_t full_bytes_{0};
+};
+
+#endif
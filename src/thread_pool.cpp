@@ -0,0 +1,212 @@
+#include "thread_pool.hpp"
+
+namespace {
+struct WorkerContext {
+    const ThreadPool* pool{nullptr};
+    size_t index{(size_t)-1};
+};
+thread_local WorkerContext tls_worker;
+} // namespace
+
+ThreadPool::ThreadPool() {}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        quit_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    // the workers are gone, so popping their deques from here is safe
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        while (Job* job = workers_[i]->jobs.Pop()) {
+            delete job;
+        }
+    }
+    for (Job* job : injected_) {
+        delete job;
+    }
+}
+
+std::unique_ptr<ThreadPool> ThreadPool::Create(size_t thread_count) {
+    auto pool = std::unique_ptr<ThreadPool>(new ThreadPool());
+    pool->Init(thread_count);
+
+    return std::move(pool);
+}
+
+ThreadPool* ThreadPool::Default() {
+    static std::unique_ptr<ThreadPool> pool = ThreadPool::Create();
+
+    return pool.get();
+}
+
+void ThreadPool::Init(size_t thread_count) {
+    if (thread_count == 0) {
+        // the submitting thread helps in ParallelFor, so leave one core for it
+        size_t hw = std::thread::hardware_concurrency();
+        thread_count = hw > 1 ? hw - 1 : 1;
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task, Counter* counter, Counter* after) {
+    Job* job = new Job{std::move(task), counter};
+    if (counter) {
+        counter->value_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (after) {
+        // the job that takes `after` to zero swaps the waiting list out under the same lock
+        std::lock_guard<std::mutex> lock(after->mutex_);
+        if (after->value_.load(std::memory_order_acquire) > 0) {
+            after->waiting_.push_back(job);
+            return;
+        }
+    }
+    Push(job);
+}
+
+void ThreadPool::Push(Job* job) {
+    if (tls_worker.pool == this) {
+        workers_[tls_worker.index]->jobs.Push(job);
+    } else {
+        std::lock_guard<std::mutex> lock(injected_mutex_);
+        injected_.push_back(job);
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+void ThreadPool::Wait(Counter* counter) {
+    size_t self = tls_worker.pool == this ? tls_worker.index : (size_t)-1;
+    while (!counter->done()) {
+        if (!TryRunOne(self)) {
+            std::this_thread::yield();
+        }
+    }
+    // the job that finished last may still hold the lock, it is ours to destroy after this
+    std::lock_guard<std::mutex> lock(counter->mutex_);
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain,
+                             const std::function<void(size_t begin, size_t end)>& func) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count == 1 || workers_.empty()) {
+        func(0, count);
+        return;
+    }
+
+    // the tasks capture two words, which std::function stores without a heap allocation
+    struct Range {
+        const std::function<void(size_t begin, size_t end)>* func;
+        size_t count;
+        size_t grain;
+    } range{&func, count, grain};
+    Counter counter;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        Submit(
+            [&range, i]() {
+                size_t begin = i * range.grain;
+                (*range.func)(begin, std::min(begin + range.grain, range.count));
+            },
+            &counter);
+    }
+    Wait(&counter);
+}
+
+void ThreadPool::WorkerLoop(size_t index) {
+    tls_worker.pool = this;
+    tls_worker.index = index;
+
+    while (!quit_) {
+        if (TryRunOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this]() {
+            return quit_ || pending_.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+bool ThreadPool::TryRunOne(size_t index) {
+    Job* job = Pop(index);
+    if (!job) {
+        job = Steal(index);
+    }
+    if (!job) {
+        return false;
+    }
+    pending_.fetch_sub(1, std::memory_order_release);
+    Run(job);
+
+    return true;
+}
+
+void ThreadPool::Run(Job* job) {
+    job->task();
+    Counter* counter = job->counter;
+    delete job;
+    if (!counter) {
+        return;
+    }
+
+    std::vector<Job*> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mutex_);
+        if (counter->value_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ready.swap(counter->waiting_);
+        }
+    }
+    for (Job* dependent : ready) {
+        Push(dependent);
+    }
+}
+
+ThreadPool::Job* ThreadPool::Pop(size_t index) {
+    // owner takes the newest job, which keeps nested work hot in cache
+    if (index < workers_.size()) {
+        if (Job* job = workers_[index]->jobs.Pop()) {
+            return job;
+        }
+    }
+    std::lock_guard<std::mutex> lock(injected_mutex_);
+    if (injected_.empty()) {
+        return nullptr;
+    }
+    Job* job = injected_.front();
+    injected_.pop_front();
+
+    return job;
+}
+
+ThreadPool::Job* ThreadPool::Steal(size_t index) {
+    // thieves take the oldest job, which tends to be the largest remaining chunk
+    size_t count = workers_.size();
+    size_t start = index < count ? index + 1 : next_worker_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        size_t victim = (start + i) % count;
+        if (victim == index) {
+            continue;
+        }
+        if (Job* job = workers_[victim]->jobs.Steal()) {
+            return job;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,83 @@
+#ifndef INCLUDED_THREAD_POOL_HPP
+#define INCLUDED_THREAD_POOL_HPP
+
+#include "common.hpp"
+#include "work_stealing_deque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Work-stealing job system. Every worker owns a Chase-Lev deque: jobs a worker submits go to
+// the bottom of its own deque and it pops them newest first, idle workers steal the oldest from
+// the top of the others. Threads outside the pool submit through a shared queue. Waiting on a
+// counter runs jobs instead of blocking, so jobs can submit and wait on jobs of their own.
+class ThreadPool {
+    struct Job;
+
+  public:
+    // counts the unfinished jobs submitted with it. Jobs submitted `after` a counter are held
+    // back until it reaches zero, which chains jobs without blocking a thread on it. Wait on a
+    // counter before destroying it.
+    class Counter {
+      public:
+        inline bool done() const { return value_.load(std::memory_order_acquire) == 0; }
+
+      private:
+        friend class ThreadPool;
+
+        std::atomic<size_t> value_{0};
+        std::mutex mutex_;
+        std::vector<Job*> waiting_;
+    };
+
+    static std::unique_ptr<ThreadPool> Create(size_t thread_count = 0);
+    // process-wide pool for CPU-only work (asset decoding, mesh processing, per-frame updates)
+    static ThreadPool* Default();
+    ~ThreadPool();
+
+    void Submit(std::function<void()> task, Counter* counter = nullptr, Counter* after = nullptr);
+    // runs jobs until `counter` reaches zero
+    void Wait(Counter* counter);
+    // splits [0, count) into chunks of at most `grain` and blocks until all are done. the calling
+    // thread runs chunks too, so nesting ParallelFor inside a task does not deadlock.
+    void ParallelFor(size_t count, size_t grain,
+                     const std::function<void(size_t begin, size_t end)>& func);
+
+    inline size_t thread_count() const { return threads_.size(); }
+
+  private:
+    struct Job {
+        std::function<void()> task;
+        Counter* counter;
+    };
+
+    struct Worker {
+        WorkStealingDeque<Job> jobs;
+    };
+
+    ThreadPool();
+    void Init(size_t thread_count);
+    void WorkerLoop(size_t index);
+    void Push(Job* job);
+    bool TryRunOne(size_t index);
+    void Run(Job* job);
+    Job* Pop(size_t index);
+    Job* Steal(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    // jobs of threads outside the pool
+    std::mutex injected_mutex_;
+    std::deque<Job*> injected_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<bool> quit_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+};
+
+#endif
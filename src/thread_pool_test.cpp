@@ -0,0 +1,200 @@
+#include "thread_pool.hpp"
+#include "unit_test.hpp"
+#include "work_stealing_deque.hpp"
+
+#include <atomic>
+#include <thread>
+
+// Unit tests of the job system: the deque under concurrent steals, counters chained with
+// `after`, Wait nested inside jobs and ParallelFor coverage.
+namespace {
+
+// the owner pushes and pops while thieves steal, every item must come out exactly once. Starts
+// small so the ring grows under the thieves
+void TestDequeSteal() {
+    const int kItemCount = 200000;
+    const int kThiefCount = 3;
+    std::vector<int> items(kItemCount);
+    std::vector<std::atomic<int>> taken(kItemCount);
+    for (int i = 0; i < kItemCount; ++i) {
+        items[i] = i;
+        taken[i] = 0;
+    }
+    auto take = [&](int* item) { taken[*item].fetch_add(1, std::memory_order_relaxed); };
+
+    WorkStealingDeque<int> deque(4);
+    std::atomic<bool> done{false};
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < kThiefCount; ++i) {
+        thieves.emplace_back([&]() {
+            while (!done.load(std::memory_order_acquire)) {
+                if (int* item = deque.Steal()) {
+                    take(item);
+                }
+            }
+        });
+    }
+    for (int i = 0; i < kItemCount; ++i) {
+        deque.Push(&items[i]);
+        // pop now and then, the last item races the thieves
+        if (i % 3 == 0) {
+            if (int* item = deque.Pop()) {
+                take(item);
+            }
+        }
+    }
+    while (int* item = deque.Pop()) {
+        take(item);
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+
+    int lost = 0;
+    int duplicated = 0;
+    for (int i = 0; i < kItemCount; ++i) {
+        lost += taken[i] == 0;
+        duplicated += taken[i] > 1;
+    }
+    CHECK(lost == 0);
+    CHECK(duplicated == 0);
+    CHECK(deque.size() == 0);
+    CHECK(deque.capacity() > 4);
+}
+
+// jobs submitted after a counter start only once it reached zero, in a chain and fanned in
+void TestCounterChain(ThreadPool* pool) {
+    const int kChainLength = 64;
+    std::vector<ThreadPool::Counter> counters(kChainLength);
+    std::mutex mutex;
+    std::vector<int> order;
+    for (int i = 0; i < kChainLength; ++i) {
+        pool->Submit(
+            [&, i]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i);
+            },
+            &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+    }
+    pool->Wait(&counters[kChainLength - 1]);
+    for (auto& counter : counters) {
+        pool->Wait(&counter);
+    }
+    CHECK((int)order.size() == kChainLength);
+    for (int i = 0; i < (int)order.size(); ++i) {
+        CHECK(order[i] == i);
+    }
+
+    // many jobs on one counter, one job after all of them
+    const int kFanIn = 256;
+    ThreadPool::Counter first;
+    ThreadPool::Counter second;
+    std::atomic<int> finished{0};
+    int seen_by_last = -1;
+    for (int i = 0; i < kFanIn; ++i) {
+        pool->Submit([&]() { finished.fetch_add(1); }, &first);
+    }
+    pool->Submit([&]() { seen_by_last = finished.load(); }, &second, &first);
+    pool->Wait(&second);
+    pool->Wait(&first);
+    CHECK(seen_by_last == kFanIn);
+
+    // after a counter that is already done the job runs right away
+    ThreadPool::Counter third;
+    bool ran = false;
+    pool->Submit([&]() { ran = true; }, &third, &first);
+    pool->Wait(&third);
+    CHECK(ran);
+}
+
+// jobs that submit jobs and wait for them, more of them than there are workers, so every worker
+// waits inside a job and has to run others meanwhile
+void TestNestedWait(ThreadPool* pool) {
+    const int kOuterCount = 32;
+    const int kInnerCount = 64;
+    std::vector<int> sums(kOuterCount, 0);
+    ThreadPool::Counter outer;
+    for (int i = 0; i < kOuterCount; ++i) {
+        pool->Submit(
+            [pool, &sums, i]() {
+                std::vector<int> values(kInnerCount, 0);
+                ThreadPool::Counter inner;
+                for (int j = 0; j < kInnerCount; ++j) {
+                    pool->Submit([&values, j]() { values[j] = j + 1; }, &inner);
+                }
+                pool->Wait(&inner);
+                for (int value : values) {
+                    sums[i] += value;
+                }
+            },
+            &outer);
+    }
+    pool->Wait(&outer);
+    for (int sum : sums) {
+        CHECK(sum == kInnerCount * (kInnerCount + 1) / 2);
+    }
+
+    // ParallelFor from inside a job
+    std::atomic<int> visited{0};
+    ThreadPool::Counter nested;
+    pool->Submit(
+        [pool, &visited]() {
+            pool->ParallelFor(1000, 7, [&visited](size_t begin, size_t end) {
+                visited.fetch_add((int)(end - begin));
+            });
+        },
+        &nested);
+    pool->Wait(&nested);
+    CHECK(visited == 1000);
+}
+
+// every index once, in ranges of at most the grain
+void TestParallelFor(ThreadPool* pool) {
+    const size_t kCounts[] = {0, 1, 2, 7, 64, 1000, 4097};
+    const size_t kGrains[] = {0, 1, 3, 64, 5000};
+    for (size_t count : kCounts) {
+        for (size_t grain : kGrains) {
+            std::vector<std::atomic<int>> visits(count);
+            for (auto& visit : visits) {
+                visit = 0;
+            }
+            std::atomic<int> bad_ranges{0};
+            pool->ParallelFor(count, grain, [&](size_t begin, size_t end) {
+                if (begin >= end || end > count || end - begin > std::max<size_t>(grain, 1)) {
+                    bad_ranges.fetch_add(1);
+                    return;
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    visits[i].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            int wrong = 0;
+            for (auto& visit : visits) {
+                wrong += visit != 1;
+            }
+            if (bad_ranges != 0 || wrong != 0) {
+                SPDLOG_ERROR("ParallelFor count {} grain {}: {} bad ranges, {} indices not once",
+                             count, grain, bad_ranges.load(), wrong);
+            }
+            CHECK(bad_ranges == 0);
+            CHECK(wrong == 0);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    auto pool = ThreadPool::Create(4);
+    TestDequeSteal();
+    TestCounterChain(pool.get());
+    TestNestedWait(pool.get());
+    TestParallelFor(pool.get());
+    // a single worker has nobody to steal from
+    auto single = ThreadPool::Create(1);
+    TestNestedWait(single.get());
+    TestParallelFor(single.get());
+
+    return TestResult();
+}
@@ -0,0 +1,44 @@
+#ifndef INCLUDED_TRIPLE_BUFFER_HPP
+#define INCLUDED_TRIPLE_BUFFER_HPP
+
+#include "common.hpp"
+
+#include <atomic>
+
+// Hands the newest value from one writer thread to one reader thread without locks. The writer
+// fills back() and publishes it, the reader takes the newest published value into front(), and
+// the third slot sits between them, so neither ever waits for the other. Values published before
+// the reader looks are skipped. The back slot holds stale data after Publish, fill all of it.
+template <typename T> class TripleBuffer {
+  public:
+    // writer
+    inline T& back() { return slots_[back_]; }
+    void Publish() {
+        uint8_t old = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = old & kIndexMask;
+    }
+
+    // reader. false when nothing was published since the last call
+    bool Acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        uint8_t old = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = old & kIndexMask;
+
+        return true;
+    }
+    inline const T& front() const { return slots_[front_]; }
+
+  private:
+    static const uint8_t kIndexMask = 3;
+    static const uint8_t kFresh = 4;
+
+    T slots_[3]{};
+    // index of the slot in between, kFresh once the writer left one the reader has not taken
+    std::atomic<uint8_t> middle_{1};
+    uint8_t back_{0};
+    uint8_t front_{2};
+};
+
+#endif
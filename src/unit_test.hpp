@@ -0,0 +1,28 @@
+#ifndef INCLUDED_UNIT_TEST_HPP
+#define INCLUDED_UNIT_TEST_HPP
+
+#include "common.hpp"
+
+// What every unit test executable shares: CHECK logs a failed condition and counts it, main
+// returns TestResult(), the number of failed checks, for ctest.
+inline int g_failures = 0;
+
+#define CHECK(condition)                                                                        \
+    do {                                                                                        \
+        if (!(condition)) {                                                                     \
+            SPDLOG_ERROR("check failed: {}", #condition);                                       \
+            ++g_failures;                                                                       \
+        }                                                                                       \
+    } while (false)
+
+inline int TestResult() {
+    if (g_failures > 0) {
+        SPDLOG_ERROR("{} checks failed", g_failures);
+    } else {
+        SPDLOG_INFO("all checks passed");
+    }
+
+    return g_failures;
+}
+
+#endif
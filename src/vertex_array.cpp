@@ -4,6 +4,7 @@ VertexArray::VertexArray() {}
 
 VertexArray::~VertexArray() {
     if (id_) {
+        GlState::Get().ForgetVertexArray(id_);
         glDeleteVertexArrays(1, &id_);
     }
 }
@@ -2,13 +2,14 @@
 #define INCLUDED_VERTEX_ARRAY_HPP
 
 #include "common.hpp"
+#include "gl_state.hpp"
 
 class VertexArray {
   public:
     static std::unique_ptr<VertexArray> Create();
     ~VertexArray();
 
-    inline void Bind() const { glBindVertexArray(id_); }
+    inline void Bind() const { GlState::Get().BindVertexArray(id_); }
     void SetAttrib(uint32_t attrib_index, int count, uint32_t type, bool normalized, size_t stride,
                    uint64_t offset) const;
 
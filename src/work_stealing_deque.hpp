@@ -0,0 +1,118 @@
+#ifndef INCLUDED_WORK_STEALING_DEQUE_HPP
+#define INCLUDED_WORK_STEALING_DEQUE_HPP
+
+#include "common.hpp"
+
+#include <atomic>
+
+// Chase-Lev deque of pointers (Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+// Models"). The owning thread pushes and pops at the bottom without locking, any other thread
+// steals from the top with one CAS. The ring doubles when full; replaced rings are kept until
+// the deque dies since a thief may still be reading from one.
+template <typename T> class WorkStealingDeque {
+  public:
+    WorkStealingDeque(size_t capacity = 256) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        rings_.push_back(std::make_unique<Ring>(size));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    // owner only
+    void Push(T* item) {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        if (bottom - top > (int64_t)ring->mask) {
+            ring = Grow(ring, top, bottom);
+        }
+        ring->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, newest first. nullptr when empty or a thief took the last item
+    T* Pop() {
+        int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* ring = ring_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = ring->Get(bottom);
+        if (top == bottom) {
+            // the last item, race the thieves for it
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    // any thread, oldest first. nullptr when empty or another thread won the item
+    T* Steal() {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T* item = ring_.load(std::memory_order_acquire)->Get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return item;
+    }
+
+    // a snapshot, exact only on the owner while nobody steals
+    inline size_t size() const {
+        int64_t size = bottom_.load(std::memory_order_relaxed) -
+                       top_.load(std::memory_order_relaxed);
+        return size > 0 ? (size_t)size : 0;
+    }
+    inline size_t capacity() const { return ring_.load(std::memory_order_relaxed)->mask + 1; }
+
+  private:
+    struct Ring {
+        Ring(size_t capacity) : mask(capacity - 1), items(new std::atomic<T*>[capacity]) {}
+
+        T* Get(int64_t index) const {
+            return items[index & mask].load(std::memory_order_relaxed);
+        }
+        void Put(int64_t index, T* item) {
+            items[index & mask].store(item, std::memory_order_relaxed);
+        }
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Ring* Grow(Ring* ring, int64_t top, int64_t bottom) {
+        rings_.push_back(std::make_unique<Ring>((ring->mask + 1) * 2));
+        Ring* grown = rings_.back().get();
+        for (int64_t i = top; i < bottom; ++i) {
+            grown->Put(i, ring->Get(i));
+        }
+        ring_.store(grown, std::memory_order_release);
+
+        return grown;
+    }
+
+    // apart, so thieves hammering top do not invalidate the owner's bottom
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Ring*> ring_{nullptr};
+    std::vector<std::unique_ptr<Ring>> rings_; // owner only
+};
+
+#endif
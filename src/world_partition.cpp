@@ -0,0 +1,256 @@
+#include "world_partition.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <queue>
+
+namespace {
+
+const char* kManifest = "world.txt";
+
+std::string CellFilename(const std::string& directory, glm::ivec2 coord) {
+    return directory + "/cell_" + std::to_string(coord.x) + "_" + std::to_string(coord.y) +
+           ".bin";
+}
+
+} // namespace
+
+size_t WorldPartition::ObjectCapacity(size_t budget_bytes) { return budget_bytes / kObjectBytes; }
+
+bool WorldPartition::Build(const std::string& directory, const SceneFile::Contents& contents,
+                           float cell_size) {
+    if (cell_size <= 0.0f) {
+        SPDLOG_ERROR("world cells need a size");
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::ofstream manifest(directory + "/" + kManifest);
+    if (!manifest) {
+        SPDLOG_ERROR("failed to write {}/{}", directory, kManifest);
+        return false;
+    }
+    manifest << "cell_size " << cell_size << "\n";
+
+    // the names are shared, every cell gets all of them
+    std::map<std::pair<int, int>, SceneFile::Contents> cells;
+    for (const auto& object : contents.objects) {
+        std::pair<int, int> coord((int)std::floor(object.translate[0] / cell_size),
+                                  (int)std::floor(object.translate[2] / cell_size));
+        auto& cell = cells[coord];
+        if (cell.objects.empty()) {
+            cell.strings = contents.strings;
+            cell.materials = contents.materials;
+            cell.meshes = contents.meshes;
+        }
+        cell.objects.push_back(object);
+    }
+    for (const auto& [coord, cell] : cells) {
+        if (!SceneFile::Save(CellFilename(directory, glm::ivec2(coord.first, coord.second)),
+                             cell)) {
+            return false;
+        }
+    }
+    SPDLOG_INFO("world {}: {} objects in {} cells of {}", directory, contents.objects.size(),
+                cells.size(), cell_size);
+
+    return true;
+}
+
+std::unique_ptr<WorldPartition> WorldPartition::Create(const std::string& directory,
+                                                       MeshResolver resolver, const Desc& desc) {
+    auto world = std::unique_ptr<WorldPartition>(new WorldPartition());
+    if (!world->Init(directory, std::move(resolver), desc)) {
+        return nullptr;
+    }
+
+    return std::move(world);
+}
+
+WorldPartition::~WorldPartition() { budget_.WaitLoads(); }
+
+bool WorldPartition::Init(const std::string& directory, MeshResolver resolver,
+                          const Desc& desc) {
+    desc_ = desc;
+    budget_ = StreamBudget<Cell>(desc.budget_bytes, desc.max_loads, desc.max_takes);
+    resolver_ = std::move(resolver);
+    auto manifest = LoadTextFile(directory + "/" + kManifest);
+    if (!manifest) {
+        return false;
+    }
+    auto words = Split(*manifest, " ");
+    if (words.size() < 2 || words[0] != "cell_size" || std::atof(words[1].c_str()) <= 0.0) {
+        SPDLOG_ERROR("{}/{} has no cell size", directory, kManifest);
+        return false;
+    }
+    cell_size_ = (float)std::atof(words[1].c_str());
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        auto name = entry.path().stem().string();
+        auto parts = Split(name, "_");
+        if (entry.path().extension() != ".bin" || parts.size() != 3 || parts[0] != "cell") {
+            continue;
+        }
+        auto cell = std::make_unique<Cell>();
+        cell->coord = glm::ivec2(std::atoi(parts[1].c_str()), std::atoi(parts[2].c_str()));
+        cell->filename = entry.path().string();
+        cell->bytes = (size_t)entry.file_size(error) / sizeof(SceneFile::Object) * kObjectBytes;
+        cell_map_[Key(cell->coord)] = cell.get();
+        cells_.push_back(std::move(cell));
+    }
+
+    if (cells_.empty()) {
+        SPDLOG_ERROR("world {} has no cells", directory);
+        return false;
+    }
+    SPDLOG_INFO("world {}: {} cells of {}", directory, cells_.size(), cell_size_);
+
+    return true;
+}
+
+uint64_t WorldPartition::Key(glm::ivec2 coord) {
+    return ((uint64_t)(uint32_t)coord.x << 32) | (uint32_t)coord.y;
+}
+
+// to the nearest point of the cell
+float WorldPartition::Distance(const Cell& cell, const glm::vec3& position) const {
+    glm::vec2 min(cell.coord.x * cell_size_, cell.coord.y * cell_size_);
+    glm::vec2 max = min + glm::vec2(cell_size_);
+    glm::vec2 point(position.x, position.z);
+    return glm::length(point - glm::clamp(point, min, max));
+}
+
+bool WorldPartition::Update(const glm::vec3& position) {
+    ++update_;
+
+    // the estimate a cell reserved gives way to what its objects take
+    budget_.TakeFinished([this](Cell* cell) {
+        budget_.Remove(cell->bytes);
+        if (cell->failed) {
+            cell->state = kFailed;
+            cell->bytes = 0;
+        } else {
+            cell->state = kResident;
+            cell->bytes = cell->objects.size() * kObjectBytes;
+            budget_.Add(cell->bytes);
+            resident_.push_back(cell);
+            changed_ = true;
+        }
+    });
+
+    // the cells within load_radius, nearest first
+    using Request = std::pair<float, uint64_t>;
+    std::priority_queue<Request, std::vector<Request>, std::greater<Request>> requests;
+    int reach = (int)std::ceil(desc_.load_radius / cell_size_);
+    glm::ivec2 center((int)std::floor(position.x / cell_size_),
+                      (int)std::floor(position.z / cell_size_));
+    for (int z = center.y - reach; z <= center.y + reach; ++z) {
+        for (int x = center.x - reach; x <= center.x + reach; ++x) {
+            auto found = cell_map_.find(Key(glm::ivec2(x, z)));
+            if (found == cell_map_.end()) {
+                continue;
+            }
+            Cell* cell = found->second;
+            float distance = Distance(*cell, position);
+            if (distance > desc_.load_radius) {
+                continue;
+            }
+            cell->last_wanted = update_;
+            if (cell->state == kUnloaded) {
+                requests.emplace(distance, found->first);
+            }
+        }
+    }
+    while (!requests.empty() && budget_.can_load()) {
+        Cell* cell = cell_map_[requests.top().second];
+        requests.pop();
+        if (!MakeRoom(cell->bytes, position)) {
+            break;
+        }
+        budget_.Add(cell->bytes);
+        cell->state = kLoading;
+        Load(cell);
+    }
+
+    // loads may come in larger than estimated
+    MakeRoom(0, position);
+
+    bool changed = changed_;
+    changed_ = false;
+
+    return changed;
+}
+
+void WorldPartition::Load(Cell* cell) {
+    ThreadPool::Default()->Submit(
+        [this, cell] {
+            cell->objects.clear();
+            auto file = SceneFile::Load(cell->filename);
+            cell->failed = !file;
+            if (!file) {
+                return;
+            }
+            std::vector<std::shared_ptr<Mesh>> meshes(file->mesh_count());
+            for (size_t i = 0; i < meshes.size(); ++i) {
+                meshes[i] = resolver_(file->string(file->meshes()[i].name));
+            }
+            cell->objects.reserve(file->object_count());
+            for (size_t i = 0; i < file->object_count(); ++i) {
+                const auto& record = file->objects()[i];
+                if (record.mesh >= meshes.size() || !meshes[record.mesh]) {
+                    continue;
+                }
+                // the object pool locks, other loads and the GL thread create and release too
+                auto object = Object::Create(meshes[record.mesh]);
+                auto& transform = object->transform();
+                transform.translate_ = glm::make_vec3(record.translate);
+                transform.set_rotate(glm::make_quat(record.rotate));
+                transform.scale_ = glm::make_vec3(record.scale);
+                if (record.bounding_radius > 0.0f) {
+                    object->CreateBoundingSphere(record.bounding_radius);
+                }
+                cell->objects.push_back(std::move(object));
+            }
+        },
+        &cell->loaded);
+    budget_.Loading(cell);
+}
+
+bool WorldPartition::MakeRoom(size_t bytes, const glm::vec3& position) {
+    return budget_.MakeRoom(
+        bytes, resident_,
+        [&](const Cell& cell) {
+            return cell.last_wanted != update_ && Distance(cell, position) > desc_.unload_radius;
+        },
+        [](const Cell& cell) { return cell.last_wanted; },
+        [this](Cell* cell) { return Evict(cell); });
+}
+
+size_t WorldPartition::Evict(Cell* cell) {
+    resident_.erase(std::find(resident_.begin(), resident_.end(), cell));
+    cell->objects.clear();
+    cell->state = kUnloaded;
+    changed_ = true;
+
+    return cell->bytes;
+}
+
+void WorldPartition::CollectObjects(std::vector<std::shared_ptr<Object>>* objects) const {
+    for (const Cell* cell : resident_) {
+        objects->insert(objects->end(), cell->objects.begin(), cell->objects.end());
+    }
+}
+
+WorldPartition::Stats WorldPartition::stats() const {
+    Stats stats;
+    stats.cells = cells_.size();
+    stats.resident = resident_.size();
+    stats.loading = budget_.loading();
+    stats.resident_bytes = budget_.resident_bytes();
+    stats.loads = budget_.loads();
+    stats.evictions = budget_.evictions();
+
+    return stats;
+}
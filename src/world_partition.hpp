@@ -0,0 +1,109 @@
+#ifndef INCLUDED_WORLD_PARTITION_HPP
+#define INCLUDED_WORLD_PARTITION_HPP
+
+#include "common.hpp"
+#include "object.hpp"
+#include "scene_file.hpp"
+#include "stream_budget.hpp"
+#include "thread_pool.hpp"
+
+#include <unordered_map>
+
+// A world split into square cells on the XZ plane, streamed in around a position, usually the
+// camera. Every cell is a SceneFile of the objects in it, Build writes them into a directory.
+//
+// Cells within load_radius load on the thread pool nearest first; mapping the file and making
+// the objects happens there, Update only takes finished cells in, so frame times stay flat while
+// the camera moves. Cells past unload_radius stay cached until the memory budget needs their
+// room, then the least recently wanted go first.
+//
+// Meshes and materials are shared, resolved by name, only objects stream.
+class WorldPartition {
+  public:
+    // what a resident object costs: itself, the pointer in the scene and its model matrix
+    static const size_t kObjectBytes =
+        sizeof(Object) + sizeof(std::shared_ptr<Object>) + sizeof(glm::mat4);
+
+    struct Desc {
+        size_t budget_bytes{4 * 1024 * 1024};
+        float load_radius{48.0f};
+        float unload_radius{64.0f}; // cells past it may be evicted
+        int max_loads{4};           // in flight
+        int max_takes{2};           // finished loads taken in per Update
+    };
+
+    struct Stats {
+        size_t cells{0};
+        size_t resident{0};
+        size_t loading{0};
+        size_t resident_bytes{0};
+        size_t loads{0};     // in total
+        size_t evictions{0}; // in total
+    };
+
+    // meshes by the name scene files give them, called on the thread pool
+    using MeshResolver = std::function<std::shared_ptr<Mesh>(const char* name)>;
+
+    // the most objects resident at once, what the draw list has to take
+    static size_t ObjectCapacity(size_t budget_bytes);
+    // one cell file per cell with objects of contents in directory, lights are not streamed
+    static bool Build(const std::string& directory, const SceneFile::Contents& contents,
+                      float cell_size);
+    static std::unique_ptr<WorldPartition> Create(const std::string& directory,
+                                                  MeshResolver resolver,
+                                                  const Desc& desc);
+    // waits for the loads in flight
+    ~WorldPartition();
+
+    // true when the resident objects changed
+    bool Update(const glm::vec3& position);
+    // appends the objects of every resident cell
+    void CollectObjects(std::vector<std::shared_ptr<Object>>* objects) const;
+
+    inline float cell_size() const { return cell_size_; }
+    Stats stats() const;
+
+  private:
+    enum CellState {
+        kUnloaded,
+        kLoading,
+        kResident,
+        kFailed, // never tried again
+    };
+
+    struct Cell {
+        glm::ivec2 coord;
+        std::string filename;
+        size_t bytes{0}; // resident, estimated from the file until loaded
+        CellState state{kUnloaded};
+        uint64_t last_wanted{0}; // update
+        ThreadPool::Counter loaded;
+        // written by the load job
+        std::vector<std::shared_ptr<Object>> objects;
+        bool failed{false};
+    };
+
+    WorldPartition() {}
+    bool Init(const std::string& directory, MeshResolver resolver, const Desc& desc);
+
+    static uint64_t Key(glm::ivec2 coord);
+    float Distance(const Cell& cell, const glm::vec3& position) const;
+    void Load(Cell* cell);
+    // evicts cells past unload_radius, least recently wanted first, until bytes more fit into the
+    // budget. false when they do not
+    bool MakeRoom(size_t bytes, const glm::vec3& position);
+    // the bytes it freed
+    size_t Evict(Cell* cell);
+
+    Desc desc_;
+    MeshResolver resolver_;
+    float cell_size_{16.0f};
+    std::vector<std::unique_ptr<Cell>> cells_;
+    std::unordered_map<uint64_t, Cell*> cell_map_;
+    StreamBudget<Cell> budget_;
+    std::vector<Cell*> resident_; // in the order they came in
+    uint64_t update_{0};
+    bool changed_{false}; // since the last Update
+};
+
+#endif
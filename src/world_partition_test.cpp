@@ -0,0 +1,191 @@
+#include "unit_test.hpp"
+#include "world_partition.hpp"
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+// Unit tests of WorldPartition: cells loaded on the thread pool, max_loads at a time, each one
+// making its objects out of the shared object pool while the others do, and cells evicted and
+// loaded again as the position moves under a small budget. Meshes come without geometry, so no
+// GL context is needed.
+namespace {
+
+const float kCellSize = 16.0f;
+const int kCellsPerSide = 8;
+const int kObjectsPerCell = 64;
+
+// kObjectsPerCell objects in every cell of a kCellsPerSide square starting at the origin, the
+// mesh index tells the cell apart
+SceneFile::Contents MakeContents() {
+    SceneFile::Contents contents;
+    for (int i = 0; i < kCellsPerSide * kCellsPerSide; ++i) {
+        uint32_t name = contents.AddString("cell_" + std::to_string(i));
+        contents.meshes.push_back(SceneFile::Mesh{name, SceneFile::kNone});
+    }
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> offset(0.0f, kCellSize);
+    for (int z = 0; z < kCellsPerSide; ++z) {
+        for (int x = 0; x < kCellsPerSide; ++x) {
+            for (int i = 0; i < kObjectsPerCell; ++i) {
+                SceneFile::Object object{};
+                object.translate[0] = x * kCellSize + offset(random) * 0.99f;
+                object.translate[2] = z * kCellSize + offset(random) * 0.99f;
+                object.rotate[3] = 1.0f;
+                object.scale[0] = object.scale[1] = object.scale[2] = 1.0f;
+                object.bounding_radius = 0.5f;
+                object.mesh = (uint32_t)(z * kCellsPerSide + x);
+                contents.objects.push_back(object);
+            }
+        }
+    }
+
+    return contents;
+}
+
+// one geometry-less mesh per name, resolved from several load jobs at once
+class Meshes {
+  public:
+    std::shared_ptr<Mesh> Resolve(const char* name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& mesh = meshes_[name];
+        if (!mesh) {
+            mesh = ObjectPool<Mesh>::Default().MakeShared((uint32_t)GL_TRIANGLES);
+            cells_[mesh.get()] = std::atoi(name + 5);
+        }
+        return mesh;
+    }
+
+    int CellOf(const Mesh* mesh) const { return cells_.at(mesh); }
+
+  private:
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Mesh>> meshes_;
+    std::map<const Mesh*, int> cells_;
+};
+
+// updates until nothing is loading and no more loads start, false if that takes too long
+bool Settle(WorldPartition* world, const glm::vec3& position) {
+    for (int i = 0; i < 100000; ++i) {
+        world->Update(position);
+        auto stats = world->stats();
+        if (stats.loading == 0) {
+            world->Update(position);
+            if (world->stats().loading == 0) {
+                return true;
+            }
+        }
+        std::this_thread::yield();
+    }
+
+    return false;
+}
+
+// every object made once, in the cell its mesh names, with an id of its own
+void CheckObjects(const WorldPartition& world, const Meshes& meshes, size_t expected) {
+    std::vector<std::shared_ptr<Object>> objects;
+    world.CollectObjects(&objects);
+    CHECK(objects.size() == expected);
+
+    std::set<size_t> ids;
+    int misplaced = 0;
+    for (const auto& object : objects) {
+        ids.insert(object->id());
+        const auto& translate = object->transform().translate_;
+        int cell = (int)std::floor(translate.z / kCellSize) * kCellsPerSide +
+                   (int)std::floor(translate.x / kCellSize);
+        misplaced += cell != meshes.CellOf(object->mesh().get());
+    }
+    CHECK(ids.size() == objects.size());
+    CHECK(misplaced == 0);
+}
+
+// the whole world in reach, loads run max_loads at a time until every cell is resident
+void TestLoadAll(const std::string& directory) {
+    Meshes meshes;
+    WorldPartition::Desc desc;
+    desc.budget_bytes = 2 * kCellsPerSide * kCellsPerSide * kObjectsPerCell *
+                        WorldPartition::kObjectBytes;
+    desc.load_radius = 2.0f * kCellsPerSide * kCellSize;
+    desc.unload_radius = desc.load_radius;
+    desc.max_loads = 4;
+    desc.max_takes = 2;
+    auto world = WorldPartition::Create(
+        directory, [&](const char* name) { return meshes.Resolve(name); }, desc);
+    CHECK(world != nullptr);
+    if (!world) {
+        return;
+    }
+
+    auto center = glm::vec3(0.5f * kCellsPerSide * kCellSize, 0.0f, 0.5f);
+    world->Update(center);
+    CHECK((int)world->stats().loading <= desc.max_loads);
+    CHECK(Settle(world.get(), center));
+
+    auto stats = world->stats();
+    const size_t kObjectCount = kCellsPerSide * kCellsPerSide * kObjectsPerCell;
+    CHECK(stats.resident == stats.cells);
+    CHECK(stats.loads == stats.cells);
+    CHECK(stats.evictions == 0);
+    CHECK(stats.resident_bytes == kObjectCount * WorldPartition::kObjectBytes);
+    CHECK(ObjectPool<Object>::Default().size() == kObjectCount);
+    CheckObjects(*world, meshes, kObjectCount);
+
+    world.reset();
+    CHECK(ObjectPool<Object>::Default().size() == 0);
+}
+
+// room for a few cells only, walking across evicts the ones behind while the ones ahead load
+void TestWalk(const std::string& directory) {
+    Meshes meshes;
+    const size_t kCellBytes = kObjectsPerCell * WorldPartition::kObjectBytes;
+    WorldPartition::Desc desc;
+    desc.budget_bytes = 12 * kCellBytes;
+    desc.load_radius = kCellSize;
+    desc.unload_radius = kCellSize;
+    desc.max_loads = 4;
+    desc.max_takes = 2;
+    auto world = WorldPartition::Create(
+        directory, [&](const char* name) { return meshes.Resolve(name); }, desc);
+    CHECK(world != nullptr);
+    if (!world) {
+        return;
+    }
+
+    bool over_budget = false;
+    bool settled = true;
+    for (int step = 0; step < kCellsPerSide; ++step) {
+        glm::vec3 position((step + 0.5f) * kCellSize, 0.0f, 0.5f * kCellsPerSide * kCellSize);
+        settled = Settle(world.get(), position) && settled;
+        auto stats = world->stats();
+        over_budget = over_budget || stats.resident_bytes > desc.budget_bytes;
+        CheckObjects(*world, meshes, stats.resident * kObjectsPerCell);
+        CHECK(ObjectPool<Object>::Default().size() == stats.resident * kObjectsPerCell);
+    }
+    CHECK(settled);
+    CHECK(!over_budget);
+    CHECK(world->stats().evictions > 0);
+
+    world.reset();
+    CHECK(ObjectPool<Object>::Default().size() == 0);
+}
+
+} // namespace
+
+int main() {
+    auto directory = (std::filesystem::temp_directory_path() / "world_partition_test").string();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    if (!WorldPartition::Build(directory, MakeContents(), kCellSize)) {
+        SPDLOG_ERROR("failed to build the test world");
+        return 1;
+    }
+
+    TestLoadAll(directory);
+    TestWalk(directory);
+    std::filesystem::remove_all(directory, error);
+
+    return TestResult();
+}